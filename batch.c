@@ -0,0 +1,373 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "decode.h"
+#include "plan.h"
+#include "batch.h"
+
+// What the parser expects next.
+#define GOB_BATCH_PREFIX    (0) // the length of a message
+#define GOB_BATCH_ID        (1) // the type id
+#define GOB_BATCH_DEFINE    (2) // the body of a type definition
+#define GOB_BATCH_SKIP      (3) // the rest of a message of another type
+#define GOB_BATCH_FIELD     (4) // a field delta of the struct holding the slice
+#define GOB_BATCH_VALUE     (5) // a field value other than the slice
+#define GOB_BATCH_SINGLETON (6) // the 0 delta in front of a top-level slice
+#define GOB_BATCH_COUNT     (7) // the number of elements
+#define GOB_BATCH_ELEM      (8) // an element
+#define GOB_BATCH_ERROR     (9)
+
+// The smallest carry buffer, which holds any varint prefix.
+#define GOB_BATCH_MIN_CARRY (32)
+
+int gob_batch_init(struct gob_batch *b, struct gob_decoder *dec, const char *type_name,
+		   const char *field_name, int type, const struct gob_local_struct *local,
+		   void *elems, size_t elem_size, size_t capacity,
+		   gob_batch_callback callback, void *ctx) {
+  memset(b, 0, sizeof(struct gob_batch));
+  b->dec = dec;
+  b->type_name = type_name;
+  b->field_name = field_name;
+  b->type = type;
+  b->local = local;
+  b->elems = elems;
+  b->elem_size = elem_size;
+  b->capacity = capacity;
+  b->callback = callback;
+  b->ctx = ctx;
+  return gob_batch_carry(b, GOB_BATCH_CARRY_SIZE);
+}
+
+void gob_batch_destroy(struct gob_batch *b) {
+  free(b->carry);
+  memset(b, 0, sizeof(struct gob_batch));
+}
+
+int gob_batch_carry(struct gob_batch *b, size_t size) {
+  char *carry;
+
+  if (size < GOB_BATCH_MIN_CARRY) {
+    size = GOB_BATCH_MIN_CARRY;
+  }
+  carry = realloc(b->carry, size);
+  if (carry == NULL) {
+    return -1;
+  }
+  b->carry = carry;
+  b->carry_size = size;
+  return 0;
+}
+
+int gob_batch_complete(const struct gob_batch *b) {
+  return b->state == GOB_BATCH_PREFIX && b->carry_len == 0;
+}
+
+// Whether elements point into the input, and have to be handed over before
+// it goes away.
+static int gob_batch_borrows(const struct gob_batch *b) {
+  int i;
+
+  if (b->type != 0) {
+    return b->type == GOB_LOCAL_STRING || b->type == GOB_LOCAL_INTERN;
+  }
+  for (i = 0; i < b->local->nfields && b->local->fields[i].type != GOB_LOCAL_STRING &&
+	 b->local->fields[i].type != GOB_LOCAL_INTERN; i++) {
+  }
+  return i < b->local->nfields;
+}
+
+// Looks up where the slice is in messages of type id.  Returns 0 if they do
+// not hold it and -1 if the slice does not match the elements.
+static int gob_batch_resolve(struct gob_batch *b, int id) {
+  const struct gob_types *types = &b->dec->types;
+  const struct gob_type *t = gob_types_lookup(types, id);
+  const struct gob_type *et;
+  const struct gob_plan *plan;
+  int i;
+
+  b->resolved = id;
+  b->target = 0;
+  if (t == NULL || t->name == NULL || strcmp(t->name, b->type_name) != 0) {
+    return 0;
+  }
+  if (b->field_name != NULL) {
+    if (t->kind != GOB_KIND_STRUCT) {
+      return -1;
+    }
+    for (i = 0; i < t->nfields && strcmp(t->fields[i].name, b->field_name) != 0; i++) {
+    }
+    if (i == t->nfields) {
+      // never sent, as an empty slice
+      return 0;
+    }
+    b->slice_field = i;
+    t = gob_types_lookup(types, t->fields[i].id);
+  }
+  if (t == NULL || (t->kind != GOB_KIND_SLICE && t->kind != GOB_KIND_ARRAY)) {
+    return -1;
+  }
+  b->elem_id = t->elem;
+  if (b->type != 0) {
+    et = gob_types_lookup(types, b->elem_id);
+    if (!gob_local_compatible(et != NULL ? et->kind : 0, b->type)) {
+      return -1;
+    }
+  } else {
+    plan = gob_decoder_plan(b->dec, b->elem_id, b->local);
+    if (plan == NULL || plan->state < 0) {
+      return -1;
+    }
+  }
+  b->target = 1;
+  return 0;
+}
+
+static int gob_batch_deliver(struct gob_batch *b, int last) {
+  size_t n = b->count;
+
+  b->count = 0;
+  if (b->callback(b->ctx, b->elems, n, last) != 0) {
+    errno = ECANCELED;
+    return -1;
+  }
+  return 0;
+}
+
+// Parses buf up to the first incomplete value.  Returns the number of bytes
+// consumed, or -1 on errors.
+static long gob_batch_parse(struct gob_batch *b, const char *buf, size_t buf_size) {
+  const struct gob_plan *plan = NULL;
+  const struct gob_type *t;
+  unsigned long long u;
+  long long i;
+  const char *p;
+  size_t pos = 0;
+  size_t avail;
+  long num_bytes;
+
+  while (pos < buf_size) {
+    p = buf + pos;
+    avail = buf_size - pos;
+    if (b->state != GOB_BATCH_PREFIX && avail > b->remaining) {
+      avail = b->remaining;
+    }
+    switch (b->state) {
+    case GOB_BATCH_PREFIX:
+      num_bytes = gob_decode_unsigned_long_long(p, avail, &u);
+      if (num_bytes < 0) {
+	if (avail > sizeof(u)) {
+	  return -1;
+	}
+	goto incomplete;
+      }
+      if (u == 0) {
+	return -1;
+      }
+      pos += num_bytes;
+      b->remaining = u;
+      b->state = GOB_BATCH_ID;
+      continue;
+    case GOB_BATCH_ID:
+      num_bytes = gob_decode_long_long(p, avail, &i);
+      if (num_bytes < 0) {
+	goto truncated;
+      }
+      if (i == 0 || i < -GOB_MAX_TYPE_ID || i > GOB_MAX_TYPE_ID) {
+	return -1;
+      }
+      b->id = (int)(i < 0 ? -i : i);
+      if (i < 0) {
+	b->state = GOB_BATCH_DEFINE;
+      } else {
+	if (b->resolved != b->id && gob_batch_resolve(b, b->id) < 0) {
+	  return -1;
+	}
+	b->state = !b->target ? GOB_BATCH_SKIP : b->field_name != NULL ? GOB_BATCH_FIELD : GOB_BATCH_SINGLETON;
+	b->field = -1;
+      }
+      break;
+    case GOB_BATCH_DEFINE:
+      if (avail < b->remaining) {
+	goto incomplete;
+      }
+      num_bytes = gob_decoder_define(b->dec, b->id, p, avail);
+      if (num_bytes != (long)avail) {
+	return -1;
+      }
+      // the type of any id may have changed
+      b->resolved = 0;
+      b->state = GOB_BATCH_PREFIX;
+      break;
+    case GOB_BATCH_SKIP:
+      num_bytes = (long)avail;
+      if (avail == b->remaining) {
+	b->state = GOB_BATCH_PREFIX;
+      }
+      break;
+    case GOB_BATCH_FIELD:
+      t = gob_types_lookup(&b->dec->types, b->id);
+      num_bytes = gob_decode_unsigned_long_long(p, avail, &u);
+      if (num_bytes < 0) {
+	goto truncated;
+      }
+      if (u > (unsigned long long)(t->nfields - 1 - b->field)) {
+	return -1;
+      }
+      if (u == 0) {
+	if ((size_t)num_bytes != b->remaining) {
+	  return -1;
+	}
+	b->state = GOB_BATCH_PREFIX;
+	break;
+      }
+      b->field += (int)u;
+      b->state = b->field == b->slice_field ? GOB_BATCH_COUNT : GOB_BATCH_VALUE;
+      break;
+    case GOB_BATCH_VALUE:
+      t = gob_types_lookup(&b->dec->types, b->id);
+      num_bytes = gob_skip_value(&b->dec->types, t->fields[b->field].id, p, avail);
+      if (num_bytes < 0) {
+	goto truncated;
+      }
+      b->state = GOB_BATCH_FIELD;
+      break;
+    case GOB_BATCH_SINGLETON:
+      num_bytes = gob_decode_unsigned_long_long(p, avail, &u);
+      if (num_bytes < 0) {
+	goto truncated;
+      }
+      if (u != 0) {
+	return -1;
+      }
+      b->state = GOB_BATCH_COUNT;
+      break;
+    case GOB_BATCH_COUNT:
+      num_bytes = gob_decode_unsigned_long_long(p, avail, &u);
+      if (num_bytes < 0) {
+	goto truncated;
+      }
+      b->left = u;
+      b->state = GOB_BATCH_ELEM;
+      if (u == 0 && gob_batch_deliver(b, 1) < 0) {
+	return -1;
+      }
+      break;
+    default:
+      if (b->type != 0) {
+	num_bytes = gob_decoder_value(b->dec, p, avail, b->type, b->elems + b->count * b->elem_size);
+      } else {
+	if (plan == NULL) {
+	  plan = gob_decoder_plan(b->dec, b->elem_id, b->local);
+	  if (plan == NULL) {
+	    return -1;
+	  }
+	}
+	num_bytes = gob_decoder_struct(b->dec, plan, p, avail, b->elems + b->count * b->elem_size);
+      }
+      if (num_bytes < 0) {
+	goto truncated;
+      }
+      b->count++;
+      b->left--;
+      b->elements++;
+      if ((b->left == 0 || b->count == b->capacity) && gob_batch_deliver(b, b->left == 0) < 0) {
+	return -1;
+      }
+      break;
+    }
+    pos += num_bytes;
+    b->remaining -= num_bytes;
+    if (b->state == GOB_BATCH_ELEM && b->left == 0) {
+      // the slice is done, a top-level one with its message
+      if (b->field_name != NULL) {
+	b->state = GOB_BATCH_FIELD;
+      } else if (b->remaining == 0) {
+	b->state = GOB_BATCH_PREFIX;
+      } else {
+	return -1;
+      }
+    }
+    continue;
+  truncated:
+    // only a value cut off by the end of buf may be incomplete
+    if (avail == b->remaining) {
+      return -1;
+    }
+    goto incomplete;
+  }
+ incomplete:
+  if (b->count > 0 && gob_batch_borrows(b) && gob_batch_deliver(b, 0) < 0) {
+    return -1;
+  }
+  return (long)pos;
+}
+
+// Makes room for size bytes of an incomplete value in the carry buffer.
+// Only type definitions may outgrow it.
+static int gob_batch_reserve(struct gob_batch *b, size_t size) {
+  if (size <= b->carry_size) {
+    return 0;
+  }
+  if (b->state != GOB_BATCH_DEFINE) {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  return gob_batch_carry(b, b->remaining);
+}
+
+int gob_batch_feed(struct gob_batch *b, const char *buf, size_t buf_size) {
+  size_t take;
+  size_t left;
+  long n;
+
+  if (b->state == GOB_BATCH_ERROR) {
+    errno = EINVAL;
+    return -1;
+  }
+  while (buf_size > 0) {
+    if (b->carry_len == 0) {
+      n = gob_batch_parse(b, buf, buf_size);
+      if (n < 0) {
+	goto error;
+      }
+      buf += n;
+      buf_size -= n;
+      if (buf_size > 0) {
+	if (gob_batch_reserve(b, buf_size) < 0) {
+	  goto error;
+	}
+	memcpy(b->carry, buf, buf_size);
+	b->carry_len = buf_size;
+      }
+      break;
+    }
+    // complete the carried value with the start of buf
+    take = b->carry_size - b->carry_len < buf_size ? b->carry_size - b->carry_len : buf_size;
+    memcpy(b->carry + b->carry_len, buf, take);
+    b->carry_len += take;
+    buf += take;
+    buf_size -= take;
+    n = gob_batch_parse(b, b->carry, b->carry_len);
+    if (n < 0) {
+      goto error;
+    }
+    left = b->carry_len - n;
+    if (left <= take) {
+      // what is left came from buf, parse it there
+      buf -= left;
+      buf_size += left;
+      b->carry_len = 0;
+    } else {
+      memmove(b->carry, b->carry + n, left);
+      b->carry_len = left;
+      if (left == b->carry_size && gob_batch_reserve(b, left + 1) < 0) {
+	goto error;
+      }
+    }
+  }
+  return 0;
+ error:
+  b->state = GOB_BATCH_ERROR;
+  return -1;
+}
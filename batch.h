@@ -0,0 +1,154 @@
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include <stddef.h>
+
+#include "plan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Batched decoding of huge slices.
+ *
+ * A gob_batch decoder is fed a stream in chunks of any size and hands the
+ * elements of one slice to a callback in batches of at most a given number,
+ * as they are parsed, so a message with millions of elements never has to
+ * be held in memory:
+ *
+ * \code
+ * struct tick ticks[1024];
+ * gob_decoder_init(&dec);
+ * gob_batch_init(&b, &dec, "Feed", "Ticks", 0, &tick_struct, ticks, sizeof(struct tick), 1024,
+ *                on_ticks, NULL);
+ * while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+ *   if (gob_batch_feed(&b, chunk, n) < 0) ...
+ * }
+ * \endcode
+ *
+ * The slice is either field field_name of the top-level struct type named
+ * type_name, or, with a NULL field_name, the top-level value of the slice
+ * or array type named type_name.  Its elements are of a basic type, decoded
+ * into C values of type GOB_LOCAL_*, or structs, decoded as gob_decoder_next()
+ * does with a struct description.  Other fields of the struct and value
+ * messages of other types are skipped, type definitions are registered with
+ * the gob_decoder.
+ *
+ * A chunk is parsed in place.  Only the bytes of an element (or of another
+ * value) cut off at the end of a chunk are kept, in a carry buffer, until the
+ * next chunk completes it; so no element may be longer than the carry
+ * buffer.  Type definitions are kept whole, growing the buffer if need be.
+ *
+ * Strings decoded into the batch point into the chunk or the carry buffer
+ * and are only valid during the callback.  For that reason the pending
+ * elements are also handed over when a chunk has been parsed, so batches
+ * can be smaller than the capacity.
+ */
+
+/**
+ * The default size of the carry buffer.
+ */
+#define GOB_BATCH_CARRY_SIZE (4096)
+
+/**
+ * Called with each batch of elements.
+ *
+ * @param elems
+ *   The elements, in the caller's array.
+ * @param n
+ *   The number of elements, 0 only for the end of an empty slice.
+ * @param last
+ *   Whether these are the last elements of the slice.
+ *
+ * @return
+ *   0 to continue, anything else fails gob_batch_feed() (errno ECANCELED).
+ */
+typedef int (*gob_batch_callback)(void *ctx, void *elems, size_t n, int last);
+
+struct gob_batch {
+  struct gob_decoder *dec;
+  const char *type_name;
+  const char *field_name;   // NULL for a top-level slice
+  int type;                 // GOB_LOCAL_* of basic elements, 0 for structs
+  const struct gob_local_struct *local; // of struct elements
+  char *elems;
+  size_t elem_size;
+  size_t capacity;
+  size_t count;             // elements in the current batch
+  gob_batch_callback callback;
+  void *ctx;
+  int resolved;             // type id resolved against, 0 for none
+  int target;               // 1 if messages of type resolved hold the slice
+  int slice_field;          // field number of the slice
+  int elem_id;              // type id of the elements
+  int state;
+  unsigned long long remaining; // bytes of the current message left
+  int id;                   // type id of the current message
+  int field;                // field number of the current struct field
+  unsigned long long left;  // elements of the slice left
+  char *carry;
+  size_t carry_len;
+  size_t carry_size;
+  unsigned long long elements; // elements decoded
+};
+
+/**
+ * Initializes a decoder.
+ *
+ * @param dec
+ *   The decoder holding the type registry and plans, which may be shared
+ *   with other decoders of the stream.
+ * @param type_name
+ *   The name of the type holding the slice, as in its definition.
+ * @param field_name
+ *   The name of the slice field, or NULL.  Neither name is copied.
+ * @param type
+ *   GOB_LOCAL_* for elements of a basic type, or 0 for struct elements.
+ * @param local
+ *   The description of struct elements, NULL for basic ones.
+ * @param elems
+ *   The array of capacity elements of elem_size bytes the batches are
+ *   decoded into.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_batch_init(struct gob_batch *b, struct gob_decoder *dec, const char *type_name,
+		   const char *field_name, int type, const struct gob_local_struct *local,
+		   void *elems, size_t elem_size, size_t capacity,
+		   gob_batch_callback callback, void *ctx);
+
+void gob_batch_destroy(struct gob_batch *b);
+
+/**
+ * Sets the size of the carry buffer, the longest element that can be cut
+ * off by the end of a chunk.  Must be called before the first chunk.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_batch_carry(struct gob_batch *b, size_t size);
+
+/**
+ * Parses the next chunk of the stream.
+ *
+ * @return
+ *   0 on success, or -1 if the stream is malformed, the slice's elements do
+ *   not match the description, an element is longer than the carry buffer
+ *   (errno EMSGSIZE) or the callback stopped (errno ECANCELED).  The decoder
+ *   cannot be fed any more after an error.
+ */
+int gob_batch_feed(struct gob_batch *b, const char *buf, size_t buf_size);
+
+/**
+ * Returns whether the stream ended with a complete message, i.e. there are
+ * no bytes of a partial message carried over.
+ */
+int gob_batch_complete(const struct gob_batch *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
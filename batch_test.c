@@ -0,0 +1,316 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "builder.h"
+#include "batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+
+#define NUM_TICKS (10000)
+#define NUM_VALUES (100000)
+
+// type Tick struct { Sym string; Seq uint }
+// type Feed struct { Name string; Ticks []Tick; Total int }
+static int encode_feed_types(char *buf, size_t buf_size) {
+  int total_bytes = 0;
+  int len;
+
+  len = gob_start_type_definition(buf, buf_size, 65, GOB_STRUCTTYPE_ID);
+  len += gob_start_struct_type(buf+len, buf_size-len, "Tick", 65);
+  len += gob_encode_unsigned_int(buf+len, buf_size-len, 1);
+  len += gob_start_slice(buf+len, buf_size-len, 2);
+  len += gob_encode_field_type(buf+len, buf_size-len, "Sym", GOB_STRING_ID);
+  len += gob_encode_field_type(buf+len, buf_size-len, "Seq", GOB_UINT_ID);
+  len += gob_end_slice(buf+len, buf_size-len);
+  len += gob_end_struct_type(buf+len, buf_size-len);
+  len += gob_end_type_definition(buf+len, buf_size-len);
+  total_bytes += gob_end_message(buf, buf_size, len);
+
+  len = gob_start_type_definition(buf+total_bytes, buf_size-total_bytes, 66, GOB_SLICETYPE_ID);
+  len += gob_encode_slice_type(buf+total_bytes+len, buf_size-total_bytes-len, "[]Tick", 66, 65);
+  len += gob_end_type_definition(buf+total_bytes+len, buf_size-total_bytes-len);
+  total_bytes += gob_end_message(buf+total_bytes, buf_size-total_bytes, len);
+
+  len = gob_start_type_definition(buf+total_bytes, buf_size-total_bytes, 67, GOB_STRUCTTYPE_ID);
+  len += gob_start_struct_type(buf+total_bytes+len, buf_size-total_bytes-len, "Feed", 67);
+  len += gob_encode_unsigned_int(buf+total_bytes+len, buf_size-total_bytes-len, 1);
+  len += gob_start_slice(buf+total_bytes+len, buf_size-total_bytes-len, 3);
+  len += gob_encode_field_type(buf+total_bytes+len, buf_size-total_bytes-len, "Name", GOB_STRING_ID);
+  len += gob_encode_field_type(buf+total_bytes+len, buf_size-total_bytes-len, "Ticks", 66);
+  len += gob_encode_field_type(buf+total_bytes+len, buf_size-total_bytes-len, "Total", GOB_INT_ID);
+  len += gob_end_slice(buf+total_bytes+len, buf_size-total_bytes-len);
+  len += gob_end_struct_type(buf+total_bytes+len, buf_size-total_bytes-len);
+  len += gob_end_type_definition(buf+total_bytes+len, buf_size-total_bytes-len);
+  total_bytes += gob_end_message(buf+total_bytes, buf_size-total_bytes, len);
+  return total_bytes;
+}
+
+struct tick {
+  struct gob_string sym;
+  unsigned long long seq;
+};
+
+static const struct gob_local_field sTickFields[] = {
+  { "Seq", GOB_LOCAL_UINT, offsetof(struct tick, seq) },
+  { "Sym", GOB_LOCAL_STRING, offsetof(struct tick, sym) },
+};
+static const struct gob_local_struct sTick = { sTickFields, 2 };
+
+struct collect {
+  size_t capacity;
+  unsigned long long elements;
+  long long sum;
+  int batches;
+  int lasts;
+  int errors;
+};
+
+static int collect_ticks(void *ctx, void *elems, size_t n, int last) {
+  struct collect *c = ctx;
+  struct tick *ticks = elems;
+  char sym[32];
+  size_t i;
+
+  c->batches++;
+  c->lasts += last;
+  if (n > c->capacity) {
+    c->errors++;
+  }
+  for (i = 0; i < n; i++, c->elements++) {
+    snprintf(sym, sizeof(sym), "sym%llu", c->elements % 1000);
+    if (ticks[i].seq != c->elements || ticks[i].sym.len != strlen(sym) ||
+	memcmp(ticks[i].sym.data, sym, ticks[i].sym.len) != 0) {
+      c->errors++;
+    }
+  }
+  return 0;
+}
+
+static int collect_values(void *ctx, void *elems, size_t n, int last) {
+  struct collect *c = ctx;
+  long long *values = elems;
+  size_t i;
+
+  c->batches++;
+  c->lasts += last;
+  if (n > c->capacity) {
+    c->errors++;
+  }
+  for (i = 0; i < n; i++) {
+    c->sum += values[i];
+  }
+  c->elements += n;
+  return 0;
+}
+
+static int stop(void *ctx, void *elems, size_t n, int last) {
+  return 1;
+}
+
+void test_gob_batch_structs() {
+  static const size_t chunk_sizes[] = { 1, 7, 100, 4096, 1 << 20 };
+  struct gob_decoder dec;
+  struct gob_batch b;
+  struct gob_builder builder;
+  struct collect c;
+  struct tick ticks[64];
+  char sym[32];
+  char *buf;
+  size_t buf_size = 64 + NUM_TICKS * 16 + 1024;
+  size_t len;
+  size_t pos;
+  size_t n;
+  int i;
+  int k;
+
+  buf = malloc(buf_size);
+  len = encode_feed_types(buf, buf_size);
+  gob_builder_init(&builder, buf + len, buf_size - len);
+  // a message of another type is skipped
+  gob_builder_start_message(&builder, 65);
+  gob_builder_string(&builder, 0, "skipped");
+  gob_builder_end_message(&builder);
+  gob_builder_start_message(&builder, 67);
+  gob_builder_string(&builder, 0, "feed");
+  gob_builder_start_slice(&builder, 1);
+  for (i = 0; i < NUM_TICKS; i++) {
+    snprintf(sym, sizeof(sym), "sym%d", i % 1000);
+    gob_builder_start_struct(&builder, 0);
+    gob_builder_string(&builder, 0, sym);
+    gob_builder_uint(&builder, 1, i);
+    gob_builder_end_struct(&builder);
+  }
+  gob_builder_end_slice(&builder);
+  // a field after the slice
+  gob_builder_int(&builder, 2, NUM_TICKS);
+  CU_ASSERT(gob_builder_end_message(&builder) > 0);
+  len += builder.len;
+  CU_ASSERT(len <= buf_size);
+
+  for (k = 0; k < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); k++) {
+    memset(&c, 0, sizeof(c));
+    c.capacity = 64;
+    CU_ASSERT_EQUAL(0, gob_decoder_init(&dec));
+    CU_ASSERT_EQUAL(0, gob_batch_init(&b, &dec, "Feed", "Ticks", 0, &sTick, ticks, sizeof(struct tick), 64,
+				      collect_ticks, &c));
+    for (pos = 0; pos < len; pos += n) {
+      n = len - pos < chunk_sizes[k] ? len - pos : chunk_sizes[k];
+      CU_ASSERT_FATAL(gob_batch_feed(&b, buf + pos, n) == 0);
+      CU_ASSERT(b.carry_size == GOB_BATCH_CARRY_SIZE);
+    }
+    CU_ASSERT(gob_batch_complete(&b));
+    CU_ASSERT_EQUAL(NUM_TICKS, c.elements);
+    CU_ASSERT_EQUAL(NUM_TICKS, b.elements);
+    CU_ASSERT_EQUAL(1, c.lasts);
+    CU_ASSERT_EQUAL(0, c.errors);
+    // strings are handed over at the end of every chunk
+    CU_ASSERT(c.batches >= NUM_TICKS / 64);
+    gob_batch_destroy(&b);
+    gob_decoder_destroy(&dec);
+  }
+
+  // a definition longer than the carry buffer is kept whole
+  memset(&c, 0, sizeof(c));
+  c.capacity = 64;
+  gob_decoder_init(&dec);
+  gob_batch_init(&b, &dec, "Feed", "Ticks", 0, &sTick, ticks, sizeof(struct tick), 64, collect_ticks, &c);
+  CU_ASSERT_EQUAL(0, gob_batch_carry(&b, 0));
+  for (pos = 0; pos < len; pos += n) {
+    n = len - pos < 5 ? len - pos : 5;
+    CU_ASSERT_FATAL(gob_batch_feed(&b, buf + pos, n) == 0);
+  }
+  CU_ASSERT_EQUAL(NUM_TICKS, c.elements);
+  CU_ASSERT_EQUAL(0, c.errors);
+  gob_batch_destroy(&b);
+  gob_decoder_destroy(&dec);
+
+  // the callback stops the decoder
+  gob_decoder_init(&dec);
+  gob_batch_init(&b, &dec, "Feed", "Ticks", 0, &sTick, ticks, sizeof(struct tick), 64, stop, NULL);
+  errno = 0;
+  CU_ASSERT_EQUAL(-1, gob_batch_feed(&b, buf, len));
+  CU_ASSERT_EQUAL(ECANCELED, errno);
+  CU_ASSERT_EQUAL(-1, gob_batch_feed(&b, buf, len));
+  gob_batch_destroy(&b);
+  gob_decoder_destroy(&dec);
+
+  free(buf);
+}
+
+// A top-level value of slice type id.
+static size_t encode_values(char *buf, size_t buf_size, int id, int n) {
+  size_t len;
+  int i;
+
+  len = gob_start_message(buf, buf_size, id);
+  len += gob_encode_unsigned_int(buf+len, buf_size-len, 0);
+  len += gob_start_slice(buf+len, buf_size-len, n);
+  for (i = 0; i < n; i++) {
+    // values of all sizes
+    len += gob_encode_long_long(buf+len, buf_size-len, (i % 2 ? -1 : 1) * (1LL << (i % 63)));
+  }
+  len += gob_end_slice(buf+len, buf_size-len);
+  return gob_end_message(buf, buf_size, len);
+}
+
+void test_gob_batch_values() {
+  struct gob_decoder dec;
+  struct gob_batch b;
+  struct collect c;
+  long long values[100];
+  struct gob_string strings[4];
+  char text[100];
+  long long sum = 0;
+  char *buf;
+  size_t buf_size = 64 + NUM_VALUES * 10;
+  size_t len;
+  size_t pos;
+  size_t n;
+  int i;
+
+  buf = malloc(buf_size);
+  len = gob_start_type_definition(buf, buf_size, 65, GOB_SLICETYPE_ID);
+  len += gob_encode_slice_type(buf+len, buf_size-len, "Values", 65, GOB_INT_ID);
+  len += gob_end_type_definition(buf+len, buf_size-len);
+  len = gob_end_message(buf, buf_size, len);
+  len += encode_values(buf + len, buf_size - len, 65, NUM_VALUES);
+  // an empty slice
+  len += encode_values(buf + len, buf_size - len, 65, 0);
+  CU_ASSERT(len <= buf_size);
+  for (i = 0; i < NUM_VALUES; i++) {
+    sum += (i % 2 ? -1 : 1) * (1LL << (i % 63));
+  }
+
+  memset(&c, 0, sizeof(c));
+  c.capacity = 100;
+  gob_decoder_init(&dec);
+  gob_batch_init(&b, &dec, "Values", NULL, GOB_LOCAL_INT, NULL, values, sizeof(long long), 100,
+		 collect_values, &c);
+  for (pos = 0, n = 1; pos < len; pos += n, n = n % 13 + 1) {
+    n = len - pos < n ? len - pos : n;
+    CU_ASSERT_FATAL(gob_batch_feed(&b, buf + pos, n) == 0);
+  }
+  CU_ASSERT(gob_batch_complete(&b));
+  CU_ASSERT_EQUAL(NUM_VALUES, c.elements);
+  CU_ASSERT_EQUAL(sum, c.sum);
+  CU_ASSERT_EQUAL(2, c.lasts);
+  CU_ASSERT_EQUAL(0, c.errors);
+  // integers are not handed over before the batch is full
+  CU_ASSERT_EQUAL(NUM_VALUES / 100 + 1, c.batches);
+  gob_batch_destroy(&b);
+
+  // a partial message is not complete
+  gob_batch_init(&b, &dec, "Values", NULL, GOB_LOCAL_INT, NULL, values, sizeof(long long), 100,
+		 collect_values, &c);
+  CU_ASSERT_EQUAL(0, gob_batch_feed(&b, buf, len - 1));
+  CU_ASSERT(!gob_batch_complete(&b));
+  gob_batch_destroy(&b);
+
+  // the elements do not decode into strings
+  gob_batch_init(&b, &dec, "Values", NULL, GOB_LOCAL_STRING, NULL, strings, sizeof(struct gob_string), 4,
+		 collect_values, &c);
+  CU_ASSERT_EQUAL(-1, gob_batch_feed(&b, buf, len));
+  gob_batch_destroy(&b);
+  gob_decoder_destroy(&dec);
+
+  // a string longer than the carry buffer, cut off by the end of a chunk
+  len = gob_start_type_definition(buf, buf_size, 65, GOB_SLICETYPE_ID);
+  len += gob_encode_slice_type(buf+len, buf_size-len, "Strings", 65, GOB_STRING_ID);
+  len += gob_end_type_definition(buf+len, buf_size-len);
+  len = gob_end_message(buf, buf_size, len);
+  pos = len;
+  len += gob_start_message(buf+len, buf_size-len, 65);
+  len += gob_encode_unsigned_int(buf+len, buf_size-len, 0);
+  len += gob_start_slice(buf+len, buf_size-len, 1);
+  memset(text, 'x', 99);
+  text[99] = '\0';
+  len += gob_encode_string(buf+len, buf_size-len, text);
+  len = pos + gob_end_message(buf+pos, buf_size-pos, len-pos);
+  gob_decoder_init(&dec);
+  gob_batch_init(&b, &dec, "Strings", NULL, GOB_LOCAL_STRING, NULL, strings, sizeof(struct gob_string), 4,
+		 collect_values, &c);
+  CU_ASSERT_EQUAL(0, gob_batch_carry(&b, 64));
+  errno = 0;
+  CU_ASSERT_EQUAL(-1, gob_batch_feed(&b, buf, len - 10));
+  CU_ASSERT_EQUAL(EMSGSIZE, errno);
+  gob_batch_destroy(&b);
+
+  // whole, it is parsed in place
+  c.elements = 0;
+  gob_batch_init(&b, &dec, "Strings", NULL, GOB_LOCAL_STRING, NULL, strings, sizeof(struct gob_string), 4,
+		 collect_values, &c);
+  CU_ASSERT_EQUAL(0, gob_batch_carry(&b, 64));
+  CU_ASSERT_EQUAL(0, gob_batch_feed(&b, buf, len));
+  CU_ASSERT_EQUAL(1, c.elements);
+  CU_ASSERT_EQUAL(99, strings[0].len);
+  gob_batch_destroy(&b);
+  gob_decoder_destroy(&dec);
+
+  free(buf);
+}
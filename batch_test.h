@@ -0,0 +1,7 @@
+#ifndef _BATCH_TEST_H
+#define _BATCH_TEST_H
+
+void test_gob_batch_structs();
+void test_gob_batch_values();
+
+#endif
@@ -0,0 +1,203 @@
+#include <string.h>
+#include <limits.h>
+
+#include "builder.h"
+#include "stats.h"
+#include "trace.h"
+#include "varint.h"
+
+void gob_builder_init(struct gob_builder *b, char *buf, size_t buf_size) {
+  memset(b, 0, sizeof(struct gob_builder));
+  b->buf = buf;
+  b->buf_size = buf_size;
+}
+
+// Writes n bytes, or only counts them once the buffer is full.
+static inline void gob_builder_put(struct gob_builder *b, const char *bytes, size_t n) {
+  if (b->len <= b->buf_size && n <= b->buf_size - b->len) {
+    memcpy(b->buf + b->len, bytes, n);
+  }
+  b->len += n;
+}
+
+static inline void gob_builder_uvarint(struct gob_builder *b, unsigned long long u) {
+  char bytes[sizeof(unsigned long long)+1];
+
+  if (b->len + sizeof(bytes) <= b->buf_size) {
+    b->len += gob_put_uint(b->buf + b->len, u);
+  } else {
+    gob_builder_put(b, bytes, gob_put_uint(bytes, u));
+  }
+}
+
+// Sends the delta of a struct field, or counts a slice element.  Returns 0 if
+// the value is to be omitted.
+static inline int gob_builder_field(struct gob_builder *b, int field, int zero) {
+  struct gob_builder_frame *f;
+
+  if (b->depth == 0) {
+    b->error = 1;
+    return 0;
+  }
+  f = &b->frames[b->depth - 1];
+  if (f->slice) {
+    f->count++;
+    return 1;
+  }
+  if (zero) {
+    return 0;
+  }
+  if (field <= f->last) {
+    b->error = 1;
+    return 0;
+  }
+  gob_builder_uvarint(b, field - f->last);
+  f->last = field;
+  return 1;
+}
+
+static inline struct gob_builder_frame *gob_builder_push(struct gob_builder *b, int slice) {
+  struct gob_builder_frame *f;
+
+  if (b->depth == GOB_BUILDER_MAX_DEPTH) {
+    b->error = 1;
+    return NULL;
+  }
+  f = &b->frames[b->depth++];
+  f->slice = slice;
+  f->last = -1;
+  return f;
+}
+
+// Writes a count or length into the byte reserved for it at pos, moving the
+// bytes after it if it needs more.
+static void gob_builder_patch(struct gob_builder *b, size_t pos, unsigned long long u) {
+  char bytes[sizeof(unsigned long long)+1];
+  int n = gob_put_uint(bytes, u);
+
+  if (b->len + n - 1 <= b->buf_size) {
+    if (n > 1) {
+      memmove(b->buf + pos + n, b->buf + pos + 1, b->len - (pos + 1));
+    }
+    memcpy(b->buf + pos, bytes, n);
+  }
+  b->len += n - 1;
+}
+
+void gob_builder_start_message(struct gob_builder *b, int id) {
+  GOB_TRACE_MESSAGE_START(id);
+  b->message_start = b->len;
+  b->id = id;
+  b->depth = 0;
+  b->error = 0;
+  gob_builder_put(b, "", 1);
+  gob_builder_uvarint(b, id < 0 ? ((unsigned long long)~id << 1) | 1 : (unsigned long long)id << 1);
+  gob_builder_push(b, 0);
+}
+
+int gob_builder_end_message(struct gob_builder *b) {
+  ssize_t total_size = gob_builder_end_message64(b);
+  return total_size > INT_MAX ? -1 : (int)total_size;
+}
+
+ssize_t gob_builder_end_message64(struct gob_builder *b) {
+  size_t total_size;
+
+  if (b->depth != 1 || b->frames[0].slice) {
+    b->error = 1;
+  }
+  b->depth = 0;
+  gob_builder_put(b, "", 1);
+  gob_builder_patch(b, b->message_start, b->len - b->message_start - 1);
+  total_size = b->len - b->message_start;
+  if (b->len <= b->buf_size) {
+    GOB_STATS_MESSAGE(b->id, total_size);
+    GOB_TRACE_MESSAGE_END(b->id, total_size);
+  }
+  return b->error ? -1 : (ssize_t)total_size;
+}
+
+void gob_builder_int(struct gob_builder *b, int field, long long i) {
+  if (gob_builder_field(b, field, i == 0)) {
+    gob_builder_uvarint(b, i < 0 ? ((unsigned long long)~i << 1) | 1 : (unsigned long long)i << 1);
+  }
+}
+
+void gob_builder_uint(struct gob_builder *b, int field, unsigned long long u) {
+  if (gob_builder_field(b, field, u == 0)) {
+    gob_builder_uvarint(b, u);
+  }
+}
+
+void gob_builder_bool(struct gob_builder *b, int field, int v) {
+  gob_builder_uint(b, field, v != 0);
+}
+
+void gob_builder_double(struct gob_builder *b, int field, double d) {
+  unsigned long long u;
+
+  if (gob_builder_field(b, field, d == 0)) {
+    memcpy(&u, &d, sizeof(u));
+    gob_builder_uvarint(b, __builtin_bswap64(u));
+  }
+}
+
+void gob_builder_string(struct gob_builder *b, int field, const char *s) {
+  gob_builder_bytes(b, field, s, strlen(s));
+}
+
+void gob_builder_bytes(struct gob_builder *b, int field, const char *data, size_t len) {
+  if (gob_builder_field(b, field, len == 0)) {
+    gob_builder_uvarint(b, len);
+    gob_builder_put(b, data, len);
+  }
+}
+
+void gob_builder_start_struct(struct gob_builder *b, int field) {
+  gob_builder_field(b, field, 0);
+  gob_builder_push(b, 0);
+}
+
+void gob_builder_end_struct(struct gob_builder *b) {
+  if (b->depth < 2 || b->frames[b->depth - 1].slice) {
+    b->error = 1;
+    return;
+  }
+  b->depth--;
+  gob_builder_put(b, "", 1);
+}
+
+void gob_builder_start_slice(struct gob_builder *b, int field) {
+  size_t start = b->len;
+  int last = b->depth > 0 ? b->frames[b->depth - 1].last : -1;
+  struct gob_builder_frame *f;
+
+  gob_builder_field(b, field, 0);
+  f = gob_builder_push(b, 1);
+  if (f != NULL) {
+    f->last = last;
+    f->start = start;
+    f->count_pos = b->len;
+    f->count = 0;
+    gob_builder_put(b, "", 1);
+  }
+}
+
+void gob_builder_end_slice(struct gob_builder *b) {
+  struct gob_builder_frame *f;
+  struct gob_builder_frame *parent;
+
+  if (b->depth < 2 || !b->frames[b->depth - 1].slice) {
+    b->error = 1;
+    return;
+  }
+  f = &b->frames[--b->depth];
+  parent = &b->frames[b->depth - 1];
+  if (f->count == 0 && !parent->slice) {
+    // empty slices are omitted from structs
+    b->len = f->start;
+    parent->last = f->last;
+  } else {
+    gob_builder_patch(b, f->count_pos, f->count);
+  }
+}
@@ -0,0 +1,125 @@
+#ifndef _BUILDER_H
+#define _BUILDER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Encoding of value messages by field number.
+ *
+ * A gob_builder keeps track of the nesting of structs and slices, so the
+ * caller names fields by number instead of computing field deltas, and
+ * slices need not be counted in advance:
+ *
+ * \code
+ * gob_builder_init(&b, buf, sizeof(buf));
+ * gob_builder_start_message(&b, my_data_id);
+ * gob_builder_string(&b, 0, "sym");            // MyName
+ * gob_builder_start_slice(&b, 1);              // Fields []FieldData
+ * for (i = 0; i < n; i++) {
+ *   gob_builder_start_struct(&b, 0);           // field numbers are ignored
+ *   gob_builder_double(&b, 0, data[i].f);      //   for slice elements
+ *   gob_builder_int(&b, 1, data[i].i);
+ *   gob_builder_end_struct(&b);
+ * }
+ * gob_builder_end_slice(&b);
+ * len = gob_builder_end_message(&b);
+ * \endcode
+ *
+ * Struct fields with zero values and empty slices are omitted, as Go does;
+ * slice elements are always sent.  Nested structs are always sent.
+ *
+ * The frame stack lives in the builder, which allocates nothing.  Slice
+ * counts and the message length are written into one byte reserved for them
+ * and only if they turn out to need more is anything moved.
+ *
+ * Like the encoders in encode.h, a builder keeps counting when buf is full;
+ * b->len then exceeds the buffer size and the messages must be built again
+ * in a larger buffer.
+ */
+
+/**
+ * The deepest nesting of structs and slices in a message.
+ */
+#define GOB_BUILDER_MAX_DEPTH (16)
+
+struct gob_builder_frame {
+  int slice;                // 1 for a slice, 0 for a struct
+  int last;                 // field number last sent in a struct, or -1
+  size_t start;             // of a slice's field delta, to drop an empty slice
+  size_t count_pos;         // of a slice's count
+  unsigned long long count; // elements of a slice so far
+};
+
+struct gob_builder {
+  char *buf;
+  size_t buf_size;
+  size_t len;               // bytes written, or that would have been
+  size_t message_start;     // of the length prefix of the current message
+  int id;                   // of the current message
+  int depth;                // frames in use, 0 outside of a message
+  int error;                // set by misuse, reported by gob_builder_end_message()
+  struct gob_builder_frame frames[GOB_BUILDER_MAX_DEPTH];
+};
+
+/**
+ * Initializes a builder writing messages one after the other into buf.
+ */
+void gob_builder_init(struct gob_builder *b, char *buf, size_t buf_size);
+
+/**
+ * Starts a value message of struct type id.
+ */
+void gob_builder_start_message(struct gob_builder *b, int id);
+
+/**
+ * Ends the top-level struct and frames the message.
+ *
+ * @return
+ *   The size of the framed message, more than fits into the buffer if it
+ *   overflowed, or -1 if structs and slices were not closed properly, fields
+ *   were not given in increasing order or the nesting is too deep.  Also -1
+ *   for messages of 2 GiB or more, which need gob_builder_end_message64().
+ */
+int gob_builder_end_message(struct gob_builder *b);
+
+/**
+ * gob_builder_end_message() with the size as ssize_t, for messages of any
+ * size.
+ */
+ssize_t gob_builder_end_message64(struct gob_builder *b);
+
+/**
+ * Encode struct field number field, unless it is zero.  In a slice, the
+ * field number is ignored and the value is always encoded.
+ */
+void gob_builder_int(struct gob_builder *b, int field, long long i);
+void gob_builder_uint(struct gob_builder *b, int field, unsigned long long u);
+void gob_builder_bool(struct gob_builder *b, int field, int v);
+void gob_builder_double(struct gob_builder *b, int field, double d);
+void gob_builder_string(struct gob_builder *b, int field, const char *s);
+void gob_builder_bytes(struct gob_builder *b, int field, const char *data, size_t len);
+
+/**
+ * Starts a nested struct in field number field, or as the next element of a
+ * slice.
+ */
+void gob_builder_start_struct(struct gob_builder *b, int field);
+void gob_builder_end_struct(struct gob_builder *b);
+
+/**
+ * Starts a slice (or array) in field number field, or as the next element of
+ * a slice.  The elements follow, and are counted, up to gob_builder_end_slice().
+ */
+void gob_builder_start_slice(struct gob_builder *b, int field);
+void gob_builder_end_slice(struct gob_builder *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
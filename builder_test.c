@@ -0,0 +1,167 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "builder.h"
+#include <stdio.h>
+#include <string.h>
+
+void test_gob_builder_nested() {
+  // The value message of encode_test.c's test_gob_encode_more_complex_type():
+  // MyData{MyName: "sym", Fields: []FieldData{{fFloat: 10.1, iInt: 1000}}}
+  static const char expected[] = {
+    0x19, 0xff, 0x82, 0x01, 0x03, 0x73, 0x79, 0x6d, 0x01, 0x01, 0x01,
+    0xf8, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x24, 0x40, 0x01, 0xfe, 0x07, 0xd0, 0x00, 0x00
+  };
+  struct gob_builder b;
+  char buf[256];
+  int len;
+
+  gob_builder_init(&b, buf, sizeof(buf));
+  gob_builder_start_message(&b, 65);
+  gob_builder_string(&b, 0, "sym");
+  gob_builder_start_slice(&b, 1);
+  gob_builder_start_struct(&b, 0);
+  gob_builder_double(&b, 0, 10.1);
+  gob_builder_int(&b, 1, 1000);
+  gob_builder_end_struct(&b);
+  gob_builder_end_slice(&b);
+  len = gob_builder_end_message(&b);
+  CU_ASSERT_EQUAL(sizeof(expected), len);
+  CU_ASSERT(memcmp(expected, buf, len) == 0);
+
+  // a second message follows the first; zero fields are skipped
+  gob_builder_start_message(&b, 65);
+  gob_builder_string(&b, 0, "");
+  gob_builder_start_slice(&b, 1);
+  gob_builder_start_struct(&b, 0);
+  gob_builder_double(&b, 0, 0);
+  gob_builder_int(&b, 1, 1000);
+  gob_builder_end_struct(&b);
+  gob_builder_end_slice(&b);
+  CU_ASSERT_EQUAL(11, gob_builder_end_message(&b));
+  CU_ASSERT_EQUAL(sizeof(expected) + 11, b.len);
+  CU_ASSERT(memcmp("\x0a\xff\x82\x02\x01\x02\xfe\x07\xd0\x00\x00", buf + sizeof(expected), 11) == 0);
+
+  // too small a buffer: the size is still right, and nothing is written beyond
+  memset(buf, 0x55, sizeof(buf));
+  gob_builder_init(&b, buf, 10);
+  gob_builder_start_message(&b, 65);
+  gob_builder_string(&b, 0, "sym");
+  gob_builder_start_slice(&b, 1);
+  gob_builder_start_struct(&b, 0);
+  gob_builder_double(&b, 0, 10.1);
+  gob_builder_int(&b, 1, 1000);
+  gob_builder_end_struct(&b);
+  gob_builder_end_slice(&b);
+  CU_ASSERT_EQUAL(sizeof(expected), gob_builder_end_message(&b));
+  CU_ASSERT_EQUAL((char)0x55, buf[10]);
+}
+
+// type Series struct { Name string; Values []int; Tags []string; Seq uint }
+static int encode_series(char *buf, size_t buf_size, int n) {
+  int total_bytes = 0;
+  int i;
+  total_bytes += gob_start_message(buf, buf_size, 66);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, buf_size-total_bytes, "series");
+  if (n > 0) {
+    total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+    total_bytes += gob_start_slice(buf+total_bytes, buf_size-total_bytes, n);
+    for (i = 0; i < n; i++) {
+      total_bytes += gob_encode_long_long(buf+total_bytes, buf_size-total_bytes, i % 3 == 0 ? 0 : i * 100);
+    }
+    total_bytes += gob_end_slice(buf+total_bytes, buf_size-total_bytes);
+  }
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, n > 0 ? 2 : 3);
+  total_bytes += gob_encode_unsigned_long_long(buf+total_bytes, buf_size-total_bytes, 7);
+  total_bytes += gob_end_struct(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+void test_gob_builder_slices() {
+  static char expected[4096];
+  static char buf[4096];
+  struct gob_builder b;
+  int expected_len;
+  int errors = 0;
+  int n;
+  int i;
+
+  // slice counts and message lengths of one and more bytes
+  for (n = 0; n < 300; n += 7) {
+    gob_builder_init(&b, buf, sizeof(buf));
+    gob_builder_start_message(&b, 66);
+    gob_builder_string(&b, 0, "series");
+    gob_builder_start_slice(&b, 1);
+    for (i = 0; i < n; i++) {
+      gob_builder_int(&b, 0, i % 3 == 0 ? 0 : i * 100);
+    }
+    gob_builder_end_slice(&b);
+    gob_builder_start_slice(&b, 2);
+    gob_builder_end_slice(&b);
+    gob_builder_uint(&b, 3, 7);
+    expected_len = encode_series(expected, sizeof(expected), n);
+    errors += gob_builder_end_message(&b) != expected_len || memcmp(expected, buf, expected_len) != 0;
+  }
+  CU_ASSERT_EQUAL(0, errors);
+
+  // a slice of slices keeps its empty elements
+  gob_builder_init(&b, buf, sizeof(buf));
+  gob_builder_start_message(&b, 67);
+  gob_builder_start_slice(&b, 0);
+  gob_builder_start_slice(&b, 0);
+  gob_builder_end_slice(&b);
+  gob_builder_start_slice(&b, 0);
+  gob_builder_string(&b, 0, "");
+  gob_builder_end_slice(&b);
+  gob_builder_end_slice(&b);
+  CU_ASSERT_EQUAL(9, gob_builder_end_message(&b));
+  CU_ASSERT(memcmp("\x08\xff\x86\x01\x02\x00\x01\x00\x00", buf, 9) == 0);
+}
+
+void test_gob_builder_errors() {
+  struct gob_builder b;
+  char buf[64];
+  int i;
+
+  gob_builder_init(&b, buf, sizeof(buf));
+  gob_builder_start_message(&b, 65);
+  gob_builder_int(&b, 1, 1);
+  gob_builder_int(&b, 1, 2);
+  CU_ASSERT_EQUAL(-1, gob_builder_end_message(&b));
+
+  gob_builder_start_message(&b, 65);
+  gob_builder_start_struct(&b, 0);
+  CU_ASSERT_EQUAL(-1, gob_builder_end_message(&b));
+
+  gob_builder_start_message(&b, 65);
+  gob_builder_end_slice(&b);
+  CU_ASSERT_EQUAL(-1, gob_builder_end_message(&b));
+
+  gob_builder_start_message(&b, 65);
+  for (i = 0; i < GOB_BUILDER_MAX_DEPTH; i++) {
+    gob_builder_start_struct(&b, 0);
+  }
+  for (i = 0; i < GOB_BUILDER_MAX_DEPTH; i++) {
+    gob_builder_end_struct(&b);
+  }
+  CU_ASSERT_EQUAL(-1, gob_builder_end_message(&b));
+
+  // a message after errors is fine again
+  gob_builder_start_message(&b, 65);
+  gob_builder_int(&b, 2, 1);
+  CU_ASSERT_EQUAL(6, gob_builder_end_message(&b));
+
+  // the size of a message of 2 GiB or more, counted in a small buffer
+  gob_builder_init(&b, buf, sizeof(buf));
+  gob_builder_start_message(&b, 65);
+  gob_builder_bytes(&b, 0, buf, 5000000000ULL);
+  CU_ASSERT_EQUAL(6 + 2 + 1 + 6 + 5000000000LL + 1, gob_builder_end_message64(&b));
+  gob_builder_init(&b, buf, sizeof(buf));
+  gob_builder_start_message(&b, 65);
+  gob_builder_bytes(&b, 0, buf, 5000000000ULL);
+  CU_ASSERT_EQUAL(-1, gob_builder_end_message(&b));
+}
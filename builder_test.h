@@ -0,0 +1,8 @@
+#ifndef _BUILDER_TEST_H
+#define _BUILDER_TEST_H
+
+void test_gob_builder_nested();
+void test_gob_builder_slices();
+void test_gob_builder_errors();
+
+#endif
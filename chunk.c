@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "gob.h"
+#include "encode.h"
+#include "chunk.h"
+#include "varint.h"
+
+#define GOB_CHUNK_SLICE_NONE      (0)
+#define GOB_CHUNK_SLICE_LONG_LONG (1)
+#define GOB_CHUNK_SLICE_ULL       (2)
+#define GOB_CHUNK_SLICE_DOUBLE    (3)
+
+void gob_chunk_init(struct gob_chunk_encoder *enc, char *buf, size_t buf_size) {
+  memset(enc, 0, sizeof(struct gob_chunk_encoder));
+  enc->buf = buf;
+  enc->buf_size = buf == NULL ? 0 : buf_size;
+}
+
+int gob_chunk_pending(const struct gob_chunk_encoder *enc) {
+  return enc->scratch_off < enc->scratch_len || enc->data_len > 0 ||
+    enc->slice_index < enc->slice_len;
+}
+
+// Copies as much of data as fits, returns the number of bytes copied.
+static size_t gob_chunk_copy(struct gob_chunk_encoder *enc, const char *data, size_t len) {
+  if (enc->buf != NULL) {
+    size_t avail = enc->buf_size - enc->len;
+    if (len > avail) {
+      len = avail;
+    }
+    memcpy(enc->buf + enc->len, data, len);
+    enc->len += len;
+  }
+  enc->total += len;
+  return len;
+}
+
+static int gob_chunk_encode_element(char *buf, size_t buf_size, int kind, const void *slice, size_t i) {
+  switch (kind) {
+  case GOB_CHUNK_SLICE_LONG_LONG:
+    return gob_encode_long_long(buf, buf_size, ((const long long*)slice)[i]);
+  case GOB_CHUNK_SLICE_ULL:
+    return gob_encode_unsigned_long_long(buf, buf_size, ((const unsigned long long*)slice)[i]);
+  case GOB_CHUNK_SLICE_DOUBLE:
+  default:
+    return gob_encode_double(buf, buf_size, ((const double*)slice)[i]);
+  }
+}
+
+// Encodes slice elements in place while there is room for the largest
+// element.
+static void gob_chunk_put_elements(struct gob_chunk_encoder *enc) {
+  const long long *ll = enc->slice;
+  const unsigned long long *ull = enc->slice;
+  const double *d = enc->slice;
+  size_t i = enc->slice_index;
+  size_t n = enc->slice_len;
+  size_t len = enc->len;
+  size_t limit;
+
+  if (enc->buf_size - len < GOB_MAX_VARINT_SIZE) {
+    return;
+  }
+  limit = enc->buf_size - GOB_MAX_VARINT_SIZE;
+  switch (enc->slice_kind) {
+  case GOB_CHUNK_SLICE_LONG_LONG:
+    for (; i < n && len <= limit; i++) {
+      len += gob_put_int(enc->buf + len, ll[i]);
+    }
+    break;
+  case GOB_CHUNK_SLICE_ULL:
+    for (; i < n && len <= limit; i++) {
+      len += gob_put_uint(enc->buf + len, ull[i]);
+    }
+    break;
+  case GOB_CHUNK_SLICE_DOUBLE:
+  default:
+    for (; i < n && len <= limit; i++) {
+      len += gob_put_double(enc->buf + len, d[i]);
+    }
+    break;
+  }
+  enc->total += len - enc->len;
+  enc->len = len;
+  enc->slice_index = i;
+}
+
+// Counts the remaining slice elements without encoding them.
+static void gob_chunk_count_elements(struct gob_chunk_encoder *enc) {
+  const long long *ll = enc->slice;
+  const unsigned long long *ull = enc->slice;
+  const double *d = enc->slice;
+  size_t total = 0;
+  size_t i;
+
+  switch (enc->slice_kind) {
+  case GOB_CHUNK_SLICE_LONG_LONG:
+    for (i = enc->slice_index; i < enc->slice_len; i++) {
+      total += gob_uint_size(gob_zigzag(ll[i]));
+    }
+    break;
+  case GOB_CHUNK_SLICE_ULL:
+    for (i = enc->slice_index; i < enc->slice_len; i++) {
+      total += gob_uint_size(ull[i]);
+    }
+    break;
+  case GOB_CHUNK_SLICE_DOUBLE:
+  default:
+    for (i = enc->slice_index; i < enc->slice_len; i++) {
+      total += gob_double_size(d[i]);
+    }
+    break;
+  }
+  enc->total += total;
+  enc->slice_index = enc->slice_len;
+}
+
+// Writes out pending output until it is done or the chunk is full.
+static int gob_chunk_drain(struct gob_chunk_encoder *enc) {
+  size_t n;
+
+  for (;;) {
+    if (enc->scratch_off < enc->scratch_len) {
+      n = gob_chunk_copy(enc, enc->scratch + enc->scratch_off, enc->scratch_len - enc->scratch_off);
+      enc->scratch_off += n;
+      if (enc->scratch_off < enc->scratch_len) {
+	return GOB_CHUNK_FULL;
+      }
+    }
+    if (enc->data_len > 0) {
+      n = gob_chunk_copy(enc, enc->data, enc->data_len);
+      enc->data += n;
+      enc->data_len -= n;
+      if (enc->data_len > 0) {
+	return GOB_CHUNK_FULL;
+      }
+    }
+    if (enc->slice_index >= enc->slice_len) {
+      return GOB_CHUNK_OK;
+    }
+    if (enc->buf != NULL) {
+      gob_chunk_put_elements(enc);
+    } else {
+      gob_chunk_count_elements(enc);
+    }
+    if (enc->slice_index < enc->slice_len) {
+      enc->scratch_len = gob_chunk_encode_element(enc->scratch, GOB_MAX_VARINT_SIZE,
+						  enc->slice_kind, enc->slice, enc->slice_index++);
+      enc->scratch_off = 0;
+    }
+  }
+}
+
+int gob_chunk_next(struct gob_chunk_encoder *enc, char *buf, size_t buf_size) {
+  enc->buf = buf;
+  enc->buf_size = buf == NULL ? 0 : buf_size;
+  enc->len = 0;
+  return gob_chunk_drain(enc);
+}
+
+// Places an encoded number (at most GOB_MAX_VARINT_SIZE bytes) in scratch
+// and starts writing it out.
+static int gob_chunk_put_scratch(struct gob_chunk_encoder *enc, size_t len) {
+  enc->scratch_len = len;
+  enc->scratch_off = 0;
+  return gob_chunk_drain(enc);
+}
+
+int gob_chunk_unsigned_long_long(struct gob_chunk_encoder *enc, unsigned long long ull) {
+  if (gob_chunk_pending(enc)) {
+    return GOB_CHUNK_BUSY;
+  }
+  return gob_chunk_put_scratch(enc, gob_encode_unsigned_long_long(enc->scratch, GOB_MAX_VARINT_SIZE, ull));
+}
+
+int gob_chunk_long_long(struct gob_chunk_encoder *enc, long long i) {
+  if (gob_chunk_pending(enc)) {
+    return GOB_CHUNK_BUSY;
+  }
+  return gob_chunk_put_scratch(enc, gob_encode_long_long(enc->scratch, GOB_MAX_VARINT_SIZE, i));
+}
+
+int gob_chunk_int(struct gob_chunk_encoder *enc, int i) {
+  return gob_chunk_long_long(enc, i);
+}
+
+int gob_chunk_boolean(struct gob_chunk_encoder *enc, int b) {
+  return gob_chunk_unsigned_long_long(enc, b != 0);
+}
+
+int gob_chunk_double(struct gob_chunk_encoder *enc, double d) {
+  if (gob_chunk_pending(enc)) {
+    return GOB_CHUNK_BUSY;
+  }
+  return gob_chunk_put_scratch(enc, gob_encode_double(enc->scratch, GOB_MAX_VARINT_SIZE, d));
+}
+
+int gob_chunk_start_message(struct gob_chunk_encoder *enc, size_t body_len) {
+  return gob_chunk_unsigned_long_long(enc, body_len);
+}
+
+int gob_chunk_start_slice(struct gob_chunk_encoder *enc, size_t size) {
+  return gob_chunk_unsigned_long_long(enc, size);
+}
+
+int gob_chunk_end_struct(struct gob_chunk_encoder *enc) {
+  return gob_chunk_unsigned_long_long(enc, 0);
+}
+
+int gob_chunk_raw(struct gob_chunk_encoder *enc, const void *data, size_t len) {
+  if (gob_chunk_pending(enc)) {
+    return GOB_CHUNK_BUSY;
+  }
+  enc->data = data;
+  enc->data_len = len;
+  return gob_chunk_drain(enc);
+}
+
+int gob_chunk_bytes(struct gob_chunk_encoder *enc, const void *data, size_t len) {
+  if (gob_chunk_pending(enc)) {
+    return GOB_CHUNK_BUSY;
+  }
+  enc->scratch_len = gob_encode_unsigned_long_long(enc->scratch, GOB_MAX_VARINT_SIZE, len);
+  enc->scratch_off = 0;
+  enc->data = data;
+  enc->data_len = len;
+  return gob_chunk_drain(enc);
+}
+
+int gob_chunk_string(struct gob_chunk_encoder *enc, const char *s) {
+  return gob_chunk_bytes(enc, s, strlen(s));
+}
+
+static int gob_chunk_slice(struct gob_chunk_encoder *enc, int kind, const void *v, size_t n) {
+  if (gob_chunk_pending(enc)) {
+    return GOB_CHUNK_BUSY;
+  }
+  enc->scratch_len = gob_encode_unsigned_long_long(enc->scratch, GOB_MAX_VARINT_SIZE, n);
+  enc->scratch_off = 0;
+  enc->slice_kind = kind;
+  enc->slice = v;
+  enc->slice_index = 0;
+  enc->slice_len = n;
+  return gob_chunk_drain(enc);
+}
+
+int gob_chunk_long_long_slice(struct gob_chunk_encoder *enc, const long long *v, size_t n) {
+  return gob_chunk_slice(enc, GOB_CHUNK_SLICE_LONG_LONG, v, n);
+}
+
+int gob_chunk_unsigned_long_long_slice(struct gob_chunk_encoder *enc, const unsigned long long *v, size_t n) {
+  return gob_chunk_slice(enc, GOB_CHUNK_SLICE_ULL, v, n);
+}
+
+int gob_chunk_double_slice(struct gob_chunk_encoder *enc, const double *v, size_t n) {
+  return gob_chunk_slice(enc, GOB_CHUNK_SLICE_DOUBLE, v, n);
+}
@@ -0,0 +1,169 @@
+#ifndef _CHUNK_H
+#define _CHUNK_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Resumable encoding into fixed-size output chunks.
+ *
+ * The functions in encode.h need the whole message to fit into one buffer.
+ * A gob_chunk_encoder instead writes into a chunk of any size, and when the
+ * chunk is full it keeps the rest of the current operation (the tail of a
+ * string, the remaining elements of a slice) and returns GOB_CHUNK_FULL.  The
+ * caller then passes the filled chunk on, hands the encoder an empty chunk
+ * with gob_chunk_next() and carries on where it stopped:
+ *
+ * \code
+ * struct gob_chunk_encoder enc;
+ * gob_chunk_init(&enc, chunk, sizeof(chunk));
+ * ...
+ * rc = gob_chunk_string(&enc, s);
+ * while (rc == GOB_CHUNK_FULL) {
+ *   write(fd, chunk, enc.len);
+ *   rc = gob_chunk_next(&enc, chunk, sizeof(chunk));
+ * }
+ * \endcode
+ *
+ * Gob messages are prefixed with their length.  Initializing the encoder
+ * with a NULL chunk makes it count bytes only (it is never full), so running
+ * the same encoding code once in counting mode yields the body length to
+ * pass to gob_chunk_start_message().
+ */
+
+/**
+ * The largest number of bytes an encoded unsigned integer takes up.
+ */
+#define GOB_MAX_VARINT_SIZE (sizeof(unsigned long long)+1)
+
+/**
+ * Everything was written to the chunk.
+ */
+#define GOB_CHUNK_OK (0)
+
+/**
+ * The chunk is full.  The operation has been accepted; the rest of it is
+ * written by gob_chunk_next().
+ */
+#define GOB_CHUNK_FULL (1)
+
+/**
+ * An operation was started while the previous one was still pending.  The
+ * operation has not been accepted.
+ */
+#define GOB_CHUNK_BUSY (-1)
+
+struct gob_chunk_encoder {
+  char *buf;          // the current chunk, NULL when counting
+  size_t buf_size;    // size of the current chunk
+  size_t len;         // bytes written to the current chunk
+  size_t total;       // bytes produced since gob_chunk_init()
+
+  // pending output, in order: scratch, data, slice elements
+  char scratch[GOB_MAX_VARINT_SIZE];
+  size_t scratch_len;
+  size_t scratch_off;
+  const char *data;
+  size_t data_len;
+  int slice_kind;
+  const void *slice;
+  size_t slice_index;
+  size_t slice_len;
+};
+
+/**
+ * Initializes the encoder.
+ *
+ * @param enc
+ *   The encoder to initialize.
+ * @param buf
+ *   The first output chunk, or NULL to only count the bytes encoded.
+ * @param buf_size
+ *   The size of the output chunk.
+ */
+void gob_chunk_init(struct gob_chunk_encoder *enc, char *buf, size_t buf_size);
+
+/**
+ * Continues a suspended operation in a new chunk.
+ *
+ * @param enc
+ *   The encoder.
+ * @param buf
+ *   The next output chunk.  It may be the previous chunk once its contents
+ *   have been consumed.
+ * @param buf_size
+ *   The size of the output chunk.
+ *
+ * @return
+ *   GOB_CHUNK_OK if the pending operation is complete, GOB_CHUNK_FULL if the
+ *   new chunk has been filled up as well.
+ */
+int gob_chunk_next(struct gob_chunk_encoder *enc, char *buf, size_t buf_size);
+
+/**
+ * Returns non-zero if part of an operation is still waiting for a chunk.
+ */
+int gob_chunk_pending(const struct gob_chunk_encoder *enc);
+
+///////////////////////////////////////////////////////////////////////////////
+// Operations
+//
+// All operations encode exactly as their counterparts in encode.h and return
+// GOB_CHUNK_OK, GOB_CHUNK_FULL or GOB_CHUNK_BUSY.
+
+/**
+ * Encodes the length prefix of a message of body_len bytes.  The body
+ * follows, starting with the type id.
+ */
+int gob_chunk_start_message(struct gob_chunk_encoder *enc, size_t body_len);
+
+int gob_chunk_unsigned_long_long(struct gob_chunk_encoder *enc, unsigned long long ull);
+int gob_chunk_long_long(struct gob_chunk_encoder *enc, long long i);
+int gob_chunk_int(struct gob_chunk_encoder *enc, int i);
+int gob_chunk_boolean(struct gob_chunk_encoder *enc, int b);
+int gob_chunk_double(struct gob_chunk_encoder *enc, double d);
+
+/**
+ * Encodes a zero-terminated string.  The string must stay valid until the
+ * operation completes.
+ */
+int gob_chunk_string(struct gob_chunk_encoder *enc, const char *s);
+
+/**
+ * Encodes a byte slice (length followed by the bytes).  The bytes must stay
+ * valid until the operation completes.
+ */
+int gob_chunk_bytes(struct gob_chunk_encoder *enc, const void *data, size_t len);
+
+/**
+ * Copies already encoded bytes, e.g. a type definition, verbatim.  The bytes
+ * must stay valid until the operation completes.
+ */
+int gob_chunk_raw(struct gob_chunk_encoder *enc, const void *data, size_t len);
+
+/**
+ * Encodes a slice count, see gob_start_slice().
+ */
+int gob_chunk_start_slice(struct gob_chunk_encoder *enc, size_t size);
+
+/**
+ * Encodes the end-of-struct mark, see gob_end_struct().
+ */
+int gob_chunk_end_struct(struct gob_chunk_encoder *enc);
+
+/**
+ * Encodes a whole slice of integers (count followed by the elements).  The
+ * array must stay valid until the operation completes.
+ */
+int gob_chunk_long_long_slice(struct gob_chunk_encoder *enc, const long long *v, size_t n);
+int gob_chunk_unsigned_long_long_slice(struct gob_chunk_encoder *enc, const unsigned long long *v, size_t n);
+int gob_chunk_double_slice(struct gob_chunk_encoder *enc, const double *v, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
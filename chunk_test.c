@@ -0,0 +1,155 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "chunk.h"
+#include <stdio.h>
+#include <string.h>
+
+// Runs one operation to completion, appending every filled chunk to out.
+static int run_op(struct gob_chunk_encoder *enc, int rc, char *chunk, size_t chunk_size,
+		  char *out, size_t *out_len) {
+  while (rc == GOB_CHUNK_FULL) {
+    CU_ASSERT_EQUAL(chunk_size, enc->len);
+    memcpy(out + *out_len, chunk, enc->len);
+    *out_len += enc->len;
+    rc = gob_chunk_next(enc, chunk, chunk_size);
+  }
+  return rc;
+}
+
+// The MyData value from test_gob_encode_more_complex_type().
+static void encode_my_data(struct gob_chunk_encoder *enc, char *chunk, size_t chunk_size,
+			   char *out, size_t *out_len, size_t body_len) {
+  if (body_len != 0) {
+    CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_start_message(enc, body_len), chunk, chunk_size, out, out_len));
+  }
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_int(enc, 65), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_unsigned_long_long(enc, 1), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_string(enc, "sym"), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_unsigned_long_long(enc, 1), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_start_slice(enc, 1), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_unsigned_long_long(enc, 1), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_double(enc, 10.1), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_unsigned_long_long(enc, 1), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_int(enc, 1000), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_end_struct(enc), chunk, chunk_size, out, out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(enc, gob_chunk_end_struct(enc), chunk, chunk_size, out, out_len));
+}
+
+void test_gob_chunk_message() {
+  char result_buf[] = {
+    0x19,   // msg len
+    0xff, 0x82, // id
+    0x01,   // offset symbol
+    0x03,   // string len
+    0x73, 0x79, 0x6d, // "sym"
+    0x01,   // offset of FieldData array
+    0x01,   // length 1
+    0x01,   // offset of fFloat
+    0xf8, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x24, 0x40, // fFloat
+    0x01,   // offset of iInt
+    0xfe, 0x07, 0xd0, // iInt
+    0x00,   // end of struct fieldData
+    0x00   // end of struct MyData
+  };
+  struct gob_chunk_encoder enc;
+  char out[1024];
+  char chunk[16];
+  size_t out_len = 0;
+  size_t chunk_size;
+
+  // counting pass
+  gob_chunk_init(&enc, NULL, 0);
+  encode_my_data(&enc, NULL, 0, out, &out_len, 0);
+  CU_ASSERT_EQUAL(25, enc.total);
+  CU_ASSERT_EQUAL(0, out_len);
+
+  for (chunk_size = 1; chunk_size <= sizeof(chunk); chunk_size++) {
+    memset(out, '\0', sizeof(out));
+    out_len = 0;
+    gob_chunk_init(&enc, chunk, chunk_size);
+    encode_my_data(&enc, chunk, chunk_size, out, &out_len, 25);
+    memcpy(out + out_len, chunk, enc.len);
+    out_len += enc.len;
+    CU_ASSERT_EQUAL(sizeof(result_buf), out_len);
+    CU_ASSERT_EQUAL(sizeof(result_buf), enc.total);
+    CU_ASSERT(memcmp(result_buf, out, sizeof(result_buf)) == 0);
+  }
+}
+
+void test_gob_chunk_slices() {
+  long long values[1000];
+  char expected[16384];
+  char out[16384];
+  char chunk[7];
+  char big_chunk[256];
+  double doubles[1000];
+  struct gob_chunk_encoder enc;
+  size_t chunk_size;
+  size_t expected_len = 0;
+  size_t out_len = 0;
+  size_t i;
+  char long_string[3000];
+
+  for (i = 0; i < 1000; i++) {
+    values[i] = (long long)i * i * i * (i % 2 ? -1 : 1);
+  }
+  memset(long_string, 'x', sizeof(long_string)-1);
+  long_string[sizeof(long_string)-1] = '\0';
+
+  expected_len += gob_start_slice(expected, sizeof(expected), 1000);
+  for (i = 0; i < 1000; i++) {
+    expected_len += gob_encode_long_long(expected + expected_len, sizeof(expected) - expected_len, values[i]);
+  }
+  expected_len += gob_encode_string(expected + expected_len, sizeof(expected) - expected_len, long_string);
+
+  gob_chunk_init(&enc, chunk, sizeof(chunk));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(&enc, gob_chunk_long_long_slice(&enc, values, 1000), chunk, sizeof(chunk), out, &out_len));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(&enc, gob_chunk_string(&enc, long_string), chunk, sizeof(chunk), out, &out_len));
+  memcpy(out + out_len, chunk, enc.len);
+  out_len += enc.len;
+
+  CU_ASSERT_EQUAL(expected_len, out_len);
+  CU_ASSERT(memcmp(expected, out, expected_len) == 0);
+
+  // chunks with room for many elements, and counting only
+  for (chunk_size = 9; chunk_size <= sizeof(big_chunk); chunk_size += 13) {
+    out_len = 0;
+    gob_chunk_init(&enc, big_chunk, chunk_size);
+    CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(&enc, gob_chunk_long_long_slice(&enc, values, 1000), big_chunk, chunk_size, out, &out_len));
+    CU_ASSERT_EQUAL(GOB_CHUNK_OK, run_op(&enc, gob_chunk_string(&enc, long_string), big_chunk, chunk_size, out, &out_len));
+    memcpy(out + out_len, big_chunk, enc.len);
+    out_len += enc.len;
+    CU_ASSERT_EQUAL(expected_len, out_len);
+    CU_ASSERT(memcmp(expected, out, expected_len) == 0);
+  }
+  gob_chunk_init(&enc, NULL, 0);
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, gob_chunk_long_long_slice(&enc, values, 1000));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, gob_chunk_string(&enc, long_string));
+  CU_ASSERT_EQUAL(expected_len, enc.total);
+  for (i = 0; i < 1000; i++) {
+    doubles[i] = values[i] / 3.0;
+  }
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, gob_chunk_double_slice(&enc, doubles, 1000));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, gob_chunk_unsigned_long_long_slice(&enc, (const unsigned long long*)values, 1000));
+  CU_ASSERT_EQUAL(expected_len + gob_encode_double_slice(out, sizeof(out), doubles, 1000) +
+		  gob_encode_unsigned_long_long_slice(out, sizeof(out), (const unsigned long long*)values, 1000),
+		  enc.total);
+}
+
+void test_gob_chunk_busy() {
+  struct gob_chunk_encoder enc;
+  char chunk[4];
+
+  gob_chunk_init(&enc, chunk, sizeof(chunk));
+  CU_ASSERT_EQUAL(GOB_CHUNK_FULL, gob_chunk_string(&enc, "hello"));
+  CU_ASSERT(gob_chunk_pending(&enc));
+  CU_ASSERT_EQUAL(GOB_CHUNK_BUSY, gob_chunk_int(&enc, 1));
+  CU_ASSERT_EQUAL(GOB_CHUNK_OK, gob_chunk_next(&enc, chunk, sizeof(chunk)));
+  CU_ASSERT_EQUAL(2, enc.len);
+  CU_ASSERT(memcmp("lo", chunk, 2) == 0);
+  CU_ASSERT(!gob_chunk_pending(&enc));
+}
@@ -0,0 +1,8 @@
+#ifndef _CHUNK_TEST_H
+#define _CHUNK_TEST_H
+
+void test_gob_chunk_message();
+void test_gob_chunk_slices();
+void test_gob_chunk_busy();
+
+#endif
@@ -0,0 +1,492 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+#include "gob.h"
+#include "decode.h"
+#include "columns.h"
+#include "cpu.h"
+#include "stats.h"
+#include "trace.h"
+#include "varint.h"
+
+// Finds the struct type named dec->type_name in the registry.
+static void gob_columns_find_type(struct gob_columns *dec) {
+  const struct gob_type *t;
+  int id;
+
+  for (id = GOB_FIRST_USER_ID; id < dec->types->size; id++) {
+    t = gob_types_lookup(dec->types, id);
+    if (t != NULL && t->kind == GOB_KIND_STRUCT && t->name != NULL && strcmp(t->name, dec->type_name) == 0) {
+      dec->type_id = id;
+      return;
+    }
+  }
+}
+
+int gob_columns_init(struct gob_columns *dec, struct gob_types *types, const char *type_name,
+		     struct gob_column *columns, int ncolumns, size_t capacity) {
+  memset(dec, 0, sizeof(struct gob_columns));
+  dec->types = types;
+  dec->type_name = type_name;
+  dec->columns = columns;
+  dec->ncolumns = ncolumns;
+  dec->capacity = capacity;
+  gob_columns_find_type(dec);
+  gob_columns_clear(dec);
+  return 0;
+}
+
+void gob_columns_destroy(struct gob_columns *dec) {
+  free(dec->field_columns);
+  dec->field_columns = NULL;
+  dec->nfields = 0;
+}
+
+void gob_columns_clear(struct gob_columns *dec) {
+  int i;
+
+  dec->rows = 0;
+  for (i = 0; i < dec->ncolumns; i++) {
+    dec->columns[i].data_len = 0;
+    if (dec->columns[i].type == GOB_COLUMN_STRING) {
+      ((size_t*)dec->columns[i].values)[0] = 0;
+    }
+  }
+}
+
+// Maps the fields of the struct to columns.
+static int gob_columns_resolve(struct gob_columns *dec) {
+  const struct gob_type *t = gob_types_lookup(dec->types, dec->type_id);
+  const struct gob_type *ft;
+  int *field_columns;
+  int found;
+  int kind;
+  int i;
+  int j;
+
+  if (t == NULL || t->kind != GOB_KIND_STRUCT || t->nfields == 0) {
+    return -1;
+  }
+  field_columns = malloc(t->nfields * sizeof(int));
+  if (field_columns == NULL) {
+    return -1;
+  }
+  for (j = 0; j < t->nfields; j++) {
+    field_columns[j] = -1;
+  }
+  for (i = 0; i < dec->ncolumns; i++) {
+    found = 0;
+    for (j = 0; j < t->nfields; j++) {
+      if (strcmp(t->fields[j].name, dec->columns[i].name) != 0) {
+	continue;
+      }
+      ft = gob_types_lookup(dec->types, t->fields[j].id);
+      kind = ft != NULL ? ft->kind : 0;
+      switch (dec->columns[i].type) {
+      case GOB_COLUMN_INT:
+	found = kind == GOB_KIND_INT;
+	break;
+      case GOB_COLUMN_UINT:
+	found = kind == GOB_KIND_UINT || kind == GOB_KIND_BOOL;
+	break;
+      case GOB_COLUMN_DOUBLE:
+	found = kind == GOB_KIND_FLOAT;
+	break;
+      case GOB_COLUMN_STRING:
+	found = kind == GOB_KIND_STRING || kind == GOB_KIND_BYTES;
+	break;
+      }
+      field_columns[j] = i;
+      break;
+    }
+    if (!found) {
+      free(field_columns);
+      return -1;
+    }
+  }
+  free(dec->field_columns);
+  dec->field_columns = field_columns;
+  dec->nfields = t->nfields;
+  return 0;
+}
+
+// Decodes one message into the next row.  Returns 1 if done, 0 if a string
+// column's data is full and -1 if the message is malformed.
+static int gob_columns_row(struct gob_columns *dec, const char *buf, size_t buf_size) {
+  const struct gob_type *t = &dec->types->types[dec->type_id];
+  struct gob_column *col;
+  size_t row = dec->rows;
+  size_t pos = 0;
+  unsigned long long delta;
+  const char *data;
+  size_t len;
+  int field = -1;
+  int num_bytes;
+  int i;
+
+  // omitted fields read as zero values
+  for (i = 0; i < dec->ncolumns; i++) {
+    col = &dec->columns[i];
+    switch (col->type) {
+    case GOB_COLUMN_INT:
+      ((long long*)col->values)[row] = 0;
+      break;
+    case GOB_COLUMN_UINT:
+      ((unsigned long long*)col->values)[row] = 0;
+      break;
+    case GOB_COLUMN_DOUBLE:
+      ((double*)col->values)[row] = 0;
+      break;
+    case GOB_COLUMN_STRING:
+      ((size_t*)col->values)[row + 1] = col->data_len;
+      break;
+    }
+    if (col->present != NULL) {
+      col->present[row / 8] &= ~(1 << (row % 8));
+    }
+  }
+
+  for (;;) {
+    num_bytes = gob_decode_unsigned_long_long(buf + pos, buf_size - pos, &delta);
+    if (num_bytes < 0 || delta > (unsigned long long)(dec->nfields - 1 - field)) {
+      break;
+    }
+    pos += num_bytes;
+    if (delta == 0) {
+      return pos == buf_size ? 1 : -1;
+    }
+    field += (int)delta;
+    if (dec->field_columns[field] < 0) {
+      num_bytes = gob_skip_value(dec->types, t->fields[field].id, buf + pos, buf_size - pos);
+    } else {
+      col = &dec->columns[dec->field_columns[field]];
+      switch (col->type) {
+      case GOB_COLUMN_INT:
+	num_bytes = gob_decode_long_long(buf + pos, buf_size - pos, &((long long*)col->values)[row]);
+	break;
+      case GOB_COLUMN_UINT:
+	num_bytes = gob_decode_unsigned_long_long(buf + pos, buf_size - pos,
+						  &((unsigned long long*)col->values)[row]);
+	break;
+      case GOB_COLUMN_DOUBLE:
+	num_bytes = gob_decode_double(buf + pos, buf_size - pos, &((double*)col->values)[row]);
+	break;
+      default:
+	num_bytes = gob_decode_bytes(buf + pos, buf_size - pos, &data, &len);
+	if (num_bytes >= 0) {
+	  if (len > col->data_size - col->data_len) {
+	    // undo the strings of this row
+	    for (i = 0; i < dec->ncolumns; i++) {
+	      if (dec->columns[i].type == GOB_COLUMN_STRING) {
+		dec->columns[i].data_len = ((size_t*)dec->columns[i].values)[row];
+	      }
+	    }
+	    return 0;
+	  }
+	  memcpy(col->data + col->data_len, data, len);
+	  col->data_len += len;
+	  ((size_t*)col->values)[row + 1] = col->data_len;
+	}
+	break;
+      }
+      if (col->present != NULL) {
+	col->present[row / 8] |= 1 << (row % 8);
+      }
+    }
+    if (num_bytes < 0) {
+      break;
+    }
+    pos += num_bytes;
+  }
+  for (i = 0; i < dec->ncolumns; i++) {
+    if (dec->columns[i].type == GOB_COLUMN_STRING) {
+      dec->columns[i].data_len = ((size_t*)dec->columns[i].values)[row];
+    }
+  }
+  return -1;
+}
+
+long gob_columns_decode(struct gob_columns *dec, const char *buf, size_t buf_size) {
+  const char *body;
+  size_t body_len;
+  size_t pos = 0;
+  int len = 0;
+  int id;
+  int ok;
+
+  while (dec->rows < dec->capacity &&
+	 (len = gob_decode_message(buf + pos, buf_size - pos, &id, &body, &body_len)) > 0) {
+    if (id < 0) {
+      if (gob_types_define(dec->types, -id, body, body_len) != (int)body_len) {
+	return -1;
+      }
+      if (-id == dec->type_id) {
+	dec->nfields = 0;
+      } else if (dec->type_id == 0) {
+	gob_columns_find_type(dec);
+      }
+    } else if (id == dec->type_id) {
+      if (dec->nfields == 0 && gob_columns_resolve(dec) < 0) {
+	return -1;
+      }
+      ok = gob_columns_row(dec, body, body_len);
+      if (ok < 0) {
+	return -1;
+      }
+      if (ok == 0) {
+	if (dec->rows == 0) {
+	  errno = ENOSPC;
+	  return -1;
+	}
+	break;
+      }
+      dec->rows++;
+    }
+    pos += len;
+  }
+  return len < 0 ? -1 : (long)pos;
+}
+
+// Rows whose zero values are found in one go.
+#define GOB_COLUMNS_BLOCK (256)
+
+// Sets bit of sent[r] for every row r of a 64-bit column that is not zero.
+// Doubles compare as numbers, so -0.0 is omitted as Go does.  The vector
+// variants do the rows they can and return where they stopped.
+static void gob_columns_nonzero_rows(const void *values, int is_double, int bit, size_t i, size_t n,
+				     unsigned long long *sent) {
+  const unsigned long long *u = values;
+  const double *d = values;
+
+  for (; i < n; i++) {
+    sent[i] |= (unsigned long long)(is_double ? d[i] != 0 : u[i] != 0) << bit;
+  }
+}
+
+// Sets bit of sent[i], sent[i+1], ... by the bits of zero, which are set
+// for rows that are zero.
+static inline void gob_columns_unzero(unsigned int zero, int bit, size_t i, int lanes,
+				      unsigned long long *sent) {
+  int k;
+  for (k = 0; k < lanes; k++) {
+    sent[i + k] |= (unsigned long long)((~zero >> k) & 1) << bit;
+  }
+}
+
+#ifdef __x86_64__
+static size_t gob_columns_nonzero_sse2(const void *values, int is_double, int bit, size_t n,
+				       unsigned long long *sent) {
+  const unsigned long long *u = values;
+  const double *d = values;
+  __m128i zi = _mm_setzero_si128();
+  __m128d zd = _mm_setzero_pd();
+  __m128i v;
+  size_t i;
+
+  for (i = 0; i + 2 <= n; i += 2) {
+    if (is_double) {
+      gob_columns_unzero(_mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(d + i), zd)), bit, i, 2, sent);
+    } else {
+      // 64-bit lanes are zero if both of their 32-bit halves are
+      v = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(u + i)), zi);
+      v = _mm_and_si128(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+      gob_columns_unzero(_mm_movemask_pd(_mm_castsi128_pd(v)), bit, i, 2, sent);
+    }
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+static size_t gob_columns_nonzero_avx2(const void *values, int is_double, int bit, size_t n,
+				       unsigned long long *sent) {
+  const unsigned long long *u = values;
+  const double *d = values;
+  __m256i zi = _mm256_setzero_si256();
+  __m256d zd = _mm256_setzero_pd();
+  __m256i v;
+  size_t i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    if (is_double) {
+      gob_columns_unzero(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(d + i), zd, _CMP_EQ_OQ)),
+			 bit, i, 4, sent);
+    } else {
+      v = _mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i*)(u + i)), zi);
+      gob_columns_unzero(_mm256_movemask_pd(_mm256_castsi256_pd(v)), bit, i, 4, sent);
+    }
+  }
+  return i;
+}
+
+__attribute__((target("avx512f")))
+static size_t gob_columns_nonzero_avx512(const void *values, int is_double, int bit, size_t n,
+					 unsigned long long *sent) {
+  const unsigned long long *u = values;
+  const double *d = values;
+  __m512i zi = _mm512_setzero_si512();
+  __m512d zd = _mm512_setzero_pd();
+  size_t i;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    if (is_double) {
+      gob_columns_unzero(_mm512_cmp_pd_mask(_mm512_loadu_pd(d + i), zd, _CMP_EQ_OQ), bit, i, 8, sent);
+    } else {
+      gob_columns_unzero(_mm512_cmpeq_epi64_mask(_mm512_loadu_si512(u + i), zi), bit, i, 8, sent);
+    }
+  }
+  return i;
+}
+#endif
+
+static void gob_columns_nonzero(const void *values, int is_double, int bit, size_t n,
+				unsigned long long *sent, int features) {
+  size_t i = 0;
+#ifdef __x86_64__
+  if (features & GOB_CPU_AVX512) {
+    i = gob_columns_nonzero_avx512(values, is_double, bit, n, sent);
+  } else if (features & GOB_CPU_AVX2) {
+    i = gob_columns_nonzero_avx2(values, is_double, bit, n, sent);
+  } else if (features & GOB_CPU_SSE2) {
+    i = gob_columns_nonzero_sse2(values, is_double, bit, n, sent);
+  }
+#endif
+  gob_columns_nonzero_rows(values, is_double, bit, i, n, sent);
+}
+
+static void gob_columns_nonempty(const size_t *offsets, int bit, size_t n, unsigned long long *sent) {
+  size_t i;
+  for (i = 0; i < n; i++) {
+    sent[i] |= (unsigned long long)(offsets[i + 1] != offsets[i]) << bit;
+  }
+}
+
+// The body of gob_columns_encode(), compiled once per variant, which
+// differ in the instructions the varints are encoded with.
+static inline __attribute__((always_inline))
+long gob_columns_encode_rows(char *buf, size_t buf_size, int id, const struct gob_column *columns, int ncolumns,
+			     size_t first, size_t rows, size_t *rows_encoded, int features) {
+  unsigned long long sent[GOB_COLUMNS_BLOCK];
+  unsigned long long bits;
+  const struct gob_column *col;
+  const size_t *offsets;
+  char prefix[sizeof(unsigned long long)+1];
+  char id_bytes[sizeof(unsigned long long)+1];
+  int id_len = gob_put_int(id_bytes, id);
+  size_t string_len = 0;
+  size_t pos = 0;
+  size_t block;
+  size_t row;
+  size_t n;
+  size_t len;
+  char *p;
+  int prefix_len;
+  int last;
+  int c;
+
+  *rows_encoded = 0;
+  if (ncolumns > GOB_COLUMNS_MAX_ENCODE) {
+    return -1;
+  }
+  for (block = 0; block < rows; block += n) {
+    n = rows - block < GOB_COLUMNS_BLOCK ? rows - block : GOB_COLUMNS_BLOCK;
+    memset(sent, 0, n * sizeof(unsigned long long));
+    for (c = 0; c < ncolumns; c++) {
+      col = &columns[c];
+      if (col->values == NULL) {
+	continue;
+      }
+      if (col->type == GOB_COLUMN_STRING) {
+	gob_columns_nonempty((const size_t*)col->values + first + block, c, n, sent);
+      } else {
+	gob_columns_nonzero((const unsigned long long*)col->values + first + block,
+			    col->type == GOB_COLUMN_DOUBLE, c, n, sent, features);
+      }
+    }
+
+    for (row = 0; row < n; row++) {
+      if (buf_size - pos < 20 + 10 * (size_t)ncolumns) {
+	return pos;
+      }
+      // the body goes after a one byte length prefix, and is moved if it
+      // turns out to need a longer one
+      GOB_TRACE_MESSAGE_START(id);
+      p = buf + pos + 1;
+      memcpy(p, id_bytes, id_len);
+      p += id_len;
+      last = -1;
+      for (bits = sent[row]; bits != 0; bits &= bits - 1) {
+	c = __builtin_ctzll(bits);
+	col = &columns[c];
+	*p++ = (char)(c - last);
+	last = c;
+	switch (col->type) {
+	case GOB_COLUMN_INT:
+	  p += gob_put_int(p, ((const long long*)col->values)[first + block + row]);
+	  break;
+	case GOB_COLUMN_UINT:
+	  p += gob_put_uint(p, ((const unsigned long long*)col->values)[first + block + row]);
+	  break;
+	case GOB_COLUMN_DOUBLE:
+	  p += gob_put_double(p, ((const double*)col->values)[first + block + row]);
+	  break;
+	default:
+	  offsets = (const size_t*)col->values + first + block + row;
+	  len = offsets[1] - offsets[0];
+	  string_len += len;
+	  if (buf_size - pos < 20 + 10 * (size_t)ncolumns + string_len) {
+	    return pos;
+	  }
+	  p += gob_put_uint(p, len);
+	  memcpy(p, col->data + offsets[0], len);
+	  p += len;
+	  break;
+	}
+      }
+      *p++ = 0;
+      string_len = 0;
+
+      len = p - (buf + pos + 1);
+      if (len < 128) {
+	buf[pos] = (char)len;
+	prefix_len = 1;
+      } else {
+	prefix_len = gob_put_uint(prefix, len);
+	memmove(buf + pos + prefix_len, buf + pos + 1, len);
+	memcpy(buf + pos, prefix, prefix_len);
+      }
+      GOB_STATS_MESSAGE(id, prefix_len + len);
+      GOB_TRACE_MESSAGE_END(id, prefix_len + len);
+      pos += prefix_len + len;
+      (*rows_encoded)++;
+    }
+  }
+  return pos;
+}
+
+static long gob_columns_encode_generic(char *buf, size_t buf_size, int id, const struct gob_column *columns,
+				       int ncolumns, size_t first, size_t rows, size_t *rows_encoded, int features) {
+  return gob_columns_encode_rows(buf, buf_size, id, columns, ncolumns, first, rows, rows_encoded, features);
+}
+
+#ifdef __x86_64__
+__attribute__((target("bmi2,lzcnt")))
+static long gob_columns_encode_bmi2(char *buf, size_t buf_size, int id, const struct gob_column *columns,
+				    int ncolumns, size_t first, size_t rows, size_t *rows_encoded, int features) {
+  return gob_columns_encode_rows(buf, buf_size, id, columns, ncolumns, first, rows, rows_encoded, features);
+}
+#endif
+
+long gob_columns_encode(char *buf, size_t buf_size, int id, const struct gob_column *columns, int ncolumns,
+			size_t first, size_t rows, size_t *rows_encoded) {
+  int features = gob_cpu_features();
+#ifdef __x86_64__
+  if (features & GOB_CPU_BMI2) {
+    return gob_columns_encode_bmi2(buf, buf_size, id, columns, ncolumns, first, rows, rows_encoded, features);
+  }
+#endif
+  return gob_columns_encode_generic(buf, buf_size, id, columns, ncolumns, first, rows, rows_encoded, features);
+}
@@ -0,0 +1,147 @@
+#ifndef _COLUMNS_H
+#define _COLUMNS_H
+
+#include <stddef.h>
+
+#include "decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Columnar decoding of struct messages.
+ *
+ * A gob_columns decoder takes the value messages of one struct type out of a
+ * stream and writes selected fields straight into caller-provided arrays,
+ * one element per message (row):
+ *
+ * \code
+ * long long qty[1024];
+ * double px[1024];
+ * size_t sym_offsets[1025];
+ * char sym_data[16384];
+ * unsigned char px_present[1024/8];
+ * struct gob_column cols[] = {
+ *   { "Qty", GOB_COLUMN_INT, qty },
+ *   { "Px",  GOB_COLUMN_DOUBLE, px, px_present },
+ *   { "Sym", GOB_COLUMN_STRING, sym_offsets, NULL, sym_data, sizeof(sym_data) },
+ * };
+ * gob_columns_init(&dec, &types, "Tick", cols, 3, 1024);
+ * while (...more input...) {
+ *   used = gob_columns_decode(&dec, buf, len);
+ *   ...process dec.rows rows, keep the len - used bytes not decoded yet...
+ *   gob_columns_clear(&dec);
+ * }
+ * \endcode
+ *
+ * Gob omits fields with zero values, so an omitted field reads as 0, 0.0 or
+ * the empty string; the optional present bitmap tells the two apart (bit
+ * row % 8 of byte row / 8 is set if the field was sent).
+ *
+ * Type definitions found in the stream are added to the registry.  The
+ * columns are resolved against the struct's definition once, into a table
+ * from field number to column.
+ *
+ * gob_columns_encode() goes the other way, from columns to one value message
+ * per row.  There the columns are the struct's fields in order.  The zero
+ * values of each column are found for a block of rows at a time (with SSE2
+ * where available), so the row loop only walks the fields actually sent.
+ */
+
+#define GOB_COLUMN_INT    (1) // long long[], from int fields
+#define GOB_COLUMN_UINT   (2) // unsigned long long[], from uint and bool fields
+#define GOB_COLUMN_DOUBLE (3) // double[], from float64 fields
+#define GOB_COLUMN_STRING (4) // size_t offsets[capacity+1] and data, from
+                              // string and []byte fields
+
+struct gob_column {
+  const char *name;         // of the struct field
+  int type;                 // GOB_COLUMN_*
+  void *values;             // the array, or the offsets of a string column
+  unsigned char *present;   // bitmap of sent fields, may be NULL
+  char *data;               // bytes of a string column
+  size_t data_size;
+  size_t data_len;          // bytes of data used
+};
+
+struct gob_columns {
+  struct gob_types *types;
+  const char *type_name;
+  int type_id;              // 0 until the definition has been seen
+  struct gob_column *columns;
+  int ncolumns;
+  size_t capacity;          // rows the arrays hold
+  size_t rows;              // rows decoded
+  int *field_columns;       // column index by field number, -1 to skip
+  int nfields;              // 0 until resolved
+};
+
+/**
+ * Initializes a decoder.
+ *
+ * @param types
+ *   The registry of the stream's types.
+ * @param type_name
+ *   The name of the struct type, as in its definition.
+ * @param columns
+ *   The columns to fill, with data_len 0.  Neither they nor the type name are
+ *   copied.
+ * @param capacity
+ *   The number of rows the columns hold.
+ *
+ * @return
+ *   0 on success.
+ */
+int gob_columns_init(struct gob_columns *dec, struct gob_types *types, const char *type_name,
+		     struct gob_column *columns, int ncolumns, size_t capacity);
+
+void gob_columns_destroy(struct gob_columns *dec);
+
+/**
+ * Decodes messages until the columns are full.  Value messages of other types
+ * are skipped.
+ *
+ * @return
+ *   The number of bytes decoded, which is less than buf_size if the columns
+ *   are full (or a string column's data) or the last message is incomplete.
+ *   -1 if the stream is malformed or does not match the columns, or (errno
+ *   ENOSPC) if the strings of a single row exceed an empty string column.
+ */
+long gob_columns_decode(struct gob_columns *dec, const char *buf, size_t buf_size);
+
+/**
+ * Empties the columns for the next batch.
+ */
+void gob_columns_clear(struct gob_columns *dec);
+
+/**
+ * The maximum number of columns gob_columns_encode() takes.
+ */
+#define GOB_COLUMNS_MAX_ENCODE (64)
+
+/**
+ * Encodes rows first to first + rows - 1 of the columns as value messages of
+ * struct type id, one complete message per row, as gob_start_message() ...
+ * gob_end_message() would.  Fields with zero values are omitted.
+ *
+ * @param columns
+ *   Field i of the struct is column i.  Only type and values are used, the
+ *   offsets of a string column index its data.  A column with NULL values
+ *   stands for a field that is never sent.
+ * @param rows_encoded
+ *   Receives the number of rows encoded, less than rows if buf ran out.  A
+ *   row is only encoded if buf has room for 20 bytes, 10 bytes per column
+ *   and the row's strings.
+ *
+ * @return
+ *   The number of bytes written, or -1 if there are too many columns.
+ */
+long gob_columns_encode(char *buf, size_t buf_size, int id, const struct gob_column *columns, int ncolumns,
+			size_t first, size_t rows, size_t *rows_encoded);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
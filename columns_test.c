@@ -0,0 +1,189 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "columns.h"
+#include "tick_fixture.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *sSyms[] = { "sym", "abc", "", "symbol" };
+
+// 100 ticks, with a message of another type in between
+static size_t build_stream(char *buf, size_t buf_size) {
+  size_t len = encode_tick_type(buf, buf_size, 65);
+  int i;
+
+  for (i = 0; i < 100; i++) {
+    len += encode_tick(buf + len, buf_size - len, 65, sSyms[i % 4], i * 0.5, i - 50, 0);
+    if (i == 40) {
+      len += encode_tick_type(buf + len, buf_size - len, 66);
+      len += encode_tick(buf + len, buf_size - len, 66, "other", 1, 1, 0);
+    }
+  }
+  return len;
+}
+
+void test_gob_columns_batches() {
+  static char stream[8192];
+  size_t stream_len = build_stream(stream, sizeof(stream));
+  struct gob_types types;
+  struct gob_columns dec;
+  long long qty[32];
+  double px[32];
+  unsigned long long seq[32];
+  size_t sym_offsets[33];
+  char sym_data[256];
+  unsigned char px_present[4];
+  unsigned char seq_present[4];
+  struct gob_column cols[] = {
+    { "Qty", GOB_COLUMN_INT, qty },
+    { "Px", GOB_COLUMN_DOUBLE, px, px_present },
+    { "Sym", GOB_COLUMN_STRING, sym_offsets, NULL, sym_data, sizeof(sym_data) },
+    { "Seq", GOB_COLUMN_UINT, seq, seq_present },
+  };
+  size_t pos = 0;
+  long used;
+  int tick = 0;
+  int errors = 0;
+  size_t row;
+
+  CU_ASSERT_EQUAL(0, gob_types_init(&types));
+  CU_ASSERT_EQUAL(0, gob_columns_init(&dec, &types, "Tick", cols, 4, 32));
+  while (pos < stream_len) {
+    used = gob_columns_decode(&dec, stream + pos, stream_len - pos);
+    CU_ASSERT(used > 0);
+    if (used <= 0) {
+      break;
+    }
+    pos += used;
+    CU_ASSERT(dec.rows == 32 || pos == stream_len);
+    for (row = 0; row < dec.rows; row++, tick++) {
+      errors += qty[row] != tick - 50;
+      errors += px[row] != tick * 0.5;
+      errors += ((px_present[row / 8] >> (row % 8)) & 1) != (tick != 0);
+      errors += seq[row] != 0 || ((seq_present[row / 8] >> (row % 8)) & 1) != 0;
+      errors += sym_offsets[row + 1] - sym_offsets[row] != strlen(sSyms[tick % 4]);
+      errors += memcmp(sym_data + sym_offsets[row], sSyms[tick % 4], strlen(sSyms[tick % 4])) != 0;
+    }
+    gob_columns_clear(&dec);
+  }
+  CU_ASSERT_EQUAL(100, tick);
+  CU_ASSERT_EQUAL(0, errors);
+  CU_ASSERT_EQUAL(65, dec.type_id);
+  gob_columns_destroy(&dec);
+
+  // a column of the wrong type
+  cols[0].type = GOB_COLUMN_DOUBLE;
+  CU_ASSERT_EQUAL(0, gob_columns_init(&dec, &types, "Tick", cols, 4, 32));
+  CU_ASSERT_EQUAL(-1, gob_columns_decode(&dec, stream, stream_len));
+  gob_columns_destroy(&dec);
+  gob_types_destroy(&types);
+}
+
+void test_gob_columns_string_data() {
+  static char stream[8192];
+  size_t stream_len = build_stream(stream, sizeof(stream));
+  struct gob_types types;
+  struct gob_columns dec;
+  size_t sym_offsets[101];
+  char sym_data[10];
+  struct gob_column cols[] = {
+    { "Sym", GOB_COLUMN_STRING, sym_offsets, NULL, sym_data, sizeof(sym_data) },
+  };
+  long used;
+
+  CU_ASSERT_EQUAL(0, gob_types_init(&types));
+  CU_ASSERT_EQUAL(0, gob_columns_init(&dec, &types, "Tick", cols, 1, 100));
+
+  // "sym" "abc" "" fit, "symbol" does not
+  used = gob_columns_decode(&dec, stream, stream_len);
+  CU_ASSERT(used > 0);
+  CU_ASSERT_EQUAL(3, dec.rows);
+  CU_ASSERT_EQUAL(6, cols[0].data_len);
+  CU_ASSERT_EQUAL(6, sym_offsets[3]);
+  CU_ASSERT(memcmp(sym_data, "symabc", 6) == 0);
+
+  gob_columns_clear(&dec);
+  CU_ASSERT(gob_columns_decode(&dec, stream + used, stream_len - used) > 0);
+  CU_ASSERT_EQUAL(2, dec.rows);
+  CU_ASSERT(memcmp(sym_data, "symbolsym", 9) == 0);
+  gob_columns_destroy(&dec);
+
+  // a single string longer than the column
+  sym_data[0] = 0;
+  cols[0].data_size = 2;
+  CU_ASSERT_EQUAL(0, gob_columns_init(&dec, &types, "Tick", cols, 1, 100));
+  CU_ASSERT_EQUAL(-1, gob_columns_decode(&dec, stream + used, stream_len - used));
+  gob_columns_destroy(&dec);
+  gob_types_destroy(&types);
+}
+
+void test_gob_columns_encode() {
+  static char expected[16384];
+  static char buf[16384];
+  char long_sym[201];
+  long long qty[300];
+  double px[300];
+  unsigned long long seq[300];
+  size_t sym_offsets[301];
+  char sym_data[2048];
+  struct gob_column cols[] = {
+    { "Sym", GOB_COLUMN_STRING, sym_offsets, NULL, sym_data },
+    { "Px", GOB_COLUMN_DOUBLE, px },
+    { "Qty", GOB_COLUMN_INT, qty },
+    { "Seq", GOB_COLUMN_UINT, seq },
+  };
+  size_t expected_len = 0;
+  size_t rows_encoded;
+  size_t pos;
+  size_t done;
+  long len;
+  int i;
+
+  // 300 rows cross a block boundary; -0.0 is omitted like 0.0
+  sym_offsets[0] = 0;
+  for (i = 0; i < 300; i++) {
+    qty[i] = i - 150;
+    px[i] = i == 7 ? -0.0 : i * 0.5;
+    seq[i] = 0;
+    strcpy(sym_data + sym_offsets[i], sSyms[i % 4]);
+    sym_offsets[i + 1] = sym_offsets[i] + strlen(sSyms[i % 4]);
+    expected_len += encode_tick(expected + expected_len, sizeof(expected) - expected_len, 65,
+				sSyms[i % 4], px[i], qty[i], 0);
+  }
+  len = gob_columns_encode(buf, sizeof(buf), 65, cols, 4, 0, 300, &rows_encoded);
+  CU_ASSERT_EQUAL(300, rows_encoded);
+  CU_ASSERT_EQUAL(expected_len, len);
+  CU_ASSERT(memcmp(expected, buf, expected_len) == 0);
+
+  // a small buffer takes whole rows only, continuing from the first row left
+  pos = 0;
+  for (done = 0; done < 300; done += rows_encoded) {
+    len = gob_columns_encode(buf + pos, 200, 65, cols, 4, done, 300 - done, &rows_encoded);
+    CU_ASSERT(rows_encoded > 0 && rows_encoded < 300);
+    if (rows_encoded == 0) {
+      break;
+    }
+    pos += len;
+  }
+  CU_ASSERT_EQUAL(expected_len, pos);
+  CU_ASSERT(memcmp(expected, buf, expected_len) == 0);
+
+  // a column that is never sent, and a body longer than 127 bytes
+  cols[1].values = NULL;
+  memset(long_sym, 'x', 200);
+  long_sym[200] = '\0';
+  memcpy(sym_data, long_sym, 200);
+  sym_offsets[1] = 200;
+  len = gob_columns_encode(buf, sizeof(buf), 65, cols, 4, 0, 1, &rows_encoded);
+  CU_ASSERT_EQUAL(1, rows_encoded);
+  expected_len = encode_tick(expected, sizeof(expected), 65, long_sym, 0, -150, 0);
+  CU_ASSERT_EQUAL(expected_len, len);
+  CU_ASSERT(memcmp(expected, buf, expected_len) == 0);
+
+  CU_ASSERT_EQUAL(-1, gob_columns_encode(buf, sizeof(buf), 65, cols, GOB_COLUMNS_MAX_ENCODE + 1, 0, 1,
+					 &rows_encoded));
+}
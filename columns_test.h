@@ -0,0 +1,8 @@
+#ifndef _COLUMNS_TEST_H
+#define _COLUMNS_TEST_H
+
+void test_gob_columns_batches();
+void test_gob_columns_string_data();
+void test_gob_columns_encode();
+
+#endif
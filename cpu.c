@@ -0,0 +1,76 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+// What the CPU supports, -1 until detected.
+static int sDetected = -1;
+
+// What may be used of it.
+static int sAllowed = -1;
+
+static const struct {
+  const char *name;
+  int features;
+} sLevels[] = {
+  { "avx512", GOB_CPU_SSE2 | GOB_CPU_BMI2 | GOB_CPU_AVX2 | GOB_CPU_AVX512 },
+  { "avx2", GOB_CPU_SSE2 | GOB_CPU_BMI2 | GOB_CPU_AVX2 },
+  { "sse2", GOB_CPU_SSE2 },
+  { "generic", 0 },
+};
+
+static int gob_cpu_detect(void) {
+  int features = 0;
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    features |= GOB_CPU_SSE2;
+  }
+  if (__builtin_cpu_supports("bmi2") && __builtin_cpu_supports("abm")) {
+    features |= GOB_CPU_BMI2;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    features |= GOB_CPU_AVX2;
+  }
+  if (__builtin_cpu_supports("avx512f")) {
+    features |= GOB_CPU_AVX512;
+  }
+#endif
+  return features;
+}
+
+int gob_cpu_features(void) {
+  int detected = __atomic_load_n(&sDetected, __ATOMIC_RELAXED);
+  const char *cap;
+  size_t i;
+
+  if (detected < 0) {
+    // racing threads detect the same
+    detected = gob_cpu_detect();
+    cap = getenv("GOB_CPU");
+    for (i = 0; cap != NULL && i < sizeof(sLevels) / sizeof(sLevels[0]); i++) {
+      if (strcmp(cap, sLevels[i].name) == 0) {
+	detected &= sLevels[i].features;
+      }
+    }
+    __atomic_store_n(&sDetected, detected, __ATOMIC_RELAXED);
+  }
+  return detected & __atomic_load_n(&sAllowed, __ATOMIC_RELAXED);
+}
+
+void gob_cpu_restrict(int features) {
+  if (features == -1) {
+    __atomic_store_n(&sDetected, gob_cpu_detect(), __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&sAllowed, features, __ATOMIC_RELAXED);
+}
+
+const char *gob_cpu_name(int features) {
+  if (features & GOB_CPU_AVX512) {
+    return "avx512";
+  }
+  if (features & GOB_CPU_AVX2) {
+    return "avx2";
+  }
+  return features & GOB_CPU_SSE2 ? "sse2" : "generic";
+}
@@ -0,0 +1,61 @@
+#ifndef _CPU_H
+#define _CPU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Run-time selection of the instruction set extensions used by hot loops.
+ *
+ * The library is built for the baseline of the target (x86-64: SSE2), so
+ * one build runs on every host.  The loops that gain from wider vectors or
+ * newer scalar instructions are additionally compiled for them, with
+ * function target attributes, and the variant to run is chosen by the
+ * features of the CPU the process finds itself on:
+ *
+ * \code
+ * gob_columns_encode(...)  // zero scan with AVX-512, AVX2 or SSE2,
+ *                          // varints with LZCNT/BMI2 where supported
+ * \endcode
+ *
+ * The features are detected once, with __builtin_cpu_supports().  The
+ * GOB_CPU environment variable, read at that time, caps them at a level
+ * ("generic", "sse2", "avx2" or "avx512"), e.g. to compare the variants on
+ * one host or to rule one out; gob_cpu_restrict() does the same from code.
+ * All variants produce the same bytes.
+ *
+ * On other architectures no features are detected and the generic code
+ * runs.
+ */
+
+#define GOB_CPU_SSE2   (1 << 0)
+#define GOB_CPU_BMI2   (1 << 1) // BMI2 and LZCNT
+#define GOB_CPU_AVX2   (1 << 2)
+#define GOB_CPU_AVX512 (1 << 3) // AVX-512F
+
+/**
+ * Returns the GOB_CPU_* features the library makes use of: those the CPU
+ * supports, as capped by GOB_CPU and gob_cpu_restrict().  Cheap after the
+ * first call.
+ */
+int gob_cpu_features(void);
+
+/**
+ * Limits the features used from now on to the given ones (of those the CPU
+ * supports); -1 lifts the limit, also that of GOB_CPU.  Calls already
+ * running are not affected.
+ */
+void gob_cpu_restrict(int features);
+
+/**
+ * Returns the name of the widest vector extension among features, as for
+ * GOB_CPU: "avx512", "avx2", "sse2" or "generic".
+ */
+const char *gob_cpu_name(int features);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,103 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "decode.h"
+#include "columns.h"
+#include "cpu.h"
+#include "varint.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+void test_gob_cpu_features() {
+  int all = gob_cpu_features();
+
+  // restricting only ever takes features away
+  gob_cpu_restrict(GOB_CPU_SSE2);
+  CU_ASSERT_EQUAL(all & GOB_CPU_SSE2, gob_cpu_features());
+  gob_cpu_restrict(0);
+  CU_ASSERT_EQUAL(0, gob_cpu_features());
+  CU_ASSERT_STRING_EQUAL("generic", gob_cpu_name(gob_cpu_features()));
+  gob_cpu_restrict(-1);
+  CU_ASSERT_EQUAL(all, gob_cpu_features() & all);
+#ifdef __x86_64__
+  CU_ASSERT(gob_cpu_features() & GOB_CPU_SSE2);
+#endif
+
+  CU_ASSERT_STRING_EQUAL("avx512", gob_cpu_name(GOB_CPU_SSE2 | GOB_CPU_AVX2 | GOB_CPU_AVX512));
+  CU_ASSERT_STRING_EQUAL("avx2", gob_cpu_name(GOB_CPU_SSE2 | GOB_CPU_BMI2 | GOB_CPU_AVX2));
+  CU_ASSERT_STRING_EQUAL("sse2", gob_cpu_name(GOB_CPU_SSE2 | GOB_CPU_BMI2));
+  CU_ASSERT_STRING_EQUAL("generic", gob_cpu_name(0));
+}
+
+void test_gob_cpu_variants() {
+  static const int levels[] = {
+    GOB_CPU_SSE2, GOB_CPU_SSE2 | GOB_CPU_BMI2, GOB_CPU_SSE2 | GOB_CPU_BMI2 | GOB_CPU_AVX2, -1
+  };
+  static long long ints[1000];
+  static double doubles[1000];
+  static unsigned long long uints[1000];
+  static char expected[64 * 1000];
+  static char odd[64 * 1000];
+  static char buf[64 * 1000];
+  struct gob_column cols[] = {
+    { "I", GOB_COLUMN_INT, ints },
+    { "D", GOB_COLUMN_DOUBLE, doubles },
+    { "U", GOB_COLUMN_UINT, uints },
+  };
+  char varint[2 * (sizeof(unsigned long long)+1)];
+  unsigned long long u;
+  unsigned long long v;
+  size_t rows_encoded;
+  long expected_len;
+  long odd_len;
+  long len;
+  int shift;
+  int i;
+  int n;
+
+  // zeros in runs and alone, at every offset of the vector widths, and
+  // -0.0 and NaN, which compare as numbers
+  for (i = 0; i < 1000; i++) {
+    u = (unsigned long long)i << (i % 50);
+    ints[i] = i % 3 == 0 || (i / 16) % 2 ? 0 : i % 2 ? -(long long)u : (long long)u;
+    doubles[i] = i % 5 == 0 ? 0 : i % 7 == 0 ? -0.0 : i % 11 == 0 ? NAN : i * 1.5;
+    uints[i] = i % 9 < 4 ? 0 : ~0ULL >> (i % 64);
+  }
+  gob_cpu_restrict(0);
+  expected_len = gob_columns_encode(expected, sizeof(expected), 65, cols, 3, 0, 1000, &rows_encoded);
+  CU_ASSERT_EQUAL(1000, rows_encoded);
+  // from an odd first row, so loads are unaligned and rows are left over
+  odd_len = gob_columns_encode(odd, sizeof(odd), 65, cols, 3, 1, 997, &rows_encoded);
+  CU_ASSERT_EQUAL(997, rows_encoded);
+  for (i = 0; i < (int)(sizeof(levels) / sizeof(levels[0])); i++) {
+    gob_cpu_restrict(levels[i]);
+    len = gob_columns_encode(buf, sizeof(buf), 65, cols, 3, 0, 1000, &rows_encoded);
+    CU_ASSERT_EQUAL(expected_len, len);
+    CU_ASSERT(memcmp(expected, buf, expected_len) == 0);
+    len = gob_columns_encode(buf, sizeof(buf), 65, cols, 3, 1, 997, &rows_encoded);
+    CU_ASSERT_EQUAL(odd_len, len);
+    CU_ASSERT(memcmp(odd, buf, odd_len) == 0);
+  }
+  gob_cpu_restrict(-1);
+
+  // the varint writers agree with the encoder, and the decoder reads varints
+  // whole words at a time and at the end of a buffer alike
+  for (shift = 0; shift < 64; shift++) {
+    for (i = -1; i <= 1; i++) {
+      u = (1ULL << shift) + i;
+      n = gob_encode_unsigned_long_long(expected, sizeof(expected), u);
+      memset(varint, 0x5a, sizeof(varint));
+      CU_ASSERT_EQUAL(n, gob_put_uint(varint, u));
+      CU_ASSERT(memcmp(expected, varint, n) == 0);
+      CU_ASSERT_EQUAL(n, gob_decode_unsigned_long_long(varint, sizeof(varint), &v));
+      CU_ASSERT_EQUAL(u, v);
+      CU_ASSERT_EQUAL(n, gob_decode_unsigned_long_long(varint, n, &v));
+      CU_ASSERT_EQUAL(u, v);
+      CU_ASSERT_EQUAL(-1, gob_decode_unsigned_long_long(varint, n - 1, &v));
+    }
+  }
+}
@@ -0,0 +1,7 @@
+#ifndef _CPU_TEST_H
+#define _CPU_TEST_H
+
+void test_gob_cpu_features();
+void test_gob_cpu_variants();
+
+#endif
@@ -0,0 +1,625 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <limits.h>
+
+#include "gob.h"
+#include "decode.h"
+#include "trace.h"
+
+// Values nested deeper than this are rejected rather than overflowing the
+// stack on hostile input.
+#define GOB_MAX_DEPTH (100)
+
+int gob_decode_unsigned_long_long(const char *buf, size_t buf_size, unsigned long long *ull) {
+  const unsigned char *p = (const unsigned char*)buf;
+  unsigned long long u = 0;
+  size_t n;
+  size_t i;
+
+  if (buf_size < 1) {
+    return -1;
+  }
+  if (p[0] < 128) {
+    *ull = p[0];
+    return 1;
+  }
+  n = (unsigned char)(-(signed char)p[0]);
+  if (n > sizeof(unsigned long long) || n + 1 > buf_size) {
+    return -1;
+  }
+  if (buf_size > sizeof(unsigned long long)) {
+    // all eight bytes in one load, dropping those after the varint
+    memcpy(&u, p + 1, sizeof(u));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    u = __builtin_bswap64(u);
+#endif
+    *ull = u >> (64 - 8 * n);
+    return n + 1;
+  }
+  for (i = 1; i <= n; i++) {
+    u = (u << 8) | p[i];
+  }
+  *ull = u;
+  return n + 1;
+}
+
+int gob_decode_long_long(const char *buf, size_t buf_size, long long *i) {
+  unsigned long long u;
+  int num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &u);
+  if (num_bytes > 0) {
+    *i = (u & 1) ? (long long)~(u >> 1) : (long long)(u >> 1);
+  }
+  return num_bytes;
+}
+
+int gob_decode_double(const char *buf, size_t buf_size, double *d) {
+  unsigned long long u;
+  int num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &u);
+  if (num_bytes > 0) {
+    u = __builtin_bswap64(u);
+    memcpy(d, &u, sizeof(double));
+  }
+  return num_bytes;
+}
+
+int gob_decode_bytes(const char *buf, size_t buf_size, const char **data, size_t *len) {
+  unsigned long long n;
+  int num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &n);
+  // the size has to fit the result
+  if (num_bytes < 0 || n > (unsigned long long)(INT_MAX - num_bytes) || n > buf_size - num_bytes) {
+    return -1;
+  }
+  *data = buf + num_bytes;
+  *len = n;
+  return num_bytes + n;
+}
+
+int gob_decode_message(const char *buf, size_t buf_size, int *id, const char **body, size_t *body_len) {
+  unsigned long long len;
+  long long type_id = 0;
+  int prefix_len;
+  int id_len;
+
+  prefix_len = gob_decode_unsigned_long_long(buf, buf_size, &len);
+  if (prefix_len < 0) {
+    // a count byte announcing more than 8 bytes never becomes valid
+    if (buf_size > 0 && (unsigned char)buf[0] >= 128 &&
+	(unsigned char)(-(signed char)buf[0]) > sizeof(unsigned long long)) {
+      return -1;
+    }
+    return 0;
+  }
+  // nor does a message too large for the result
+  if (len > (unsigned long long)(INT_MAX - prefix_len)) {
+    return -1;
+  }
+  if (len > buf_size - prefix_len) {
+    return 0;
+  }
+  id_len = gob_decode_long_long(buf + prefix_len, len, &type_id);
+  if (id_len < 0 || type_id == 0 || type_id > GOB_MAX_TYPE_ID || type_id < -GOB_MAX_TYPE_ID) {
+    return -1;
+  }
+  *id = (int)type_id;
+  *body = buf + prefix_len + id_len;
+  *body_len = len - id_len;
+  GOB_TRACE_DECODE_MESSAGE(*id, (size_t)(prefix_len + len));
+  return prefix_len + len;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Types
+
+// Makes room for ids up to id.
+static struct gob_type *gob_types_slot(struct gob_types *types, int id) {
+  struct gob_type *grown;
+  int size;
+
+  if (id <= 0 || id > GOB_MAX_TYPE_ID) {
+    return NULL;
+  }
+  if (id >= types->size) {
+    size = types->size * 2 > id ? types->size * 2 : id + 1;
+    grown = realloc(types->types, size * sizeof(struct gob_type));
+    if (grown == NULL) {
+      return NULL;
+    }
+    memset(grown + types->size, 0, (size - types->size) * sizeof(struct gob_type));
+    types->types = grown;
+    types->size = size;
+  }
+  return &types->types[id];
+}
+
+static void gob_type_clear(struct gob_type *t) {
+  int i;
+  for (i = 0; i < t->nfields; i++) {
+    free(t->fields[i].name);
+  }
+  free(t->fields);
+  free(t->name);
+  memset(t, 0, sizeof(struct gob_type));
+}
+
+// Registers a predefined struct type; the arguments following nfields are
+// pairs of field name and type id.
+static int gob_types_predefine(struct gob_types *types, int id, const char *name, int nfields, ...) {
+  struct gob_type *t = gob_types_slot(types, id);
+  va_list ap;
+  int i;
+
+  if (t == NULL) {
+    return -1;
+  }
+  t->kind = GOB_KIND_STRUCT;
+  t->name = strdup(name);
+  t->fields = calloc(nfields, sizeof(struct gob_field));
+  if (t->name == NULL || t->fields == NULL) {
+    return -1;
+  }
+  t->nfields = nfields;
+  va_start(ap, nfields);
+  for (i = 0; i < nfields; i++) {
+    t->fields[i].name = strdup(va_arg(ap, const char*));
+    t->fields[i].id = va_arg(ap, int);
+    if (t->fields[i].name == NULL) {
+      va_end(ap);
+      return -1;
+    }
+  }
+  va_end(ap);
+  return 0;
+}
+
+int gob_types_init(struct gob_types *types) {
+  static const char *names[] = { NULL, "bool", "int", "uint", "float64", "[]byte", "string", "complex128", "interface" };
+  struct gob_type *t;
+  int id;
+
+  types->types = NULL;
+  types->size = 0;
+  for (id = GOB_BOOL_ID; id <= GOB_INTERFACE_ID; id++) {
+    t = gob_types_slot(types, id);
+    if (t == NULL || (t->name = strdup(names[id])) == NULL) {
+      gob_types_destroy(types);
+      return -1;
+    }
+    t->kind = id;
+  }
+  // the types of type definitions, as bootstrapped by Go's encoding/gob;
+  // gobEncoderType gets id 24 there
+  if (gob_types_predefine(types, GOB_WIRETYPE_ID, "wireType", 7,
+			  "ArrayT", GOB_ARRAYTYPE_ID, "SliceT", GOB_SLICETYPE_ID,
+			  "StructT", GOB_STRUCTTYPE_ID, "MapT", GOB_MAPTYPE_ID,
+			  "GobEncoderT", GOB_GOBENCODERTYPE_ID, "BinaryMarshalerT", GOB_GOBENCODERTYPE_ID,
+			  "TextMarshalerT", GOB_GOBENCODERTYPE_ID) < 0 ||
+      gob_types_predefine(types, GOB_ARRAYTYPE_ID, "arrayType", 3,
+			  "CommonType", GOB_COMMONTYPE_ID, "Elem", GOB_INT_ID, "Len", GOB_INT_ID) < 0 ||
+      gob_types_predefine(types, GOB_COMMONTYPE_ID, "CommonType", 2,
+			  "Name", GOB_STRING_ID, "Id", GOB_INT_ID) < 0 ||
+      gob_types_predefine(types, GOB_SLICETYPE_ID, "sliceType", 2,
+			  "CommonType", GOB_COMMONTYPE_ID, "Elem", GOB_INT_ID) < 0 ||
+      gob_types_predefine(types, GOB_STRUCTTYPE_ID, "structType", 2,
+			  "CommonType", GOB_COMMONTYPE_ID, "Field", GOB_FIELDTYPE_SLICE_ID) < 0 ||
+      gob_types_predefine(types, GOB_FIELDTYPE_ID, "fieldType", 2,
+			  "Name", GOB_STRING_ID, "Id", GOB_INT_ID) < 0 ||
+      gob_types_predefine(types, GOB_MAPTYPE_ID, "mapType", 3,
+			  "CommonType", GOB_COMMONTYPE_ID, "Key", GOB_INT_ID, "Elem", GOB_INT_ID) < 0 ||
+      gob_types_predefine(types, GOB_GOBENCODERTYPE_ID, "gobEncoderType", 1,
+			  "CommonType", GOB_COMMONTYPE_ID) < 0) {
+    gob_types_destroy(types);
+    return -1;
+  }
+  t = gob_types_slot(types, GOB_FIELDTYPE_SLICE_ID);
+  if (t == NULL) {
+    gob_types_destroy(types);
+    return -1;
+  }
+  t->kind = GOB_KIND_SLICE;
+  t->elem = GOB_FIELDTYPE_ID;
+  return 0;
+}
+
+void gob_types_destroy(struct gob_types *types) {
+  int i;
+  for (i = 0; i < types->size; i++) {
+    gob_type_clear(&types->types[i]);
+  }
+  free(types->types);
+  types->types = NULL;
+  types->size = 0;
+}
+
+const struct gob_type *gob_types_lookup(const struct gob_types *types, int id) {
+  if (id <= 0 || id >= types->size || types->types[id].kind == 0) {
+    return NULL;
+  }
+  return &types->types[id];
+}
+
+// Definitions are parsed by hand: fields are numbered from 1 here, as the
+// running sum of the deltas.
+
+static int gob_parse_field(const char *buf, size_t buf_size, int *field) {
+  unsigned long long delta;
+  int num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &delta);
+  if (num_bytes < 0 || delta > 16) {
+    return -1;
+  }
+  *field = delta == 0 ? 0 : *field + (int)delta;
+  return num_bytes;
+}
+
+static int gob_parse_int(const char *buf, size_t buf_size, long long *i) {
+  return gob_decode_long_long(buf, buf_size, i);
+}
+
+static int gob_parse_string(const char *buf, size_t buf_size, char **s) {
+  const char *data;
+  size_t len;
+  int num_bytes = gob_decode_bytes(buf, buf_size, &data, &len);
+  if (num_bytes < 0) {
+    return -1;
+  }
+  free(*s);
+  *s = strndup(data, len);
+  return *s != NULL ? num_bytes : -1;
+}
+
+// CommonType and fieldType: { Name string; Id int }
+static int gob_parse_name_id(const char *buf, size_t buf_size, char **name, long long *id) {
+  size_t pos = 0;
+  int field = 0;
+  int num_bytes;
+
+  for (;;) {
+    num_bytes = gob_parse_field(buf + pos, buf_size - pos, &field);
+    if (num_bytes < 0) {
+      return -1;
+    }
+    pos += num_bytes;
+    switch (field) {
+    case 0:
+      return pos;
+    case 1:
+      num_bytes = gob_parse_string(buf + pos, buf_size - pos, name);
+      break;
+    case 2:
+      num_bytes = gob_parse_int(buf + pos, buf_size - pos, id);
+      break;
+    default:
+      return -1;
+    }
+    if (num_bytes < 0) {
+      return -1;
+    }
+    pos += num_bytes;
+  }
+}
+
+static int gob_parse_fields(const char *buf, size_t buf_size, struct gob_type *t) {
+  unsigned long long n;
+  unsigned long long i;
+  long long id;
+  size_t pos;
+  int num_bytes;
+
+  num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &n);
+  // every field takes at least one byte
+  if (num_bytes < 0 || n > buf_size) {
+    return -1;
+  }
+  pos = num_bytes;
+  for (i = 0; i < (unsigned long long)t->nfields; i++) {
+    free(t->fields[i].name);
+  }
+  free(t->fields);
+  t->nfields = 0;
+  t->fields = calloc(n ? n : 1, sizeof(struct gob_field));
+  if (t->fields == NULL) {
+    return -1;
+  }
+  for (i = 0; i < n; i++) {
+    id = 0;
+    num_bytes = gob_parse_name_id(buf + pos, buf_size - pos, &t->fields[i].name, &id);
+    t->nfields++;
+    if (num_bytes < 0 || id <= 0 || id > GOB_MAX_TYPE_ID) {
+      return -1;
+    }
+    t->fields[i].id = (int)id;
+    pos += num_bytes;
+  }
+  return pos;
+}
+
+// arrayType, sliceType, structType, mapType, gobEncoderType
+static int gob_parse_type(const char *buf, size_t buf_size, int wire_field, struct gob_type *t) {
+  size_t pos = 0;
+  int field = 0;
+  long long id = 0;
+  long long value;
+  int num_bytes;
+
+  for (;;) {
+    num_bytes = gob_parse_field(buf + pos, buf_size - pos, &field);
+    if (num_bytes < 0) {
+      return -1;
+    }
+    pos += num_bytes;
+    if (field == 0) {
+      return pos;
+    }
+    if (field == 1) {
+      num_bytes = gob_parse_name_id(buf + pos, buf_size - pos, &t->name, &id);
+    } else if (wire_field == 3 && field == 2) {
+      num_bytes = gob_parse_fields(buf + pos, buf_size - pos, t);
+    } else if (wire_field != 3 && wire_field < 5 && field <= 3) {
+      num_bytes = gob_parse_int(buf + pos, buf_size - pos, &value);
+      if (num_bytes > 0) {
+	if (wire_field == 1 && field == 3) {
+	  t->len = value;
+	} else if (wire_field == 4 && field == 2) {
+	  t->key = (int)value;
+	} else {
+	  t->elem = (int)value;
+	}
+      }
+    } else {
+      return -1;
+    }
+    if (num_bytes < 0) {
+      return -1;
+    }
+    pos += num_bytes;
+  }
+}
+
+int gob_types_define(struct gob_types *types, int id, const char *buf, size_t buf_size) {
+  static const int kinds[] = { 0, GOB_KIND_ARRAY, GOB_KIND_SLICE, GOB_KIND_STRUCT, GOB_KIND_MAP,
+			       GOB_KIND_GOB_ENCODER, GOB_KIND_GOB_ENCODER, GOB_KIND_GOB_ENCODER };
+  struct gob_type *t = gob_types_slot(types, id);
+  size_t pos = 0;
+  int field = 0;
+  int num_bytes;
+
+  if (t == NULL || id < GOB_FIRST_USER_ID) {
+    return -1;
+  }
+  gob_type_clear(t);
+
+  // wireType has exactly one of its fields set
+  num_bytes = gob_parse_field(buf, buf_size, &field);
+  if (num_bytes < 0 || field < 1 || field > 7) {
+    return -1;
+  }
+  pos += num_bytes;
+  num_bytes = gob_parse_type(buf + pos, buf_size - pos, field, t);
+  if (num_bytes < 0) {
+    gob_type_clear(t);
+    return -1;
+  }
+  pos += num_bytes;
+  t->kind = kinds[field];
+  num_bytes = gob_parse_field(buf + pos, buf_size - pos, &field);
+  if (num_bytes < 0 || field != 0) {
+    gob_type_clear(t);
+    return -1;
+  }
+  return pos + num_bytes;
+}
+
+static int gob_types_format_id(const struct gob_types *types, int id, int expand, int depth, char *buf, size_t buf_size);
+
+int gob_types_format(const struct gob_types *types, int id, int expand, char *buf, size_t buf_size) {
+  return gob_types_format_id(types, id, expand, 0, buf, buf_size);
+}
+
+static int gob_types_format_id(const struct gob_types *types, int id, int expand, int depth, char *buf, size_t buf_size) {
+  const struct gob_type *t = gob_types_lookup(types, id);
+  size_t pos = 0;
+  int num_bytes;
+  int i;
+
+#define GOB_FORMAT(...)							\
+  do {									\
+    num_bytes = snprintf(buf + (pos < buf_size ? pos : buf_size),	\
+			 pos < buf_size ? buf_size - pos : 0, __VA_ARGS__); \
+    pos += num_bytes;							\
+  } while (0)
+#define GOB_FORMAT_ID(id)						\
+  do {									\
+    num_bytes = gob_types_format_id(types, id, 0, depth + 1,		\
+				    buf + (pos < buf_size ? pos : buf_size), \
+				    pos < buf_size ? buf_size - pos : 0); \
+    pos += num_bytes;							\
+  } while (0)
+
+  if (t == NULL || depth > GOB_MAX_DEPTH) {
+    GOB_FORMAT("type%d", id);
+  } else if (t->name != NULL && *t->name != '\0' && (!expand || id < GOB_FIRST_USER_ID)) {
+    GOB_FORMAT("%s", t->name);
+  } else {
+    switch (t->kind) {
+    case GOB_KIND_ARRAY:
+      GOB_FORMAT("[%lld]", t->len);
+      GOB_FORMAT_ID(t->elem);
+      break;
+    case GOB_KIND_SLICE:
+      GOB_FORMAT("[]");
+      GOB_FORMAT_ID(t->elem);
+      break;
+    case GOB_KIND_MAP:
+      GOB_FORMAT("map[");
+      GOB_FORMAT_ID(t->key);
+      GOB_FORMAT("]");
+      GOB_FORMAT_ID(t->elem);
+      break;
+    case GOB_KIND_STRUCT:
+      GOB_FORMAT("struct {");
+      for (i = 0; i < t->nfields; i++) {
+	GOB_FORMAT(i == 0 ? " %s " : "; %s ", t->fields[i].name);
+	GOB_FORMAT_ID(t->fields[i].id);
+      }
+      GOB_FORMAT(t->nfields > 0 ? " }" : "}");
+      break;
+    case GOB_KIND_GOB_ENCODER:
+      GOB_FORMAT("GobEncoder");
+      break;
+    default:
+      GOB_FORMAT("type%d", id);
+      break;
+    }
+  }
+#undef GOB_FORMAT
+#undef GOB_FORMAT_ID
+  return pos;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Walking values
+
+static int gob_walk(const struct gob_types *types, int id, const char *buf, size_t buf_size,
+		    gob_field_visitor visit, void *ctx, int depth);
+
+static int gob_walk_struct(const struct gob_types *types, int id, const struct gob_type *t,
+			   const char *buf, size_t buf_size, gob_field_visitor visit, void *ctx, int depth) {
+  unsigned long long delta;
+  size_t pos = 0;
+  int field = -1;
+  int delta_len;
+  int num_bytes;
+
+  for (;;) {
+    delta_len = gob_decode_unsigned_long_long(buf + pos, buf_size - pos, &delta);
+    if (delta_len < 0) {
+      return -1;
+    }
+    pos += delta_len;
+    if (delta == 0) {
+      return pos;
+    }
+    if (delta > (unsigned long long)(t->nfields - 1 - field)) {
+      return -1;
+    }
+    field += (int)delta;
+    num_bytes = gob_walk(types, t->fields[field].id, buf + pos, buf_size - pos, visit, ctx, depth + 1);
+    if (num_bytes < 0) {
+      return -1;
+    }
+    if (visit != NULL) {
+      visit(ctx, id, field, buf + pos, num_bytes, delta_len);
+    }
+    pos += num_bytes;
+  }
+}
+
+static int gob_walk(const struct gob_types *types, int id, const char *buf, size_t buf_size,
+		    gob_field_visitor visit, void *ctx, int depth) {
+  const struct gob_type *t = gob_types_lookup(types, id);
+  unsigned long long n;
+  unsigned long long i;
+  unsigned long long u;
+  const char *data;
+  size_t len;
+  size_t pos;
+  long long inner_id;
+  int num_bytes;
+
+  if (t == NULL || depth > GOB_MAX_DEPTH) {
+    return -1;
+  }
+  switch (t->kind) {
+  case GOB_KIND_BOOL:
+  case GOB_KIND_INT:
+  case GOB_KIND_UINT:
+  case GOB_KIND_FLOAT:
+    return gob_decode_unsigned_long_long(buf, buf_size, &u);
+  case GOB_KIND_COMPLEX:
+    // real and imaginary part
+    num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &u);
+    if (num_bytes < 0) {
+      return -1;
+    }
+    pos = num_bytes;
+    num_bytes = gob_decode_unsigned_long_long(buf + pos, buf_size - pos, &u);
+    return num_bytes < 0 ? -1 : (int)pos + num_bytes;
+  case GOB_KIND_BYTES:
+  case GOB_KIND_STRING:
+  case GOB_KIND_GOB_ENCODER:
+    return gob_decode_bytes(buf, buf_size, &data, &len);
+  case GOB_KIND_INTERFACE:
+    // name, then unless nil: type id, byte count and the value itself
+    num_bytes = gob_decode_bytes(buf, buf_size, &data, &len);
+    if (num_bytes < 0 || len == 0) {
+      return num_bytes;
+    }
+    pos = num_bytes;
+    num_bytes = gob_decode_long_long(buf + pos, buf_size - pos, &inner_id);
+    if (num_bytes < 0) {
+      return -1;
+    }
+    pos += num_bytes;
+    num_bytes = gob_decode_bytes(buf + pos, buf_size - pos, &data, &len);
+    return num_bytes < 0 ? -1 : (int)pos + num_bytes;
+  case GOB_KIND_ARRAY:
+  case GOB_KIND_SLICE:
+  case GOB_KIND_MAP:
+    num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &n);
+    // every element takes at least one byte
+    if (num_bytes < 0 || n > buf_size) {
+      return -1;
+    }
+    pos = num_bytes;
+    for (i = 0; i < n; i++) {
+      if (t->kind == GOB_KIND_MAP) {
+	num_bytes = gob_walk(types, t->key, buf + pos, buf_size - pos, visit, ctx, depth + 1);
+	if (num_bytes < 0) {
+	  return -1;
+	}
+	pos += num_bytes;
+      }
+      num_bytes = gob_walk(types, t->elem, buf + pos, buf_size - pos, visit, ctx, depth + 1);
+      if (num_bytes < 0) {
+	return -1;
+      }
+      pos += num_bytes;
+    }
+    return pos;
+  case GOB_KIND_STRUCT:
+    return gob_walk_struct(types, id, t, buf, buf_size, visit, ctx, depth);
+  default:
+    return -1;
+  }
+}
+
+int gob_walk_value(const struct gob_types *types, int id, const char *buf, size_t buf_size,
+		   gob_field_visitor visit, void *ctx) {
+  const struct gob_type *t = gob_types_lookup(types, id);
+  int num_bytes;
+
+  if (t == NULL) {
+    return -1;
+  }
+  // a larger value does not fit the result, and is not whole
+  if (buf_size > INT_MAX) {
+    buf_size = INT_MAX;
+  }
+  if (t->kind == GOB_KIND_STRUCT) {
+    return gob_walk_struct(types, id, t, buf, buf_size, visit, ctx, 0);
+  }
+  // other top-level values are sent as a singleton field with delta 0
+  if (buf_size < 1 || buf[0] != 0) {
+    return -1;
+  }
+  num_bytes = gob_walk(types, id, buf + 1, buf_size - 1, visit, ctx, 0);
+  return num_bytes < 0 ? -1 : num_bytes + 1;
+}
+
+int gob_skip_value(const struct gob_types *types, int id, const char *buf, size_t buf_size) {
+  if (buf_size > INT_MAX) {
+    buf_size = INT_MAX;
+  }
+  return gob_walk(types, id, buf, buf_size, NULL, NULL, 0);
+}
@@ -0,0 +1,197 @@
+#ifndef _DECODE_H
+#define _DECODE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Decoding of gob streams.
+ *
+ * The basic decoders mirror the encoders in encode.h.  They return the number
+ * of bytes consumed, or -1 if buf does not hold a complete, well-formed value.
+ *
+ * A stream is a sequence of messages, see gob_decode_message().  Messages
+ * with a negative type id carry type definitions, which are collected in a
+ * gob_types registry with gob_types_define().  The registry then knows enough
+ * to walk the value messages of any type with gob_walk_value(), e.g. to skip
+ * them or to account for the bytes of each field.
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+// Basic Types
+
+int gob_decode_unsigned_long_long(const char *buf, size_t buf_size, unsigned long long *ull);
+int gob_decode_long_long(const char *buf, size_t buf_size, long long *i);
+int gob_decode_double(const char *buf, size_t buf_size, double *d);
+
+/**
+ * Decodes a string or byte slice without copying it.
+ *
+ * @param data
+ *   Receives a pointer to the bytes inside buf.
+ * @param len
+ *   Receives the number of bytes.
+ *
+ * @return
+ *   The number of bytes decoded, or -1 if they exceed buf or take 2 GiB or
+ *   more.
+ */
+int gob_decode_bytes(const char *buf, size_t buf_size, const char **data, size_t *len);
+
+///////////////////////////////////////////////////////////////////////////////
+// Messages
+
+/**
+ * Splits off the first message of a stream.
+ *
+ * @param id
+ *   Receives the type id, negative for a type definition.
+ * @param body
+ *   Receives a pointer to the bytes following the type id.
+ * @param body_len
+ *   Receives the number of bytes following the type id.
+ *
+ * @return
+ *   The size of the whole message including its length prefix, 0 if buf does
+ *   not hold the whole message yet, or -1 if the message is malformed or
+ *   takes 2 GiB or more.
+ */
+int gob_decode_message(const char *buf, size_t buf_size, int *id, const char **body, size_t *body_len);
+
+///////////////////////////////////////////////////////////////////////////////
+// Types
+
+/**
+ * What a type id stands for.  The kinds up to GOB_KIND_INTERFACE are the
+ * predefined types, with their type ids as values.
+ */
+#define GOB_KIND_BOOL        (1)
+#define GOB_KIND_INT         (2)
+#define GOB_KIND_UINT        (3)
+#define GOB_KIND_FLOAT       (4)
+#define GOB_KIND_BYTES       (5)
+#define GOB_KIND_STRING      (6)
+#define GOB_KIND_COMPLEX     (7)
+#define GOB_KIND_INTERFACE   (8)
+#define GOB_KIND_ARRAY       (9)
+#define GOB_KIND_SLICE       (10)
+#define GOB_KIND_STRUCT      (11)
+#define GOB_KIND_MAP         (12)
+#define GOB_KIND_GOB_ENCODER (13) // GobEncoder, BinaryMarshaler, TextMarshaler
+
+/**
+ * The largest type id a registry accepts.
+ */
+#define GOB_MAX_TYPE_ID (1 << 20)
+
+struct gob_field {
+  char *name;
+  int id;
+};
+
+struct gob_type {
+  int kind;                 // 0 if the id has not been defined
+  char *name;
+  int elem;                 // element type of arrays, slices and maps
+  int key;                  // key type of maps
+  long long len;            // length of arrays
+  int nfields;
+  struct gob_field *fields; // fields of structs, field number 0 first
+};
+
+struct gob_types {
+  struct gob_type *types;   // by type id
+  int size;
+};
+
+/**
+ * Initializes a registry holding the predefined types, including the types
+ * type definitions are made of (GOB_WIRETYPE_ID and following).
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_types_init(struct gob_types *types);
+
+void gob_types_destroy(struct gob_types *types);
+
+/**
+ * Registers a type definition.
+ *
+ * @param id
+ *   The id of the defined type, i.e. the negated type id of the message.
+ * @param buf
+ *   The message body following the type id.
+ *
+ * @return
+ *   The number of bytes consumed, or -1 if the definition is malformed or
+ *   memory ran out.
+ */
+int gob_types_define(struct gob_types *types, int id, const char *buf, size_t buf_size);
+
+/**
+ * Returns the type registered under id, or NULL.
+ */
+const struct gob_type *gob_types_lookup(const struct gob_types *types, int id);
+
+/**
+ * Writes a type in Go syntax, e.g. "struct { Name string; Id int }".  Types
+ * with a name are written by name unless expand is set.
+ *
+ * @return
+ *   The number of bytes that would have been written, as snprintf().
+ */
+int gob_types_format(const struct gob_types *types, int id, int expand, char *buf, size_t buf_size);
+
+///////////////////////////////////////////////////////////////////////////////
+// Walking values
+
+/**
+ * Called by gob_walk_value() for every struct field it passes, nested fields
+ * before the field containing them.
+ *
+ * @param struct_id
+ *   The type id of the struct.
+ * @param field
+ *   The field number, 0 for the first field of the struct.
+ * @param value
+ *   The encoded field value, not including the field delta.
+ * @param len
+ *   The size of the encoded value.
+ * @param delta_len
+ *   The size of the field delta in front of the value.
+ */
+typedef void (*gob_field_visitor)(void *ctx, int struct_id, int field,
+				  const char *value, size_t len, size_t delta_len);
+
+/**
+ * Walks the value of a message, as following the type id.
+ *
+ * @param id
+ *   The type id of the message.
+ * @param visit
+ *   Called for every struct field, may be NULL.
+ *
+ * @return
+ *   The number of bytes of the value, or -1 if the value does not match the
+ *   registered type, refers to an unknown type or takes 2 GiB or more.
+ */
+int gob_walk_value(const struct gob_types *types, int id, const char *buf, size_t buf_size,
+		   gob_field_visitor visit, void *ctx);
+
+/**
+ * Skips a value of type id inside a message, e.g. a struct field.
+ *
+ * @return
+ *   The number of bytes of the value, or -1 as gob_walk_value().
+ */
+int gob_skip_value(const struct gob_types *types, int id, const char *buf, size_t buf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
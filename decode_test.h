@@ -0,0 +1,9 @@
+#ifndef _DECODE_TEST_H
+#define _DECODE_TEST_H
+
+void test_gob_decode_basic_types();
+void test_gob_decode_message();
+void test_gob_types_define();
+void test_gob_walk_value();
+
+#endif
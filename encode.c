@@ -5,6 +5,9 @@
 
 #include "gob.h"
 #include "encode.h"
+#include "stats.h"
+#include "trace.h"
+#include "varint.h"
 
 static int sNextTypeId = 65;
 
@@ -16,7 +19,7 @@ unsigned long long flip_unsigned_long_long(unsigned long long ull) {
 }
 
 int gob_allocate_type_id() {
-  return sNextTypeId++;
+  return __atomic_fetch_add(&sNextTypeId, 1, __ATOMIC_RELAXED);
 }
 
 // a return value of buf_size or more means that output
@@ -25,28 +28,27 @@ int gob_encode_unsigned_long_long(char *buf, size_t buf_size, unsigned long long
   if (ull < 128) {
     if (buf_size >= 1) {
       *buf = (char)ull;
-      return 1;
+    } else {
+      GOB_STATS_OVERFLOW();
+      GOB_TRACE_OVERFLOW((size_t)1, buf_size);
     }
+    GOB_STATS_VARINT(1);
+    return 1;
   }
-  unsigned char *ull_ptr = (char*)&ull;
-  unsigned char *end_ptr = ull_ptr + (sizeof(unsigned long long)-1);
-  char *write_ptr = buf + 1;
-  int bytes_to_write = 1;
-  int seen_first_bit = 0;
-  // high byte first
-  while (end_ptr >= ull_ptr) {
-    if (*end_ptr != 0 || seen_first_bit) {
-      seen_first_bit = 1;
-      bytes_to_write++;
-      if (bytes_to_write <= buf_size) {
-	*write_ptr = *end_ptr;
-	write_ptr++;
-      }
-    }
-    end_ptr--;
-  }
+  // byte count, then the bytes high byte first (as many as fit)
+  int n = (64 - __builtin_clzll(ull) + 7) / 8;
+  int bytes_to_write = n + 1;
+  int i;
   if (buf_size >= 1) {
-    *buf = -1*((char)bytes_to_write-1); // byte count omits first byte
+    *buf = (char)-n; // byte count omits first byte
+  }
+  for (i = 1; i <= n && i < buf_size; i++) {
+    buf[i] = (char)(ull >> (8 * (n - i)));
+  }
+  GOB_STATS_VARINT(bytes_to_write);
+  if (bytes_to_write > buf_size) {
+    GOB_STATS_OVERFLOW();
+    GOB_TRACE_OVERFLOW((size_t)bytes_to_write, buf_size);
   }
   return bytes_to_write;
 }
@@ -87,30 +89,59 @@ int gob_encode_double(char *buf, size_t buf_size, double d) {
   return gob_encode_unsigned_long_long(buf, buf_size, rev_ull);
 }
 
-int gob_encode_string(char *buf, size_t buf_size, const char *s) {
-  size_t len = strlen(s);
-  int encoded_len_size = gob_encode_unsigned_int(buf, buf_size, len);
+// Encodes a count followed by len bytes of data.
+static size_t gob_encode_counted(char *buf, size_t buf_size, const char *data, size_t len) {
+  int encoded_len_size = gob_encode_unsigned_long_long(buf, buf_size, len);
   buf += encoded_len_size;
-  buf_size -= encoded_len_size;
-  if (buf_size > 0) {
-    strncpy(buf, s, buf_size);
+  buf_size = buf_size > encoded_len_size ? buf_size - encoded_len_size : 0;
+  memcpy(buf, data, len < buf_size ? len : buf_size);
+  if (len > buf_size) {
+    GOB_STATS_OVERFLOW();
+    GOB_TRACE_OVERFLOW(len, buf_size);
   }
   return len + encoded_len_size;
 }
 
+int gob_encode_string(char *buf, size_t buf_size, const char *s) {
+  return gob_encode_string64(buf, buf_size, s);
+}
+
+size_t gob_encode_string64(char *buf, size_t buf_size, const char *s) {
+  size_t len = strlen(s);
+  GOB_STATS_STRING(len);
+  return gob_encode_counted(buf, buf_size, s, len);
+}
+
+int gob_encode_gob_encoder(char *buf, size_t buf_size, const char *data, size_t len) {
+  return gob_encode_gob_encoder64(buf, buf_size, data, len);
+}
+
+size_t gob_encode_gob_encoder64(char *buf, size_t buf_size, const char *data, size_t len) {
+  GOB_STATS_BYTES(len);
+  return gob_encode_counted(buf, buf_size, data, len);
+}
+
+int gob_start_gob_encoder(char *buf, size_t buf_size, size_t len) {
+  return gob_encode_unsigned_long_long(buf, buf_size, len);
+}
+
 int gob_start_type_definition(char *buf, size_t buf_size, int id, int type) {
   int total_size = 0;
   int num_bytes = 0;
   char *write_ptr = buf;
 
+  GOB_STATS_TYPE_DEFINITION();
+  GOB_TRACE_MESSAGE_START(-1*id);
+  GOB_TRACE_TYPE_DEFINITION(id, type);
+
   num_bytes = gob_start_struct(write_ptr, buf_size);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
   
   num_bytes = gob_encode_int(write_ptr, buf_size, -1*id);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
   
   int type_delta = 0;
@@ -128,11 +159,20 @@ int gob_start_type_definition(char *buf, size_t buf_size, int id, int type) {
   case GOB_MAPTYPE_ID:
     type_delta = 4;
     break;
+  case GOB_GOBENCODERTYPE_ID:
+    type_delta = 5;
+    break;
+  case GOB_BINARY_MARSHALER:
+    type_delta = 6;
+    break;
+  case GOB_TEXT_MARSHALER:
+    type_delta = 7;
+    break;
   }
 
   num_bytes = gob_encode_unsigned_int(write_ptr, buf_size, type_delta);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
 
   return total_size;
@@ -150,17 +190,17 @@ int gob_start_struct_type(char *buf, size_t buf_size, const char *name, int id)
 
   num_bytes = gob_start_struct(write_ptr, buf_size);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
   
   num_bytes = gob_encode_unsigned_int(write_ptr, buf_size, 1);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
   
   num_bytes = gob_encode_common_type(write_ptr, buf_size, name, id);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
   
   return total_size;
@@ -178,7 +218,7 @@ int gob_encode_string_int_helper(char *buf, size_t buf_size, const char *name, i
 
   num_bytes = gob_start_struct(write_ptr, buf_size);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
 
   int fieldDelta = 1;
@@ -187,27 +227,27 @@ int gob_encode_string_int_helper(char *buf, size_t buf_size, const char *name, i
   } else {
     num_bytes = gob_encode_unsigned_int(write_ptr, buf_size, fieldDelta);
     write_ptr += num_bytes;
-    buf_size -= num_bytes;
+    buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
     total_size += num_bytes;
     num_bytes = gob_encode_string(write_ptr, buf_size, name);
     write_ptr += num_bytes;
-    buf_size -= num_bytes;
+    buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
     total_size += num_bytes;
   }
   if (id != 0) {
     num_bytes = gob_encode_unsigned_int(write_ptr, buf_size, fieldDelta);
     write_ptr += num_bytes;
-    buf_size -= num_bytes;
+    buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
     total_size += num_bytes;
     num_bytes = gob_encode_int(write_ptr, buf_size, id);
     write_ptr += num_bytes;
-    buf_size -= num_bytes;
+    buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
     total_size += num_bytes;
   }
 
   num_bytes = gob_end_struct(write_ptr, buf_size);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
   
   return total_size;
@@ -226,17 +266,17 @@ int gob_encode_array_type(char *buf, size_t buf_size, const char *name, int id,
   char *write_ptr = buf;
   int num_bytes = gob_start_struct(write_ptr, buf_size);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
 
   num_bytes = gob_encode_unsigned_int(write_ptr, buf_size, 1);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
 
   num_bytes = gob_encode_common_type(write_ptr, buf_size, name, id);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
   
   int field_delta = 1;
@@ -245,11 +285,11 @@ int gob_encode_array_type(char *buf, size_t buf_size, const char *name, int id,
   } else {
     num_bytes = gob_encode_unsigned_int(write_ptr, buf_size, field_delta);
     write_ptr += num_bytes;
-    buf_size -= num_bytes;
+    buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
     total_size += num_bytes;
     num_bytes = gob_encode_int(write_ptr, buf_size, elem_type);
     write_ptr += num_bytes;
-    buf_size -= num_bytes;
+    buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
     total_size += num_bytes;
   }
 
@@ -258,17 +298,17 @@ int gob_encode_array_type(char *buf, size_t buf_size, const char *name, int id,
   } else {
     num_bytes = gob_encode_unsigned_int(write_ptr, buf_size, field_delta);
     write_ptr += num_bytes;
-    buf_size -= num_bytes;
+    buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
     total_size += num_bytes;
     num_bytes = gob_encode_int(write_ptr, buf_size, len);
     write_ptr += num_bytes;
-    buf_size -= num_bytes;
+    buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
     total_size += num_bytes;
   }
 
   num_bytes = gob_end_struct(write_ptr, buf_size);
   write_ptr += num_bytes;
-  buf_size -= num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
   total_size += num_bytes;
   
   return total_size;
@@ -279,8 +319,23 @@ int gob_encode_slice_type(char *buf, size_t buf_size, const char *name, int id,
   return gob_encode_array_type(buf, buf_size, name, id, elem_type, 0);
 }
 
+int gob_encode_gob_encoder_type(char *buf, size_t buf_size, const char *name, int id) {
+  // a struct with the commonType as its only field
+  int total_size = 0;
+  char *write_ptr = buf;
+  int num_bytes = gob_start_struct_type(write_ptr, buf_size, name, id);
+  write_ptr += num_bytes;
+  buf_size = buf_size > num_bytes ? buf_size - num_bytes : 0;
+  total_size += num_bytes;
+
+  num_bytes = gob_end_struct_type(write_ptr, buf_size);
+  total_size += num_bytes;
+
+  return total_size;
+}
+
 int gob_start_array(char *buf, size_t buf_size, size_t size) {
-  return gob_encode_unsigned_int(buf, buf_size, size);
+  return gob_encode_unsigned_long_long(buf, buf_size, size);
 }
 
 int gob_end_array(char *buf, size_t buf_size) {
@@ -288,13 +343,60 @@ int gob_end_array(char *buf, size_t buf_size) {
 }
 
 int gob_start_slice(char *buf, size_t buf_size, size_t size) {
-  return gob_encode_unsigned_int(buf, buf_size, size);
+  return gob_encode_unsigned_long_long(buf, buf_size, size);
 }
 
 int gob_end_slice(char *buf, size_t buf_size) {
   return 0;
 }
 
+#define GOB_SLICE_LONG_LONG (1)
+#define GOB_SLICE_ULL       (2)
+#define GOB_SLICE_DOUBLE    (3)
+
+// Encodes a slice of numbers: in place while there is room for the longest
+// element, then through the checked encoders, and once the buffer is full
+// only counting.  kind is a constant, so each caller gets a loop of its own.
+static inline __attribute__((always_inline))
+size_t gob_encode_number_slice(char *buf, size_t buf_size, int kind, const void *v, size_t n) {
+  const long long *ll = v;
+  const unsigned long long *ull = v;
+  const double *d = v;
+  size_t pos = gob_encode_unsigned_long_long(buf, buf_size, n);
+  size_t i = 0;
+
+  for (; i < n && pos + sizeof(unsigned long long) + 1 <= buf_size; i++) {
+    pos += kind == GOB_SLICE_LONG_LONG ? gob_put_int(buf + pos, ll[i]) :
+      kind == GOB_SLICE_ULL ? gob_put_uint(buf + pos, ull[i]) : gob_put_double(buf + pos, d[i]);
+  }
+  for (; i < n && pos < buf_size; i++) {
+    pos += kind == GOB_SLICE_LONG_LONG ? gob_encode_long_long(buf + pos, buf_size - pos, ll[i]) :
+      kind == GOB_SLICE_ULL ? gob_encode_unsigned_long_long(buf + pos, buf_size - pos, ull[i]) :
+      gob_encode_double(buf + pos, buf_size - pos, d[i]);
+  }
+  for (; i < n; i++) {
+    pos += kind == GOB_SLICE_LONG_LONG ? gob_uint_size(gob_zigzag(ll[i])) :
+      kind == GOB_SLICE_ULL ? gob_uint_size(ull[i]) : gob_double_size(d[i]);
+  }
+  if (pos > buf_size) {
+    GOB_STATS_OVERFLOW();
+    GOB_TRACE_OVERFLOW(pos, buf_size);
+  }
+  return pos;
+}
+
+size_t gob_encode_long_long_slice(char *buf, size_t buf_size, const long long *v, size_t n) {
+  return gob_encode_number_slice(buf, buf_size, GOB_SLICE_LONG_LONG, v, n);
+}
+
+size_t gob_encode_unsigned_long_long_slice(char *buf, size_t buf_size, const unsigned long long *v, size_t n) {
+  return gob_encode_number_slice(buf, buf_size, GOB_SLICE_ULL, v, n);
+}
+
+size_t gob_encode_double_slice(char *buf, size_t buf_size, const double *v, size_t n) {
+  return gob_encode_number_slice(buf, buf_size, GOB_SLICE_DOUBLE, v, n);
+}
+
 int gob_start_struct(char *buf, size_t buf_size) {
   return 0;
 }
@@ -303,6 +405,64 @@ int gob_end_struct(char *buf, size_t buf_size) {
   if (buf_size >= 1) {
     *buf = '\0';
   }
+  GOB_STATS_VARINT(1);
   return 1;
 }
 
+int gob_start_message(char *buf, size_t buf_size, int id) {
+  GOB_TRACE_MESSAGE_START(id);
+  return gob_encode_int(buf, buf_size, id);
+}
+
+// Reads back the signed type id a message body starts with.  Returns 0 if the
+// body is too short to hold one.
+static inline int gob_peek_type_id(const char *buf, size_t buf_size) {
+  const unsigned char *p = (const unsigned char*)buf;
+  unsigned long long u = 0;
+  size_t n;
+  size_t i;
+
+  if (buf_size < 1) {
+    return 0;
+  }
+  if (p[0] < 128) {
+    u = p[0];
+  } else {
+    n = (unsigned char)(-(signed char)p[0]);
+    if (n > sizeof(unsigned long long) || n + 1 > buf_size) {
+      return 0;
+    }
+    for (i = 1; i <= n; i++) {
+      u = (u << 8) | p[i];
+    }
+  }
+  return (u & 1) ? (int)~(u >> 1) : (int)(u >> 1);
+}
+
+int gob_end_message(char *buf, size_t buf_size, size_t body_len) {
+  return gob_end_message64(buf, buf_size, body_len);
+}
+
+size_t gob_end_message64(char *buf, size_t buf_size, size_t body_len) {
+  char prefix[sizeof(unsigned long long)+1];
+  int prefix_len = gob_encode_unsigned_long_long(prefix, sizeof(prefix), body_len);
+  size_t total_size = prefix_len + body_len;
+  size_t move_len = body_len;
+
+  if (buf_size >= prefix_len) {
+    if (move_len > buf_size - prefix_len) {
+      move_len = buf_size - prefix_len;
+    }
+    memmove(buf + prefix_len, buf, move_len);
+    memcpy(buf, prefix, prefix_len);
+  }
+#if defined(GOB_ENABLE_STATS) || GOB_TRACE_ENABLED
+  if (total_size <= buf_size) {
+    int id = gob_peek_type_id(buf + prefix_len, body_len);
+    GOB_STATS_MESSAGE(id < 0 ? -id : id, total_size);
+    GOB_TRACE_MESSAGE_END(id, total_size);
+  }
+#endif
+  return total_size;
+}
+
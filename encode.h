@@ -3,10 +3,14 @@
 
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Allocates a new type ID.
  *
- * Note that this method is not thread-safe.
+ * Safe to call from several threads, e.g. producers sharing a gob_mpsc.
  *
  * @return
  *   An identifier for the representation of a type in a gob stream.
@@ -201,10 +205,70 @@ int gob_encode_double(char *buf, size_t buf_size, double d);
  * @return
  *   The number of bytes that would have been written by the encode operation.
  *   A return value greater than buf_size indicates a partial encode has
- *   occurred (buffer overflow).
+ *   occurred (buffer overflow).  Strings of 2 GiB or more need
+ *   gob_encode_string64().
  */
 int gob_encode_string(char *buf, size_t buf_size, const char *s);
 
+/**
+ * Encodes the value of a type that encodes itself.
+ *
+ * From the gob package documentation: "GobEncoder [...] values are sent as
+ * an unsigned count followed by that many uninterpreted bytes of the value",
+ * the bytes being what the type's GobEncode(), MarshalBinary() or
+ * MarshalText() method returns.  They are copied as they are.
+ *
+ * Like other values, a top-level value is preceded by a zero field delta and
+ * a struct field by the field's delta.
+ *
+ * @param buf
+ *   The buffer into which to encode the given value.  The pointer must point
+ *   to "empty" space in the buffer.
+ * @param buf_size
+ *   The number of bytes in buf available for writing
+ * @param data
+ *   The encoded value
+ * @param len
+ *   The number of bytes of data
+ *
+ * @return
+ *   The number of bytes that would have been written by the encode operation.
+ *   A return value greater than buf_size indicates a partial encode has
+ *   occurred (buffer overflow).  Values of 2 GiB or more need
+ *   gob_encode_gob_encoder64().
+ */
+int gob_encode_gob_encoder(char *buf, size_t buf_size, const char *data, size_t len);
+
+/**
+ * Encodes the count in front of the value of a type that encodes itself.
+ *
+ * With this method the value's bytes need not be copied into the message,
+ * they can be written out with the rest of the message in one writev():
+ *
+ * /code
+ * head_len = gob_start_message(head, sizeof(head), id);
+ * head_len += gob_encode_unsigned_int(head+head_len, sizeof(head)-head_len, 0);
+ * head_len += gob_start_gob_encoder(head+head_len, sizeof(head)-head_len, len);
+ * prefix_len = gob_encode_unsigned_long_long(prefix, sizeof(prefix), head_len + len);
+ * ...iovecs of prefix, head and data...
+ * gob_writer_writev(&writer, iov, 3);
+ * /endcode
+ *
+ * @param buf
+ *   The buffer into which to encode the count.  The pointer must point to
+ *   "empty" space in the buffer.
+ * @param buf_size
+ *   The number of bytes in buf available for writing
+ * @param len
+ *   The number of bytes of the value that follow
+ *
+ * @return
+ *   The number of bytes that would have been written by the encode operation.
+ *   A return value greater than buf_size indicates a partial encode has
+ *   occurred (buffer overflow).
+ */
+int gob_start_gob_encoder(char *buf, size_t buf_size, size_t len);
+
 ///////////////////////////////////////////////////////////////////////////////
 // More complex built-in types
 
@@ -379,15 +443,18 @@ int gob_end_struct(char *buf, size_t buf_size);
  *
  * /code
  * type wireType struct {
- *    arrayT  *arrayType
- *    sliceT  *sliceType
- *    structT *structType
- *    mapT    *mapType
+ *    arrayT           *arrayType
+ *    sliceT           *sliceType
+ *    structT          *structType
+ *    mapT             *mapType
+ *    gobEncoderT      *gobEncoderType
+ *    binaryMarshalerT *gobEncoderType
+ *    textMarshalerT   *gobEncoderType
  * }
  * /endcode
  *
  * The client is responsible for encoding the value of an arrayT sliceT
- * structT or mapT, before a call to gob_end_type_definition()
+ * structT mapT or gobEncoderType, before a call to gob_end_type_definition()
  *
  * @param buf
  *   The buffer into which to encode the given number.  The pointer must point
@@ -398,7 +465,8 @@ int gob_end_struct(char *buf, size_t buf_size);
  *   The (positive) type id, as returned from gob_allocate_type_id()
  * @param type
  *   One of GOB_ARRAYTYPE_ID, GOB_SLICETYPE_ID, GOB_STRUCTTYPE_ID,
- *   GOB_MAPTYPE_ID
+ *   GOB_MAPTYPE_ID, GOB_GOBENCODERTYPE_ID, GOB_BINARY_MARSHALER or
+ *   GOB_TEXT_MARSHALER
  *
  * @return
  *   The number of bytes that would have been written by the encode operation.
@@ -407,6 +475,16 @@ int gob_end_struct(char *buf, size_t buf_size);
  */
 int gob_start_type_definition(char *buf, size_t buf_size, int id, int type);
 
+/**
+ * Types of gob_start_type_definition() for Go types that encode themselves
+ * through encoding.BinaryMarshaler and encoding.TextMarshaler rather than
+ * GobEncoder (GOB_GOBENCODERTYPE_ID).  All three are described by a
+ * gobEncoderType, but the Go decoder insists on the interface it knows the
+ * type by.  They are not type ids.
+ */
+#define GOB_BINARY_MARSHALER (-6)
+#define GOB_TEXT_MARSHALER   (-7)
+
 /**
  * Encodes the suffix of a type definition.
  *
@@ -605,5 +683,122 @@ int gob_encode_array_type(char *buf, size_t buf_size, const char *name, int id,
  */
 int gob_encode_slice_type(char *buf, size_t buf_size, const char *name, int id, int elem_type);
 
+/**
+ * Encodes the gobEncoderType struct.
+ *
+ * This method encodes an entire instance of the gobEncoderType struct, which
+ * describes a type that encodes itself, e.g. time.Time:
+ *
+ * /code
+ * type gobEncoderType struct {
+ *   commonType
+ * }
+ * /endcode
+ *
+ * Its values are encoded with gob_encode_gob_encoder().
+ *
+ * @param buf
+ *   The buffer into which to encode the given number.  The pointer must point
+ *   to "empty" space in the buffer.
+ * @param buf_size
+ *   The number of bytes in buf available for writing
+ * @param name
+ *   A zero-terminated (C-style) string representing the name of the type.
+ * @param id
+ *   The id of the type, as returned by gob_allocate_type_id()
+ */
+int gob_encode_gob_encoder_type(char *buf, size_t buf_size, const char *name, int id);
+
+///////////////////////////////////////////////////////////////////////////////
+// Messages
+
+/**
+ * Encodes the prefix of a value message.
+ *
+ * Every message in a gob stream is sent as its length in bytes (an unsigned
+ * count) followed by the signed type id and the value or type definition.
+ *
+ * This method simply encodes the type id.  Type definitions start with
+ * gob_start_type_definition() instead.  Either way the length prefix is added
+ * afterwards by gob_end_message().
+ *
+ * @param buf
+ *   The buffer into which to encode the given number.  The pointer must point
+ *   to "empty" space in the buffer.
+ * @param buf_size
+ *   The number of bytes in buf available for writing
+ * @param id
+ *   The type id of the value, as returned from gob_allocate_type_id()
+ *
+ * @return
+ *   The number of bytes that would have been written by the encode operation.
+ *   A return value greater than buf_size indicates a partial encode has
+ *   occurred (buffer overflow).
+ */
+int gob_start_message(char *buf, size_t buf_size, int id);
+
+/**
+ * Frames a completely encoded message.
+ *
+ * The message body (starting with the type id written by gob_start_message()
+ * or gob_start_type_definition()) must already be in buf.  This method moves
+ * the body up by the size of the length prefix and writes the prefix in front
+ * of it, so the caller does not need to precompute the message length.
+ *
+ * @param buf
+ *   The buffer holding the message body at its start.
+ * @param buf_size
+ *   The number of bytes in buf available for writing, including the body.
+ * @param body_len
+ *   The number of bytes of the message body.
+ *
+ * @return
+ *   The size of the framed message, prefix included.  A return value greater
+ *   than buf_size indicates the end of the message was cut off.  Messages of
+ *   2 GiB or more need gob_end_message64().
+ */
+int gob_end_message(char *buf, size_t buf_size, size_t body_len);
+
+///////////////////////////////////////////////////////////////////////////////
+// Large values and messages
+//
+// The encoders above return int, which cannot hold the size of a value or
+// message of 2 GiB or more.  Counts are never narrowed; these counterparts
+// also return sizes as size_t.  Slices of numbers are best encoded whole,
+// here or in chunks that stream out (see gob_chunk_long_long_slice() in
+// chunk.h), so a multi-GB message need not be encoded element by element.
+
+/**
+ * gob_encode_string(), gob_encode_gob_encoder() and gob_end_message() with
+ * the size as size_t.
+ */
+size_t gob_encode_string64(char *buf, size_t buf_size, const char *s);
+size_t gob_encode_gob_encoder64(char *buf, size_t buf_size, const char *data, size_t len);
+size_t gob_end_message64(char *buf, size_t buf_size, size_t body_len);
+
+/**
+ * Encodes a whole slice of numbers: the count, as gob_start_slice(), followed
+ * by the elements, as gob_encode_long_long(), gob_encode_unsigned_long_long()
+ * or gob_encode_double().  Elements are written straight into buf while
+ * there is room for the longest, without a call or check per element, so
+ * bytes of buf after the encoding may be overwritten as well.
+ *
+ * @param v
+ *   The elements
+ * @param n
+ *   The number of elements
+ *
+ * @return
+ *   The number of bytes that would have been written by the encode operation.
+ *   A return value greater than buf_size indicates a partial encode has
+ *   occurred (buffer overflow).
+ */
+size_t gob_encode_long_long_slice(char *buf, size_t buf_size, const long long *v, size_t n);
+size_t gob_encode_unsigned_long_long_slice(char *buf, size_t buf_size, const unsigned long long *v, size_t n);
+size_t gob_encode_double_slice(char *buf, size_t buf_size, const double *v, size_t n);
+
+#ifdef __cplusplus
+}
 #endif
 
+#endif
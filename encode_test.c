@@ -5,6 +5,9 @@
 #include "gob.h"
 #include "encode.h"
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 unsigned long long flip_unsigned_long_long(unsigned long long ull);
 
@@ -258,7 +261,7 @@ void test_gob_encode_simple_type() {
 }
 
 
-void test_gob_encode_more_complex_type() {
+int encode_more_complex_type(char *buf) {
 
   //Encodes the following types and a value:
   //
@@ -272,8 +275,8 @@ void test_gob_encode_more_complex_type() {
   //	Fields []FieldData
   //}
   //
+  // into buf, which holds 1024 bytes.
 
-  char buf[1024];
   memset(buf, '\0', 1024);
   int num_bytes = 0;
   int total_bytes = 0;
@@ -367,7 +370,7 @@ void test_gob_encode_more_complex_type() {
   /////////////////////////////////////////////////////////////////
 
   // precomputed message len...
-  num_bytes = gob_encode_unsigned_int(write_ptr, 1024, 42); 
+  num_bytes = gob_encode_unsigned_int(write_ptr, 1024, 43); 
   total_bytes += num_bytes;
   write_ptr += num_bytes;
   CU_ASSERT(total_bytes < 1024);
@@ -497,6 +500,12 @@ void test_gob_encode_more_complex_type() {
   write_ptr += num_bytes;
   CU_ASSERT(total_bytes < 1024);
 
+  return total_bytes;
+}
+
+void test_gob_encode_more_complex_type() {
+  char buf[1024];
+  int total_bytes = encode_more_complex_type(buf);
 
   char result_buf[] = {
     0x2b,  // len
@@ -539,7 +548,7 @@ void test_gob_encode_more_complex_type() {
     0xff, 0x84, // id
     0x00,   // end of sliceType
     0x00,   // end of wireType
-    0x2a,   // len
+    0x2b,   // len
     0xff, 0x83, // id
     0x03,   // offset into wireType (struct type)
     0x01,   // offset of common type
@@ -592,3 +601,213 @@ void test_gob_encode_more_complex_type() {
   CU_ASSERT(memcmp(result_buf, buf, total_bytes) == 0);
 
 }
+
+void test_gob_end_message() {
+  char buf[1024];
+  memset(buf, '\0', 1024);
+  int total_bytes = 0;
+
+  total_bytes += gob_start_message(buf, 1024, 65);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, 1024-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, 1024-total_bytes, "hello");
+  total_bytes += gob_end_struct(buf+total_bytes, 1024-total_bytes);
+  CU_ASSERT_EQUAL(10, total_bytes);
+
+  int num_bytes = gob_end_message(buf, 1024, total_bytes);
+  CU_ASSERT_EQUAL(11, num_bytes);
+
+  char result_buf[] = {
+    0x0a, // message length of 10
+    0xff, 0x82,// type id 65
+    0x01, // field delta for name string
+    0x05, // string length
+    0x68, 0x65, 0x6c, 0x6c, 0x6f, // "hello"
+    0x00 // end MyType
+  };
+  CU_ASSERT(memcmp(result_buf, buf, num_bytes) == 0);
+
+  // test buffer too small: the body is cut off, the prefix is intact
+  memset(buf, '\0', 1024);
+  memcpy(buf, result_buf+1, 10);
+  num_bytes = gob_end_message(buf, 10, 10);
+  CU_ASSERT_EQUAL(11, num_bytes);
+  CU_ASSERT(memcmp(result_buf, buf, 10) == 0);
+  CU_ASSERT_EQUAL((char)0, buf[10]);
+}
+
+void test_gob_encode_sizing() {
+  // a buffer size of 0 only computes the encoded size
+  char buf[64];
+  memset(buf, 0x55, 64);
+  CU_ASSERT_EQUAL(1, gob_encode_unsigned_int(buf, 0, 7));
+  CU_ASSERT_EQUAL(3, gob_encode_unsigned_int(buf, 0, 256));
+  CU_ASSERT_EQUAL(19, gob_encode_string(buf, 0, "I love unit tests!"));
+  CU_ASSERT_EQUAL(13, gob_start_struct_type(buf, 0, "MyType", 65));
+  CU_ASSERT_EQUAL((char)0x55, buf[0]);
+
+  // a partial encode stays within the buffer
+  CU_ASSERT_EQUAL(13, gob_start_struct_type(buf, 4, "MyType", 65));
+  CU_ASSERT_EQUAL((char)0x55, buf[4]);
+  CU_ASSERT_EQUAL((char)0x55, buf[5]);
+}
+
+void test_gob_encode_gob_encoder() {
+  // Encodes a struct with a time.Time field, which is a GobEncoder:
+  // type Event struct {
+  //     Name string
+  //     At   time.Time
+  // }
+  // Event{"boot", time.Date(2020, 1, 2, 3, 4, 5, 6, time.UTC)}
+  static const char time_bytes[] = {
+    0x01, 0x00, 0x00, 0x00, 0x0e, 0xd5, 0x9f, 0x54, 0xa5, 0x00, 0x00, 0x00, 0x06, 0xff, 0xff
+  };
+  char buf[1024];
+  char head[64];
+  char prefix[16];
+  int total_bytes = 0;
+  int start;
+  int body_len;
+  int head_len;
+  int prefix_len;
+  struct iovec iov[4];
+  int fds[2];
+  char got[128];
+  memset(buf, '\0', 1024);
+
+  start = total_bytes;
+  total_bytes += gob_start_type_definition(buf+total_bytes, 1024-total_bytes, 64, GOB_STRUCTTYPE_ID);
+  total_bytes += gob_start_struct_type(buf+total_bytes, 1024-total_bytes, "Event", 64);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, 1024-total_bytes, 1);
+  total_bytes += gob_start_slice(buf+total_bytes, 1024-total_bytes, 2);
+  total_bytes += gob_encode_field_type(buf+total_bytes, 1024-total_bytes, "Name", GOB_STRING_ID);
+  total_bytes += gob_encode_field_type(buf+total_bytes, 1024-total_bytes, "At", 65);
+  total_bytes += gob_end_slice(buf+total_bytes, 1024-total_bytes);
+  total_bytes += gob_end_struct_type(buf+total_bytes, 1024-total_bytes);
+  total_bytes += gob_end_type_definition(buf+total_bytes, 1024-total_bytes);
+  total_bytes = start + gob_end_message(buf+start, 1024-start, total_bytes-start);
+
+  start = total_bytes;
+  total_bytes += gob_start_type_definition(buf+total_bytes, 1024-total_bytes, 65, GOB_GOBENCODERTYPE_ID);
+  total_bytes += gob_encode_gob_encoder_type(buf+total_bytes, 1024-total_bytes, "Time", 65);
+  total_bytes += gob_end_type_definition(buf+total_bytes, 1024-total_bytes);
+  total_bytes = start + gob_end_message(buf+start, 1024-start, total_bytes-start);
+
+  start = total_bytes;
+  total_bytes += gob_start_message(buf+total_bytes, 1024-total_bytes, 64);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, 1024-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, 1024-total_bytes, "boot");
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, 1024-total_bytes, 1);
+  total_bytes += gob_encode_gob_encoder(buf+total_bytes, 1024-total_bytes, time_bytes, sizeof(time_bytes));
+  total_bytes += gob_end_struct(buf+total_bytes, 1024-total_bytes);
+  total_bytes = start + gob_end_message(buf+start, 1024-start, total_bytes-start);
+
+  // as written by Go's encoding/gob
+  char result_buf[] = {
+    0x23, 0x7f, 0x03, 0x01, 0x01, 0x05, 0x45, 0x76, 0x65, 0x6e, 0x74, 0x01,
+    0xff, 0x80, 0x00, 0x01, 0x02, 0x01, 0x04, 0x4e, 0x61, 0x6d, 0x65, 0x01,
+    0x0c, 0x00, 0x01, 0x02, 0x41, 0x74, 0x01, 0xff, 0x82, 0x00, 0x00, 0x00,
+    0x10,   // msg len
+    0xff, 0x81, // type id -65
+    0x05,   // offset of gobEncoderT in wireType
+    0x01,   // offset of commonType
+    0x01, 0x04, 0x54, 0x69, 0x6d, 0x65, // name "Time"
+    0x01, 0xff, 0x82, // id 65
+    0x00,   // end of commonType
+    0x00,   // end of gobEncoderType
+    0x00,   // end of wireType
+    0x1a, 0xff, 0x80, 0x01, 0x04, 0x62, 0x6f, 0x6f, 0x74,
+    0x01,   // offset of At
+    0x0f,   // byte count
+    0x01, 0x00, 0x00, 0x00, 0x0e, 0xd5, 0x9f, 0x54, 0xa5, 0x00, 0x00, 0x00, 0x06, 0xff, 0xff,
+    0x00    // end of Event
+  };
+  CU_ASSERT_EQUAL(sizeof(result_buf), total_bytes);
+  CU_ASSERT(memcmp(result_buf, buf, total_bytes) == 0);
+
+  // the same value message with the time bytes passed through
+  head_len = gob_start_message(head, sizeof(head), 64);
+  head_len += gob_encode_unsigned_int(head+head_len, sizeof(head)-head_len, 1);
+  head_len += gob_encode_string(head+head_len, sizeof(head)-head_len, "boot");
+  head_len += gob_encode_unsigned_int(head+head_len, sizeof(head)-head_len, 1);
+  head_len += gob_start_gob_encoder(head+head_len, sizeof(head)-head_len, sizeof(time_bytes));
+  body_len = head_len + sizeof(time_bytes) + 1;
+  prefix_len = gob_encode_unsigned_long_long(prefix, sizeof(prefix), body_len);
+  iov[0].iov_base = prefix;
+  iov[0].iov_len = prefix_len;
+  iov[1].iov_base = head;
+  iov[1].iov_len = head_len;
+  iov[2].iov_base = (char*)time_bytes;
+  iov[2].iov_len = sizeof(time_bytes);
+  iov[3].iov_base = "";
+  iov[3].iov_len = 1;
+  CU_ASSERT_EQUAL(0, pipe(fds));
+  CU_ASSERT_EQUAL(prefix_len + body_len, writev(fds[1], iov, 4));
+  CU_ASSERT_EQUAL(prefix_len + body_len, read(fds[0], got, sizeof(got)));
+  CU_ASSERT(memcmp(result_buf + sizeof(result_buf) - (prefix_len + body_len), got, prefix_len + body_len) == 0);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+static long long sLongLongs[1000];
+static unsigned long long sULongLongs[1000];
+static double sDoubles[1000];
+
+static size_t encode_slice(int kind, char *buf, size_t buf_size) {
+  switch (kind) {
+  case 0:
+    return gob_encode_long_long_slice(buf, buf_size, sLongLongs, 1000);
+  case 1:
+    return gob_encode_unsigned_long_long_slice(buf, buf_size, sULongLongs, 1000);
+  default:
+    return gob_encode_double_slice(buf, buf_size, sDoubles, 1000);
+  }
+}
+
+void test_gob_encode_large() {
+  static const char count[] = { 0xfb, 0x01, 0x2a, 0x05, 0xf2, 0x00 }; // 5000000000
+  static char expected[16384];
+  static char buf[16384];
+  size_t expected_len;
+  size_t buf_size;
+  size_t len;
+  int kind;
+  int i;
+
+  // counts of 2^32 elements or more are not narrowed
+  CU_ASSERT_EQUAL(6, gob_start_slice(buf, sizeof(buf), 5000000000ULL));
+  CU_ASSERT(memcmp(count, buf, 6) == 0);
+  CU_ASSERT_EQUAL(6, gob_start_array(buf, sizeof(buf), 5000000000ULL));
+  CU_ASSERT(memcmp(count, buf, 6) == 0);
+
+  // nor are sizes of 2 GiB or more; a buffer size of 0 only computes them
+  memset(buf, 0x55, 16);
+  CU_ASSERT_EQUAL(5000000006ULL, gob_encode_gob_encoder64(buf, 0, buf, 5000000000ULL));
+  CU_ASSERT_EQUAL(5000000006ULL, gob_end_message64(buf, 4, 5000000000ULL));
+  CU_ASSERT_EQUAL((char)0x55, buf[0]);
+  CU_ASSERT_EQUAL(19, gob_encode_string64(buf, sizeof(buf), "I love unit tests!"));
+  CU_ASSERT_EQUAL(18, buf[0]);
+
+  // whole slices encode as their elements one by one, also into buffers
+  // that cut them off anywhere
+  for (i = 0; i < 1000; i++) {
+    sLongLongs[i] = (i % 2 ? -1 : 1) * ((long long)i << (i % 53));
+    sULongLongs[i] = ~0ULL >> (i % 64);
+    sDoubles[i] = i * 1.25;
+  }
+  for (kind = 0; kind < 3; kind++) {
+    expected_len = gob_start_slice(expected, sizeof(expected), 1000);
+    for (i = 0; i < 1000; i++) {
+      expected_len += kind == 0 ? gob_encode_long_long(expected + expected_len, 16, sLongLongs[i]) :
+	kind == 1 ? gob_encode_unsigned_long_long(expected + expected_len, 16, sULongLongs[i]) :
+	gob_encode_double(expected + expected_len, 16, sDoubles[i]);
+    }
+    CU_ASSERT_EQUAL(expected_len, encode_slice(kind, buf, 0));
+    for (buf_size = expected_len - 20; buf_size <= expected_len + 20; buf_size++) {
+      memset(buf, 0x55, sizeof(buf));
+      len = encode_slice(kind, buf, buf_size);
+      CU_ASSERT_EQUAL(expected_len, len);
+      CU_ASSERT(memcmp(expected, buf, buf_size < len ? buf_size : len) == 0);
+      CU_ASSERT_EQUAL((char)0x55, buf[buf_size]);
+    }
+  }
+}
@@ -8,6 +8,14 @@ void test_gob_encode_int();
 void test_gob_encode_string();
 void test_gob_encode_simple_type();
 void test_gob_encode_more_complex_type();
+void test_gob_end_message();
+void test_gob_encode_sizing();
+void test_gob_encode_gob_encoder();
+void test_gob_encode_large();
+
+// The MyData stream of test_gob_encode_more_complex_type(), encoded with the
+// C API into 1024 bytes at buf; returns its size.
+int encode_more_complex_type(char *buf);
 
 #endif
 
@@ -18,5 +18,8 @@
 #define GOB_FIELDTYPE_ID       (21)
 #define GOB_FIELDTYPE_SLICE_ID (22)
 #define GOB_MAPTYPE_ID         (23)
+#define GOB_GOBENCODERTYPE_ID  (24)
+// ids of user defined types start here.
+#define GOB_FIRST_USER_ID      (64)
 
 #endif
@@ -0,0 +1,734 @@
+#ifndef _GOB_HPP
+#define _GOB_HPP
+
+// C++17 encoding and decoding of plain structs.
+//
+// Declare the fields of a struct once, at global scope:
+//
+//   struct FieldData { double fFloat; int iInt; };
+//   struct MyData { std::string MyName; std::vector<FieldData> Fields; };
+//   GOB_FIELDS(FieldData, fFloat, iInt)
+//   GOB_FIELDS(MyData, MyName, Fields)
+//
+// and the templates below generate inlined encoders and decoders for it.
+// Type ids are assigned at compile time by gob::schema<Root>, in the order
+// Go's encoder assigns them, and the type definitions are encoded at compile
+// time as well, so a stream carrying one root type looks exactly like one
+// written by Go:
+//
+//   using S = gob::schema<MyData>;
+//   std::vector<std::byte> out;
+//   gob::growable_buffer buf(out);
+//   gob::encode_type_definitions<S>(buf);
+//   gob::encode_message<S>(buf, value);
+//
+// Supported field types are bool, integers, floating point numbers,
+// std::string, std::vector<unsigned char> / std::vector<std::byte> (sent as
+// []byte), std::vector of any supported type and structs declared with
+// GOB_FIELDS.
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gob.h"
+#include "encode.h"
+
+namespace gob {
+
+// Specialized by GOB_FIELDS().
+template <class T> struct fields;
+
+///////////////////////////////////////////////////////////////////////////////
+// Output buffers
+
+// Writes into caller memory.  Like the C encoders, len keeps counting past
+// size, so len > size after encoding means the output was cut off.
+struct buffer {
+  std::byte *data;
+  size_t size;
+  size_t len;
+
+  buffer(std::byte *data, size_t size) : data(data), size(size), len(0) {}
+
+  void put(char c) {
+    if (len < size) {
+      data[len] = std::byte(c);
+    }
+    len++;
+  }
+  void put(const void *p, size_t n) {
+    if (len < size) {
+      std::memcpy(data + len, p, n < size - len ? n : size - len);
+    }
+    len += n;
+  }
+};
+
+// Appends to a vector.
+struct growable_buffer {
+  std::vector<std::byte> &out;
+
+  explicit growable_buffer(std::vector<std::byte> &out) : out(out) {}
+
+  void put(char c) {
+    out.push_back(std::byte(c));
+  }
+  void put(const void *p, size_t n) {
+    size_t len = out.size();
+    out.resize(len + n);
+    std::memcpy(out.data() + len, p, n);
+  }
+};
+
+// Only counts.
+struct counter {
+  size_t len = 0;
+
+  void put(char) {
+    len++;
+  }
+  void put(const void *, size_t n) {
+    len += n;
+  }
+};
+
+namespace detail {
+
+template <class T> struct dependent_false : std::false_type {};
+
+template <class T, class = void> struct has_fields : std::false_type {};
+template <class T> struct has_fields<T, std::void_t<decltype(fields<T>::members)>> : std::true_type {};
+
+template <class T> struct is_vector : std::false_type {};
+template <class E, class A> struct is_vector<std::vector<E, A>> : std::true_type {};
+
+template <class T> constexpr bool is_byte_v =
+  std::is_same_v<T, std::byte> || std::is_same_v<T, unsigned char> || std::is_same_v<T, char>;
+
+template <class T> struct is_byte_vector : std::false_type {};
+template <class E, class A> struct is_byte_vector<std::vector<E, A>> : std::bool_constant<is_byte_v<E>> {};
+
+template <class T> constexpr bool is_string_v = std::is_same_v<T, std::string>;
+
+// Types with a predefined id, which never need a definition.
+template <class T> constexpr bool is_builtin_v =
+  std::is_arithmetic_v<T> || is_string_v<T> || is_byte_vector<T>::value;
+
+template <class T> constexpr size_t field_count() {
+  return std::tuple_size_v<std::decay_t<decltype(fields<T>::members)>>;
+}
+
+template <class T, size_t I> using member_t =
+  std::remove_cv_t<std::remove_reference_t<decltype(std::declval<T&>().*std::get<I>(fields<T>::members))>>;
+
+template <class T> constexpr int builtin_id() {
+  if constexpr (std::is_same_v<T, bool>) {
+    return GOB_BOOL_ID;
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    return GOB_INT_ID;
+  } else if constexpr (std::is_integral_v<T>) {
+    return GOB_UINT_ID;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    return GOB_FLOAT_ID;
+  } else if constexpr (is_string_v<T>) {
+    return GOB_STRING_ID;
+  } else {
+    return GOB_BYTE_SLICE_ID;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compile time type lists
+
+template <class... Ts> struct type_list {};
+
+template <class T, class... Ts> constexpr bool contains(type_list<Ts...>) {
+  return (std::is_same_v<T, Ts> || ...);
+}
+
+template <class T, class... Ts> constexpr size_t index_of(type_list<Ts...>) {
+  size_t i = 0;
+  bool found = ((std::is_same_v<T, Ts> ? true : (i++, false)) || ...);
+  return found ? i : sizeof...(Ts);
+}
+
+template <class... Ts> constexpr size_t size(type_list<Ts...>) {
+  return sizeof...(Ts);
+}
+
+template <class T, class... Ts> constexpr auto append(type_list<Ts...>) {
+  return type_list<Ts..., T>{};
+}
+
+// Go gives a struct its id before visiting its fields, and a slice its id
+// after visiting the element type.
+template <class T, class L> constexpr auto assign_ids(L l);
+
+template <class T, size_t I, class L> constexpr auto assign_member_ids(L l) {
+  if constexpr (I == field_count<T>()) {
+    return l;
+  } else {
+    return assign_member_ids<T, I+1>(assign_ids<member_t<T, I>>(l));
+  }
+}
+
+template <class T, class L> constexpr auto assign_ids(L l) {
+  if constexpr (is_builtin_v<T> || contains<T>(L{})) {
+    return l;
+  } else if constexpr (has_fields<T>::value) {
+    return assign_member_ids<T, 0>(append<T>(l));
+  } else if constexpr (is_vector<T>::value) {
+    auto with_elem = assign_ids<typename T::value_type>(l);
+    if constexpr (contains<T>(decltype(with_elem){})) {
+      return with_elem;
+    } else {
+      return append<T>(with_elem);
+    }
+  } else {
+    static_assert(dependent_false<T>::value, "type not supported by gob, missing GOB_FIELDS()?");
+  }
+}
+
+// Go sends a type definition before the definitions of the types it uses.
+template <class T, class L> constexpr auto send_order(L l);
+
+template <class T, size_t I, class L> constexpr auto send_member_order(L l) {
+  if constexpr (I == field_count<T>()) {
+    return l;
+  } else {
+    return send_member_order<T, I+1>(send_order<member_t<T, I>>(l));
+  }
+}
+
+template <class T, class L> constexpr auto send_order(L l) {
+  if constexpr (is_builtin_v<T> || contains<T>(L{})) {
+    return l;
+  } else if constexpr (has_fields<T>::value) {
+    return send_member_order<T, 0>(append<T>(l));
+  } else {
+    return send_order<typename T::value_type>(append<T>(l));
+  }
+}
+
+} // namespace detail
+
+/**
+ * The type ids of a root type and all types it uses, starting at FirstId.
+ */
+template <class Root, int FirstId = 65> struct schema {
+  using root = Root;
+  using ids = decltype(detail::assign_ids<Root>(detail::type_list<>{}));
+  using order = decltype(detail::send_order<Root>(detail::type_list<>{}));
+
+  template <class T> static constexpr int id() {
+    if constexpr (detail::is_builtin_v<T>) {
+      return detail::builtin_id<T>();
+    } else {
+      static_assert(detail::contains<T>(ids{}), "type is not part of this schema");
+      return FirstId + (int)detail::index_of<T>(ids{});
+    }
+  }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Type definitions
+//
+// The wireType definitions only depend on the schema, so they are encoded at
+// compile time into gob::type_definitions<S>::bytes, which ends up in
+// .rodata.  The functions below produce exactly what gob_start_type_definition()
+// and friends in encode.c do.
+
+namespace detail {
+
+// A constexpr output: writes into data[] when there is one, counts otherwise.
+template <size_t N> struct static_writer {
+  char data[N > 0 ? N : 1] = {};
+  size_t len = 0;
+
+  constexpr void put(char c) {
+    if (len < N) {
+      data[len] = c;
+    }
+    len++;
+  }
+};
+
+template <class W> constexpr void ct_put_uint(W &w, unsigned long long u) {
+  if (u < 128) {
+    w.put((char)u);
+    return;
+  }
+  int n = 0;
+  for (unsigned long long v = u; v != 0; v >>= 8) {
+    n++;
+  }
+  w.put((char)-n);
+  for (int i = n-1; i >= 0; i--) {
+    w.put((char)(u >> (8*i)));
+  }
+}
+
+template <class W> constexpr void ct_put_int(W &w, long long i) {
+  ct_put_uint(w, i < 0 ? (((unsigned long long)~i) << 1) | 1 : ((unsigned long long)i) << 1);
+}
+
+constexpr size_t ct_strlen(const char *s) {
+  size_t n = 0;
+  while (s[n] != '\0') {
+    n++;
+  }
+  return n;
+}
+
+template <class W> constexpr void ct_put_chars(W &w, const char *s) {
+  for (size_t i = 0; s[i] != '\0'; i++) {
+    w.put(s[i]);
+  }
+}
+
+// The Go name of a type: the qualified struct name, or e.g. "[]main.T".
+template <class T> constexpr const char *builtin_name() {
+  switch (builtin_id<T>()) {
+  case GOB_BOOL_ID: return "bool";
+  case GOB_INT_ID: return "int";
+  case GOB_UINT_ID: return "uint";
+  case GOB_FLOAT_ID: return "float64";
+  case GOB_STRING_ID: return "string";
+  default: return "[]uint8";
+  }
+}
+
+template <class T> constexpr size_t type_name_len() {
+  if constexpr (is_builtin_v<T>) {
+    return ct_strlen(builtin_name<T>());
+  } else if constexpr (has_fields<T>::value) {
+    return ct_strlen(fields<T>::qualified_name);
+  } else {
+    return 2 + type_name_len<typename T::value_type>();
+  }
+}
+
+template <class T, class W> constexpr void put_type_name(W &w) {
+  if constexpr (is_builtin_v<T>) {
+    ct_put_chars(w, builtin_name<T>());
+  } else if constexpr (has_fields<T>::value) {
+    ct_put_chars(w, fields<T>::qualified_name);
+  } else {
+    w.put('[');
+    w.put(']');
+    put_type_name<typename T::value_type>(w);
+  }
+}
+
+// gob_encode_string_int_helper(): a commonType or fieldType.
+template <class W> constexpr void put_name_and_id(W &w, const char *name, size_t name_len, int id) {
+  unsigned int delta = 1;
+  if (name_len == 0) {
+    delta++;
+  } else {
+    ct_put_uint(w, delta);
+    ct_put_uint(w, name_len);
+    ct_put_chars(w, name);
+  }
+  if (id != 0) {
+    ct_put_uint(w, delta);
+    ct_put_int(w, id);
+  }
+  w.put('\0');
+}
+
+template <class S, class T, class W, size_t... I> constexpr void put_field_types(W &w, std::index_sequence<I...>) {
+  (put_name_and_id(w, fields<T>::names[I], ct_strlen(fields<T>::names[I]), S::template id<member_t<T, I>>()), ...);
+}
+
+// The body of the type definition message for T.
+template <class S, class T, class W> constexpr void put_type_definition(W &w) {
+  constexpr int id = S::template id<T>();
+  ct_put_int(w, -id);
+  if constexpr (has_fields<T>::value) {
+    ct_put_uint(w, 3);                     // wireType.structT
+    ct_put_uint(w, 1);                     // structType.commonType
+    put_name_and_id(w, fields<T>::name, ct_strlen(fields<T>::name), id);
+    if constexpr (field_count<T>() > 0) {
+      ct_put_uint(w, 1);                   // structType.field
+      ct_put_uint(w, field_count<T>());
+      put_field_types<S, T>(w, std::make_index_sequence<field_count<T>()>{});
+    }
+  } else {
+    constexpr int elem = S::template id<typename T::value_type>();
+    ct_put_uint(w, 2);                     // wireType.sliceT
+    ct_put_uint(w, 1);                     // sliceType.commonType
+    ct_put_uint(w, 1);                     // commonType.name
+    ct_put_uint(w, type_name_len<T>());
+    put_type_name<T>(w);
+    ct_put_uint(w, 1);                     // commonType.id
+    ct_put_int(w, id);
+    w.put('\0');
+    ct_put_uint(w, 1);                     // sliceType.elem
+    ct_put_int(w, elem);
+  }
+  w.put('\0');                             // end of structType / sliceType
+  w.put('\0');                             // end of wireType
+}
+
+template <class S, class W, class... Ts> constexpr void put_type_definitions(W &w, type_list<Ts...>) {
+  (([&] {
+      static_writer<0> body;
+      put_type_definition<S, Ts>(body);
+      ct_put_uint(w, body.len);
+      put_type_definition<S, Ts>(w);
+    }()), ...);
+}
+
+template <class S> constexpr size_t type_definitions_size() {
+  static_writer<0> w;
+  put_type_definitions<S>(w, typename S::order{});
+  return w.len;
+}
+
+template <class S> constexpr auto make_type_definitions() {
+  static_writer<type_definitions_size<S>()> w;
+  put_type_definitions<S>(w, typename S::order{});
+  return w;
+}
+
+} // namespace detail
+
+/**
+ * The framed type definition messages for all types of schema S, in the
+ * order Go sends them, computed at compile time.
+ */
+template <class S> struct type_definitions {
+  static constexpr size_t size = detail::type_definitions_size<S>();
+  static constexpr auto bytes = detail::make_type_definitions<S>();
+  static constexpr const char *data() {
+    return bytes.data;
+  }
+};
+
+/**
+ * Encodes the type definition messages for all types of the schema.  This
+ * only copies type_definitions<S>.
+ */
+template <class S, class Sink> inline void encode_type_definitions(Sink &s) {
+  s.put(type_definitions<S>::data(), type_definitions<S>::size);
+}
+
+namespace detail {
+
+///////////////////////////////////////////////////////////////////////////////
+// Encoding
+
+template <class Sink> inline void put_uint(Sink &s, unsigned long long u) {
+  if (u < 128) {
+    s.put((char)u);
+    return;
+  }
+  char tmp[sizeof(unsigned long long)+1];
+  int n = (int)sizeof(unsigned long long) - __builtin_clzll(u) / 8;
+  tmp[0] = (char)-n;
+  for (int i = 1; i <= n; i++) {
+    tmp[i] = (char)(u >> (8*(n-i)));
+  }
+  s.put(tmp, n+1);
+}
+
+template <class Sink> inline void put_int(Sink &s, long long i) {
+  unsigned long long u = i < 0 ? (((unsigned long long)~i) << 1) | 1 : ((unsigned long long)i) << 1;
+  put_uint(s, u);
+}
+
+template <class Sink> inline void put_double(Sink &s, double d) {
+  unsigned long long u;
+  std::memcpy(&u, &d, sizeof(u));
+  put_uint(s, __builtin_bswap64(u));
+}
+
+template <class T> inline bool is_zero(const T &v) {
+  if constexpr (std::is_arithmetic_v<T>) {
+    return v == 0;
+  } else if constexpr (has_fields<T>::value) {
+    return false;   // structs are always sent
+  } else {
+    return v.empty();
+  }
+}
+
+template <class Sink, class T> inline void encode_value(Sink &s, const T &v);
+
+template <class Sink, class T, size_t I> inline void encode_field(Sink &s, const T &v, int &last) {
+  const auto &m = v.*std::get<I>(fields<T>::members);
+  if (is_zero(m)) {
+    return;
+  }
+  put_uint(s, (unsigned long long)((int)I - last));
+  last = (int)I;
+  encode_value(s, m);
+}
+
+template <class Sink, class T, size_t... I> inline void encode_struct(Sink &s, const T &v, std::index_sequence<I...>) {
+  int last = -1;
+  (encode_field<Sink, T, I>(s, v, last), ...);
+  s.put('\0');
+}
+
+template <class Sink, class T> inline void encode_value(Sink &s, const T &v) {
+  if constexpr (std::is_same_v<T, bool>) {
+    put_uint(s, v ? 1 : 0);
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    put_int(s, v);
+  } else if constexpr (std::is_integral_v<T>) {
+    put_uint(s, v);
+  } else if constexpr (std::is_floating_point_v<T>) {
+    put_double(s, v);
+  } else if constexpr (is_string_v<T> || is_byte_vector<T>::value) {
+    put_uint(s, v.size());
+    s.put(v.data(), v.size());
+  } else if constexpr (is_vector<T>::value) {
+    put_uint(s, v.size());
+    for (const auto &e : v) {
+      encode_value(s, e);
+    }
+  } else if constexpr (has_fields<T>::value) {
+    encode_struct(s, v, std::make_index_sequence<field_count<T>()>{});
+  } else {
+    static_assert(dependent_false<T>::value, "type not supported by gob, missing GOB_FIELDS()?");
+  }
+}
+
+// A value message body: the type id, then the value.  Non-struct values are
+// sent as a singleton field with delta 0.
+template <class Sink, class T> inline void encode_body(Sink &s, int id, const T &v) {
+  put_int(s, id);
+  if constexpr (!has_fields<T>::value) {
+    s.put('\0');
+  }
+  encode_value(s, v);
+}
+
+} // namespace detail
+
+/**
+ * Encodes a framed value message of the schema's root type (or any other
+ * type of the schema).
+ */
+template <class S, class Sink, class T> inline void encode_message(Sink &s, const T &v) {
+  constexpr int id = S::template id<T>();
+  counter c;
+  detail::encode_body(c, id, v);
+  detail::put_uint(s, c.len);
+  detail::encode_body(s, id, v);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Decoding
+
+/**
+ * Reads from caller memory.  ok turns false on truncated or malformed input.
+ */
+struct reader {
+  const std::byte *data;
+  size_t size;
+  size_t pos;
+  bool ok;
+
+  reader(const std::byte *data, size_t size) : data(data), size(size), pos(0), ok(true) {}
+
+  unsigned long long get_uint() {
+    if (pos >= size) {
+      ok = false;
+      return 0;
+    }
+    unsigned char c = (unsigned char)data[pos++];
+    if (c < 128) {
+      return c;
+    }
+    size_t n = (unsigned char)-(signed char)c;
+    if (n > sizeof(unsigned long long) || n > size - pos) {
+      ok = false;
+      return 0;
+    }
+    unsigned long long u = 0;
+    for (size_t i = 0; i < n; i++) {
+      u = (u << 8) | (unsigned char)data[pos++];
+    }
+    return u;
+  }
+  long long get_int() {
+    unsigned long long u = get_uint();
+    return (u & 1) ? (long long)~(u >> 1) : (long long)(u >> 1);
+  }
+  double get_double() {
+    unsigned long long u = __builtin_bswap64(get_uint());
+    double d;
+    std::memcpy(&d, &u, sizeof(d));
+    return d;
+  }
+  const std::byte *get_bytes(size_t n) {
+    if (n > size - pos) {
+      ok = false;
+      return nullptr;
+    }
+    pos += n;
+    return data + pos - n;
+  }
+};
+
+namespace detail {
+
+template <class T> inline void decode_value(reader &r, T &v);
+
+template <class T, size_t... I> inline bool decode_field(reader &r, T &v, size_t field, std::index_sequence<I...>) {
+  return ((field == I ? (decode_value(r, v.*std::get<I>(fields<T>::members)), true) : false) || ...);
+}
+
+template <class T> inline void decode_struct(reader &r, T &v) {
+  size_t field = (size_t)-1;
+  for (;;) {
+    unsigned long long delta = r.get_uint();
+    if (!r.ok || delta == 0) {
+      return;
+    }
+    field += delta;
+    if (!decode_field(r, v, field, std::make_index_sequence<field_count<T>()>{})) {
+      r.ok = false;
+      return;
+    }
+    if (!r.ok) {
+      return;
+    }
+  }
+}
+
+template <class T> inline void decode_value(reader &r, T &v) {
+  if constexpr (std::is_same_v<T, bool>) {
+    v = r.get_uint() != 0;
+  } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+    v = (T)r.get_int();
+  } else if constexpr (std::is_integral_v<T>) {
+    v = (T)r.get_uint();
+  } else if constexpr (std::is_floating_point_v<T>) {
+    v = (T)r.get_double();
+  } else if constexpr (is_string_v<T> || is_byte_vector<T>::value) {
+    size_t n = r.get_uint();
+    const std::byte *p = r.get_bytes(n);
+    if (p != nullptr) {
+      v.resize(n);
+      std::memcpy(v.data(), p, n);
+    }
+  } else if constexpr (is_vector<T>::value) {
+    size_t n = r.get_uint();
+    // every element takes at least one byte
+    if (!r.ok || n > r.size - r.pos) {
+      r.ok = false;
+      return;
+    }
+    v.clear();
+    v.resize(n);
+    for (size_t i = 0; i < n && r.ok; i++) {
+      decode_value(r, v[i]);
+    }
+  } else if constexpr (has_fields<T>::value) {
+    decode_struct(r, v);
+  } else {
+    static_assert(dependent_false<T>::value, "type not supported by gob, missing GOB_FIELDS()?");
+  }
+}
+
+} // namespace detail
+
+/**
+ * Decodes the next value message of type T, skipping type definitions.
+ *
+ * Fields missing from the message (gob omits zero values) are left alone,
+ * so v should start out value-initialized.
+ *
+ * @return
+ *   The number of bytes consumed, 0 if the input ends before the message
+ *   does, -1 if it is malformed or the message holds a different type.
+ */
+template <class S, class T> inline long decode_message(const std::byte *data, size_t size, T &v) {
+  reader r(data, size);
+  for (;;) {
+    size_t len = r.get_uint();
+    if (!r.ok || len > r.size - r.pos) {
+      return 0;
+    }
+    reader body(r.data + r.pos, len);
+    r.pos += len;
+    long long id = body.get_int();
+    if (!body.ok) {
+      return -1;
+    }
+    if (id < 0) {
+      continue;
+    }
+    if (id != S::template id<T>()) {
+      return -1;
+    }
+    if constexpr (!detail::has_fields<T>::value) {
+      if (body.get_uint() != 0) {
+	return -1;
+      }
+    }
+    detail::decode_value(body, v);
+    if (!body.ok || body.pos != body.size) {
+      return -1;
+    }
+    return (long)r.pos;
+  }
+}
+
+} // namespace gob
+
+///////////////////////////////////////////////////////////////////////////////
+// GOB_FIELDS
+
+#define GOB_PP_CAT_(a, b) a##b
+#define GOB_PP_CAT(a, b) GOB_PP_CAT_(a, b)
+#define GOB_PP_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+#define GOB_PP_NARGS(...) GOB_PP_NARGS_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)
+
+#define GOB_PP_EACH_1(m, T, a) m(T, a)
+#define GOB_PP_EACH_2(m, T, a, ...) m(T, a), GOB_PP_EACH_1(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_3(m, T, a, ...) m(T, a), GOB_PP_EACH_2(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_4(m, T, a, ...) m(T, a), GOB_PP_EACH_3(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_5(m, T, a, ...) m(T, a), GOB_PP_EACH_4(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_6(m, T, a, ...) m(T, a), GOB_PP_EACH_5(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_7(m, T, a, ...) m(T, a), GOB_PP_EACH_6(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_8(m, T, a, ...) m(T, a), GOB_PP_EACH_7(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_9(m, T, a, ...) m(T, a), GOB_PP_EACH_8(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_10(m, T, a, ...) m(T, a), GOB_PP_EACH_9(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_11(m, T, a, ...) m(T, a), GOB_PP_EACH_10(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_12(m, T, a, ...) m(T, a), GOB_PP_EACH_11(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_13(m, T, a, ...) m(T, a), GOB_PP_EACH_12(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_14(m, T, a, ...) m(T, a), GOB_PP_EACH_13(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_15(m, T, a, ...) m(T, a), GOB_PP_EACH_14(m, T, __VA_ARGS__)
+#define GOB_PP_EACH_16(m, T, a, ...) m(T, a), GOB_PP_EACH_15(m, T, __VA_ARGS__)
+#define GOB_PP_EACH(m, T, ...) GOB_PP_CAT(GOB_PP_EACH_, GOB_PP_NARGS(__VA_ARGS__))(m, T, __VA_ARGS__)
+
+#define GOB_PP_MEMBER(T, f) &T::f
+#define GOB_PP_NAME(T, f) #f
+
+/**
+ * Declares the fields of struct T (up to 16), in gob field order.  Must be
+ * used at global scope.  GOB_PACKAGE_FIELDS() also gives the Go package
+ * prefix (e.g. "main."), which appears in the names of slice types such as
+ * "[]main.FieldData".
+ */
+#define GOB_PACKAGE_FIELDS(pkg, T, ...)					\
+  template <> struct gob::fields<T> {					\
+    static constexpr const char *name = #T;				\
+    static constexpr const char *qualified_name = pkg #T;		\
+    static constexpr auto members = std::make_tuple(GOB_PP_EACH(GOB_PP_MEMBER, T, __VA_ARGS__)); \
+    static constexpr const char *names[] = { GOB_PP_EACH(GOB_PP_NAME, T, __VA_ARGS__) }; \
+  };
+
+#define GOB_FIELDS(T, ...) GOB_PACKAGE_FIELDS("", T, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,138 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.hpp"
+#include "gob_hpp_test.h"
+extern "C" {
+#include "encode_test.h"
+}
+#include <stdio.h>
+
+struct FieldData {
+  double fFloat;
+  int iInt;
+};
+
+struct MyData {
+  std::string MyName;
+  std::vector<FieldData> Fields;
+};
+
+GOB_PACKAGE_FIELDS("main.", FieldData, fFloat, iInt)
+GOB_PACKAGE_FIELDS("main.", MyData, MyName, Fields)
+
+struct Everything {
+  bool b;
+  long long i;
+  unsigned int u;
+  float f;
+  std::string s;
+  std::vector<unsigned char> bytes;
+  std::vector<std::string> strings;
+  FieldData nested;
+};
+
+GOB_FIELDS(Everything, b, i, u, f, s, bytes, strings, nested)
+
+void test_gob_hpp_encode_more_complex_type() {
+  using S = gob::schema<MyData>;
+  // the same stream as encoded with the C API
+  char expected[1024];
+  int expected_len = encode_more_complex_type(expected);
+
+  CU_ASSERT_EQUAL(65, S::id<MyData>());
+  CU_ASSERT_EQUAL(66, S::id<FieldData>());
+  CU_ASSERT_EQUAL(67, S::id<std::vector<FieldData>>());
+
+  MyData value;
+  value.MyName = "sym";
+  value.Fields.push_back(FieldData{10.1, 1000});
+
+  std::vector<std::byte> out;
+  gob::growable_buffer buf(out);
+  gob::encode_type_definitions<S>(buf);
+  gob::encode_message<S>(buf, value);
+
+  CU_ASSERT_EQUAL(146, expected_len);
+  CU_ASSERT_FATAL((size_t)expected_len == out.size());
+  CU_ASSERT(memcmp(expected, out.data(), expected_len) == 0);
+
+  // fixed buffer, too small
+  std::byte small[100];
+  gob::buffer fixed(small, sizeof(small));
+  gob::encode_type_definitions<S>(fixed);
+  gob::encode_message<S>(fixed, value);
+  CU_ASSERT_EQUAL(146, fixed.len);
+  CU_ASSERT(memcmp(expected, small, sizeof(small)) == 0);
+
+  MyData decoded;
+  CU_ASSERT_EQUAL(146, (gob::decode_message<S>(out.data(), out.size(), decoded)));
+  CU_ASSERT(decoded.MyName == "sym");
+  CU_ASSERT_EQUAL(1, decoded.Fields.size());
+  CU_ASSERT_EQUAL(10.1, decoded.Fields[0].fFloat);
+  CU_ASSERT_EQUAL(1000, decoded.Fields[0].iInt);
+
+  // truncated
+  CU_ASSERT_EQUAL(0, (gob::decode_message<S>(out.data(), out.size()-1, decoded)));
+}
+
+void test_gob_hpp_round_trip() {
+  using S = gob::schema<Everything>;
+  Everything value{};
+  value.b = true;
+  value.i = -1234567890123LL;
+  value.u = 0;  // omitted
+  value.f = 0.5f;
+  value.s = "hello";
+  value.bytes = {1, 2, 3};
+  value.strings = {"a", "", "c"};
+  value.nested.iInt = -7;
+
+  std::vector<std::byte> out;
+  gob::growable_buffer buf(out);
+  gob::encode_type_definitions<S>(buf);
+  size_t definitions_len = out.size();
+  gob::encode_message<S>(buf, value);
+  CU_ASSERT(out.size() > definitions_len);
+
+  Everything decoded{};
+  decoded.u = 42;
+  long consumed = gob::decode_message<S>(out.data(), out.size(), decoded);
+  CU_ASSERT_EQUAL((long)out.size(), consumed);
+  CU_ASSERT(decoded.b);
+  CU_ASSERT_EQUAL(value.i, decoded.i);
+  CU_ASSERT_EQUAL(42, decoded.u);
+  CU_ASSERT_EQUAL(0.5f, decoded.f);
+  CU_ASSERT(decoded.s == "hello");
+  CU_ASSERT(decoded.bytes == value.bytes);
+  CU_ASSERT(decoded.strings == value.strings);
+  CU_ASSERT_EQUAL(0.0, decoded.nested.fFloat);
+  CU_ASSERT_EQUAL(-7, decoded.nested.iInt);
+
+  // a value of another type is rejected
+  MyData other;
+  CU_ASSERT_EQUAL(-1, (gob::decode_message<gob::schema<MyData>>(out.data(), out.size(), other)));
+}
+
+void test_gob_hpp_type_definitions() {
+  using S = gob::schema<MyData>;
+  char expected[1024];
+
+  encode_more_complex_type(expected);
+
+  // everything but the value message, known at compile time
+  static_assert(gob::type_definitions<S>::size == 120, "definitions of MyData");
+  static_assert(gob::type_definitions<S>::bytes.data[0] == 0x2b, "length of the MyData definition");
+  CU_ASSERT(memcmp(expected, gob::type_definitions<S>::data(), 120) == 0);
+
+  // the same as encoding them at run time
+  char buf[1024];
+  int total_bytes = 0;
+  int num_bytes = gob_start_type_definition(buf, sizeof(buf), 67, GOB_SLICETYPE_ID);
+  num_bytes += gob_encode_slice_type(buf+num_bytes, sizeof(buf)-num_bytes, "[]main.FieldData", 67, 66);
+  num_bytes += gob_end_type_definition(buf+num_bytes, sizeof(buf)-num_bytes);
+  total_bytes = gob_end_message(buf, sizeof(buf), num_bytes);
+  CU_ASSERT_EQUAL(32, total_bytes);
+  CU_ASSERT(memcmp(buf, gob::type_definitions<S>::data() + 44, total_bytes) == 0);
+}
@@ -0,0 +1,16 @@
+#ifndef _GOB_HPP_TEST_H
+#define _GOB_HPP_TEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void test_gob_hpp_encode_more_complex_type();
+void test_gob_hpp_round_trip();
+void test_gob_hpp_type_definitions();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,599 @@
+/**
+ * gobbench - how does libgob scale with threads?
+ *
+ * Usage: gobbench [-t threads] [-d ms] [-n fields] [-l load]
+ *
+ * Encodes and decodes MyData messages, as in encode_test.c but with n
+ * FieldData elements (default 16, at most about 21000 so that the ring of
+ * shared mode holds two messages) and a Sent timestamp:
+ *
+ *   type FieldData struct { FFloat float64; IInt int }
+ *   type MyData struct { MyName string; Sent int; Fields []FieldData }
+ *
+ * with 1, 2, 4, ... up to the given number of threads (default: the number
+ * of CPUs, at most 16), in two modes:
+ *
+ *   independent  every thread encodes messages with type ids of its own and
+ *                decodes them again (MyName and Sent into a C struct,
+ *                walking Fields), sharing nothing but the library
+ *   shared       the threads encode into one gob_mpsc ring, a writer thread
+ *                sends the stream through a gob_writer over a socketpair, and
+ *                a reader thread decodes it
+ *
+ * Each combination runs twice for the given time (default 500 ms).  First
+ * closed-loop, every thread going as fast as it can, for the throughput.
+ * Then open-loop at the given fraction (default 0.5) of that throughput,
+ * every thread starting a message at fixed intervals, for the latency.
+ * Latencies are taken from the time a message was due to be started, not
+ * from when it was started, so a stall counts against every message that
+ * should have been sent during it (correcting for coordinated omission).  A
+ * message's latency ends when it is decoded: in the same thread in
+ * independent mode, in the reader thread in shared mode.
+ *
+ * The results are written to standard output as JSON; scaling is the
+ * throughput relative to threads times the single-thread throughput of the
+ * mode, so contention on shared state shows as scaling well below 1.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "gob.h"
+#include "encode.h"
+#include "builder.h"
+#include "mpsc.h"
+#include "writer.h"
+#include "plan.h"
+#include "cpu.h"
+
+#define MAX_THREADS (16)
+#define RING_SIZE (1 << 20)
+#define READ_SIZE (1 << 20)
+
+// Latencies in ns, in buckets of 32 per power of two (within 3%).
+#define HIST_SUB (32)
+#define HIST_BUCKETS (60 * HIST_SUB)
+
+struct histogram {
+  unsigned long long counts[HIST_BUCKETS];
+  unsigned long long total;
+  unsigned long long max;
+};
+
+struct types {
+  int field_id;             // FieldData
+  int slice_id;             // []FieldData
+  int data_id;              // MyData
+  char defs[512];           // the three definitions, framed
+  size_t def_len[3];        // of FieldData, []FieldData, MyData
+};
+
+struct mydata {
+  struct gob_string name;
+  long long sent;
+};
+
+static const struct gob_local_field sMyDataFields[] = {
+  { "MyName", GOB_LOCAL_STRING, offsetof(struct mydata, name) },
+  { "Sent", GOB_LOCAL_INT, offsetof(struct mydata, sent) },
+};
+static const struct gob_local_struct sMyData = { sMyDataFields, 2 };
+
+struct run;
+
+struct worker {
+  struct run *run;
+  int index;
+  pthread_t thread;
+  unsigned long long ops;
+  struct histogram hist;
+};
+
+struct run {
+  int shared;
+  int threads;
+  int fields;
+  double rate;              // messages per second per thread, 0 for closed-loop
+  unsigned long long start; // ns
+  unsigned long long end;
+  int stop;
+  int drain;                // producers are done, for the writer
+  pthread_barrier_t barrier;
+  struct types types;       // of shared mode
+  struct gob_mpsc *ring;
+  int sv[2];
+  size_t max_len;
+  struct worker workers[MAX_THREADS];
+  // reader of shared mode
+  unsigned long long received; // before end
+  struct histogram hist;
+};
+
+static unsigned long long now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void wait_until(unsigned long long t) {
+  unsigned long long now;
+  unsigned long long d;
+  struct timespec ts;
+
+  while ((now = now_ns()) < t) {
+    // sleep through long waits, spin through short ones
+    if (t - now > 200000) {
+      d = t - now - 100000;
+      ts.tv_sec = d / 1000000000;
+      ts.tv_nsec = d % 1000000000;
+      nanosleep(&ts, NULL);
+    }
+  }
+}
+
+static void fail(const char *what) {
+  perror(what);
+  exit(1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Histograms
+
+static int hist_index(unsigned long long v) {
+  int e;
+  if (v < HIST_SUB) {
+    return (int)v;
+  }
+  e = 63 - __builtin_clzll(v);
+  return (e - 4) * HIST_SUB + (int)((v >> (e - 5)) & (HIST_SUB - 1));
+}
+
+// The middle of a bucket.
+static unsigned long long hist_value(int i) {
+  int e;
+  if (i < HIST_SUB) {
+    return i;
+  }
+  e = i / HIST_SUB + 4;
+  return ((HIST_SUB + (unsigned long long)(i % HIST_SUB)) << (e - 5)) + ((1ULL << (e - 5)) >> 1);
+}
+
+static void hist_record(struct histogram *h, unsigned long long v) {
+  h->counts[hist_index(v)]++;
+  h->total++;
+  if (v > h->max) {
+    h->max = v;
+  }
+}
+
+static void hist_add(struct histogram *h, const struct histogram *other) {
+  int i;
+  for (i = 0; i < HIST_BUCKETS; i++) {
+    h->counts[i] += other->counts[i];
+  }
+  h->total += other->total;
+  if (other->max > h->max) {
+    h->max = other->max;
+  }
+}
+
+static unsigned long long hist_percentile(const struct histogram *h, double p) {
+  unsigned long long rank = (unsigned long long)(p * h->total);
+  unsigned long long seen = 0;
+  int i;
+
+  for (i = 0; i < HIST_BUCKETS; i++) {
+    seen += h->counts[i];
+    if (seen > rank) {
+      return hist_value(i) < h->max ? hist_value(i) : h->max;
+    }
+  }
+  return h->max;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Messages
+
+static void encode_types(struct types *t) {
+  char *buf = t->defs;
+  size_t size = sizeof(t->defs);
+  size_t pos = 0;
+  int len;
+
+  t->field_id = gob_allocate_type_id();
+  t->slice_id = gob_allocate_type_id();
+  t->data_id = gob_allocate_type_id();
+
+  len = gob_start_type_definition(buf, size, t->field_id, GOB_STRUCTTYPE_ID);
+  len += gob_start_struct_type(buf+len, size-len, "FieldData", t->field_id);
+  len += gob_encode_unsigned_int(buf+len, size-len, 1);
+  len += gob_start_slice(buf+len, size-len, 2);
+  len += gob_encode_field_type(buf+len, size-len, "FFloat", GOB_FLOAT_ID);
+  len += gob_encode_field_type(buf+len, size-len, "IInt", GOB_INT_ID);
+  len += gob_end_slice(buf+len, size-len);
+  len += gob_end_struct_type(buf+len, size-len);
+  len += gob_end_type_definition(buf+len, size-len);
+  t->def_len[0] = gob_end_message(buf, size, len);
+  pos += t->def_len[0];
+
+  len = gob_start_type_definition(buf+pos, size-pos, t->slice_id, GOB_SLICETYPE_ID);
+  len += gob_encode_slice_type(buf+pos+len, size-pos-len, "[]FieldData", t->slice_id, t->field_id);
+  len += gob_end_type_definition(buf+pos+len, size-pos-len);
+  t->def_len[1] = gob_end_message(buf+pos, size-pos, len);
+  pos += t->def_len[1];
+
+  len = gob_start_type_definition(buf+pos, size-pos, t->data_id, GOB_STRUCTTYPE_ID);
+  len += gob_start_struct_type(buf+pos+len, size-pos-len, "MyData", t->data_id);
+  len += gob_encode_unsigned_int(buf+pos+len, size-pos-len, 1);
+  len += gob_start_slice(buf+pos+len, size-pos-len, 3);
+  len += gob_encode_field_type(buf+pos+len, size-pos-len, "MyName", GOB_STRING_ID);
+  len += gob_encode_field_type(buf+pos+len, size-pos-len, "Sent", GOB_INT_ID);
+  len += gob_encode_field_type(buf+pos+len, size-pos-len, "Fields", t->slice_id);
+  len += gob_end_slice(buf+pos+len, size-pos-len);
+  len += gob_end_struct_type(buf+pos+len, size-pos-len);
+  len += gob_end_type_definition(buf+pos+len, size-pos-len);
+  t->def_len[2] = gob_end_message(buf+pos, size-pos, len);
+  if (pos + t->def_len[2] > size) {
+    fprintf(stderr, "gobbench: definitions too large\n");
+    exit(1);
+  }
+}
+
+static int encode_mydata(char *buf, size_t buf_size, const struct types *t, int fields,
+			 unsigned long long seq, unsigned long long sent) {
+  struct gob_builder b;
+  int i;
+
+  gob_builder_init(&b, buf, buf_size);
+  gob_builder_start_message(&b, t->data_id);
+  gob_builder_string(&b, 0, "instrument.quotes.level1");
+  gob_builder_int(&b, 1, (long long)sent);
+  gob_builder_start_slice(&b, 2);
+  for (i = 0; i < fields; i++) {
+    gob_builder_start_struct(&b, 0);
+    gob_builder_double(&b, 0, 100.25 + (double)((seq + i) % 1000) / 8);
+    gob_builder_int(&b, 1, (long long)(seq * 31 + i));
+    gob_builder_end_struct(&b);
+  }
+  gob_builder_end_slice(&b);
+  return gob_builder_end_message(&b);
+}
+
+// The longest message: every varint at its longest.
+static size_t max_mydata_len(int fields) {
+  return 64 + (size_t)fields * 24;
+}
+
+// Feeds the definitions to a decoder.
+static void define(struct gob_decoder *dec, const struct types *t) {
+  size_t len = t->def_len[0] + t->def_len[1] + t->def_len[2];
+  struct mydata out;
+  long used;
+  int id;
+
+  used = gob_decoder_next(dec, t->defs, len, &sMyData, &out, &id);
+  if (used != (long)len || id != 0) {
+    fprintf(stderr, "gobbench: bad definitions\n");
+    exit(1);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Workers
+
+// Returns when the next message is due, waiting for it in open-loop runs.
+static unsigned long long next_due(const struct run *run, unsigned long long ops) {
+  unsigned long long due;
+  if (run->rate == 0) {
+    return now_ns();
+  }
+  due = run->start + (unsigned long long)((ops + 1) * 1e9 / run->rate);
+  wait_until(due);
+  return due;
+}
+
+static void *independent_worker(void *arg) {
+  struct worker *w = arg;
+  struct run *run = w->run;
+  struct gob_decoder dec;
+  struct types types;
+  struct mydata out;
+  size_t size = max_mydata_len(run->fields);
+  char *buf = malloc(size);
+  unsigned long long due;
+  int len;
+  int id;
+
+  if (buf == NULL || gob_decoder_init(&dec) < 0) {
+    fail("gobbench");
+  }
+  encode_types(&types);
+  define(&dec, &types);
+  pthread_barrier_wait(&run->barrier);
+  wait_until(run->start);
+  while (!__atomic_load_n(&run->stop, __ATOMIC_RELAXED)) {
+    due = next_due(run, w->ops);
+    len = encode_mydata(buf, size, &types, run->fields, w->ops, due);
+    if (len < 0 || len > (int)size ||
+	gob_decoder_next(&dec, buf, len, &sMyData, &out, &id) != len || out.sent != (long long)due) {
+      fprintf(stderr, "gobbench: message did not round-trip\n");
+      exit(1);
+    }
+    hist_record(&w->hist, now_ns() - due);
+    w->ops++;
+  }
+  gob_decoder_destroy(&dec);
+  free(buf);
+  return NULL;
+}
+
+static void *shared_worker(void *arg) {
+  struct worker *w = arg;
+  struct run *run = w->run;
+  unsigned long long due;
+  char *space;
+  int len;
+
+  pthread_barrier_wait(&run->barrier);
+  wait_until(run->start);
+  while (!__atomic_load_n(&run->stop, __ATOMIC_RELAXED)) {
+    due = next_due(run, w->ops);
+    while ((space = gob_mpsc_reserve(run->ring, run->max_len)) == NULL) {
+      if (__atomic_load_n(&run->stop, __ATOMIC_RELAXED)) {
+	return NULL;
+      }
+      sched_yield();
+    }
+    len = encode_mydata(space, run->max_len, &run->types, run->fields, w->ops, due);
+    gob_mpsc_commit(run->ring, space, len <= (int)run->max_len ? len : 0, run->types.data_id);
+    w->ops++;
+  }
+  return NULL;
+}
+
+static int write_message(void *ctx, const char *msg, size_t len) {
+  return gob_writer_write(ctx, msg, len);
+}
+
+static void *shared_writer(void *arg) {
+  struct run *run = arg;
+  struct gob_writer writer;
+  int drain;
+
+  if (gob_writer_init(&writer, run->sv[0], 64 * 1024, NULL) < 0) {
+    fail("gobbench");
+  }
+  for (;;) {
+    drain = __atomic_load_n(&run->drain, __ATOMIC_ACQUIRE);
+    if (gob_mpsc_consume(run->ring, write_message, &writer, 256) == 0) {
+      if (gob_writer_flush(&writer) < 0) {
+	fail("gobbench: write");
+      }
+      if (drain) {
+	break;
+      }
+      sched_yield();
+    }
+  }
+  gob_writer_destroy(&writer);
+  shutdown(run->sv[0], SHUT_WR);
+  return NULL;
+}
+
+static void *shared_reader(void *arg) {
+  struct run *run = arg;
+  struct gob_decoder dec;
+  struct mydata out;
+  size_t size = READ_SIZE;
+  char *buf = malloc(size);
+  unsigned long long now;
+  size_t len = 0;
+  size_t pos;
+  ssize_t n;
+  long used;
+  int id;
+
+  if (buf == NULL || gob_decoder_init(&dec) < 0) {
+    fail("gobbench");
+  }
+  while ((n = read(run->sv[1], buf + len, size - len)) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      fail("gobbench: read");
+    }
+    len += n;
+    pos = 0;
+    while ((used = gob_decoder_next(&dec, buf + pos, len - pos, &sMyData, &out, &id)) > 0) {
+      pos += used;
+      if (id != 0) {
+	now = now_ns();
+	hist_record(&run->hist, now - out.sent);
+	run->received += now <= run->end;
+      }
+    }
+    if (used < 0) {
+      fprintf(stderr, "gobbench: bad stream\n");
+      exit(1);
+    }
+    memmove(buf, buf + pos, len - pos);
+    len -= pos;
+    if (len == size) {
+      // a message larger than the buffer, a read of 0 bytes would end it
+      size *= 2;
+      buf = realloc(buf, size);
+      if (buf == NULL) {
+	fail("gobbench");
+      }
+    }
+  }
+  gob_decoder_destroy(&dec);
+  free(buf);
+  return NULL;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Runs
+
+// Runs one combination; returns the throughput in messages per second and
+// the latencies.
+static double run_once(int shared, int threads, int fields, double rate, int ms, struct histogram *hist) {
+  struct run *run = calloc(1, sizeof(struct run));
+  pthread_t writer;
+  pthread_t reader;
+  unsigned long long ops = 0;
+  double throughput;
+  int deps;
+  int i;
+
+  if (run == NULL) {
+    fail("gobbench");
+  }
+  run->shared = shared;
+  run->threads = threads;
+  run->fields = fields;
+  run->rate = rate;
+  if (pthread_barrier_init(&run->barrier, NULL, threads + 1) != 0) {
+    fail("gobbench");
+  }
+  if (shared) {
+    run->ring = malloc(sizeof(struct gob_mpsc));
+    if (run->ring == NULL || gob_mpsc_init(run->ring, RING_SIZE) < 0 ||
+	socketpair(AF_UNIX, SOCK_STREAM, 0, run->sv) < 0) {
+      fail("gobbench");
+    }
+    encode_types(&run->types);
+    run->max_len = max_mydata_len(fields);
+    gob_mpsc_define(run->ring, run->types.field_id, run->types.defs, run->types.def_len[0], NULL, 0);
+    deps = run->types.field_id;
+    gob_mpsc_define(run->ring, run->types.slice_id, run->types.defs + run->types.def_len[0],
+		    run->types.def_len[1], &deps, 1);
+    deps = run->types.slice_id;
+    gob_mpsc_define(run->ring, run->types.data_id,
+		    run->types.defs + run->types.def_len[0] + run->types.def_len[1],
+		    run->types.def_len[2], &deps, 1);
+    if (pthread_create(&writer, NULL, shared_writer, run) != 0 ||
+	pthread_create(&reader, NULL, shared_reader, run) != 0) {
+      fail("gobbench");
+    }
+  }
+  for (i = 0; i < threads; i++) {
+    run->workers[i].run = run;
+    run->workers[i].index = i;
+    if (pthread_create(&run->workers[i].thread, NULL, shared ? shared_worker : independent_worker,
+		       &run->workers[i]) != 0) {
+      fail("gobbench");
+    }
+  }
+  // give the threads a moment to get to the start line
+  run->start = now_ns() + 10000000ULL;
+  run->end = run->start + ms * 1000000ULL;
+  pthread_barrier_wait(&run->barrier);
+  wait_until(run->end);
+  __atomic_store_n(&run->stop, 1, __ATOMIC_RELAXED);
+
+  memset(hist, 0, sizeof(struct histogram));
+  for (i = 0; i < threads; i++) {
+    pthread_join(run->workers[i].thread, NULL);
+    ops += run->workers[i].ops;
+    hist_add(hist, &run->workers[i].hist);
+  }
+  if (shared) {
+    __atomic_store_n(&run->drain, 1, __ATOMIC_RELEASE);
+    pthread_join(writer, NULL);
+    pthread_join(reader, NULL);
+    close(run->sv[0]);
+    close(run->sv[1]);
+    gob_mpsc_destroy(run->ring);
+    free(run->ring);
+    // what made it through the stream in time
+    ops = run->received;
+    memcpy(hist, &run->hist, sizeof(struct histogram));
+  }
+  throughput = ops * 1e3 / ms;
+  pthread_barrier_destroy(&run->barrier);
+  free(run);
+  return throughput;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: gobbench [-t threads] [-d ms] [-n fields] [-l load]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  static const char *modes[] = { "independent", "shared" };
+  struct histogram *hist = malloc(sizeof(struct histogram));
+  double single[2] = { 0, 0 };
+  double throughput;
+  double load = 0.5;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_threads = cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (int)cpus;
+  int fields = 16;
+  int ms = 500;
+  int first = 1;
+  int threads;
+  int shared;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "t:d:n:l:")) != -1) {
+    switch (opt) {
+    case 't':
+      max_threads = atoi(optarg);
+      break;
+    case 'd':
+      ms = atoi(optarg);
+      break;
+    case 'n':
+      fields = atoi(optarg);
+      break;
+    case 'l':
+      load = atof(optarg);
+      break;
+    default:
+      usage();
+    }
+  }
+  // shared runs need room in the ring for two messages at least
+  if (optind != argc || max_threads < 1 || max_threads > MAX_THREADS || ms < 1 || fields < 0 ||
+      max_mydata_len(fields) > RING_SIZE / 2 || load <= 0 || load > 1 || hist == NULL) {
+    usage();
+  }
+
+  printf("{\n  \"cpu\": \"%s\",\n  \"fields\": %d,\n  \"duration_ms\": %d,\n  \"load\": %g,\n  \"runs\": [",
+	 gob_cpu_name(gob_cpu_features()), fields, ms, load);
+  for (shared = 0; shared < 2; shared++) {
+    for (threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+      throughput = run_once(shared, threads, fields, 0, ms, hist);
+      if (threads == 1) {
+	single[shared] = throughput;
+      }
+      printf("%s\n    { \"mode\": \"%s\", \"threads\": %d, \"throughput\": %.0f, \"scaling\": %.3f, ",
+	     first ? "" : ",", modes[shared], threads, throughput,
+	     single[shared] > 0 ? throughput / (threads * single[shared]) : 0);
+      first = 0;
+      // latency at a sustainable load
+      throughput = run_once(shared, threads, fields, load * throughput / threads, ms, hist);
+      printf("\"latency_throughput\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, "
+	     "\"max_ns\": %llu }",
+	     throughput, hist_percentile(hist, 0.5), hist_percentile(hist, 0.99),
+	     hist_percentile(hist, 0.999), hist->max);
+      fflush(stdout);
+      if (threads == max_threads) {
+	break;
+      }
+    }
+  }
+  printf("\n  ]\n}\n");
+  free(hist);
+  return 0;
+}
@@ -0,0 +1,298 @@
+/**
+ * gobstat - where do the bytes of a gob stream go?
+ *
+ * Usage: gobstat [file]
+ *
+ * Reads a gob stream from the file (memory mapped) or from standard input and
+ * reports, for every type, the messages and bytes sent and for every struct
+ * field the number of values, their bytes including the field delta and the
+ * width of integer, float and bool varints.  Types are listed by bytes, the
+ * largest first, together with their definitions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gob.h"
+#include "decode.h"
+
+#define READ_SIZE (1 << 20)
+#define WIDTHS (10)
+
+struct field_stats {
+  unsigned long long values;
+  unsigned long long bytes;
+  unsigned long long widths[WIDTHS];
+};
+
+struct type_stats {
+  unsigned long long messages;
+  unsigned long long bytes;        // of its messages
+  unsigned long long field_bytes;  // of its fields, wherever it occurs
+  int nfields;
+  struct field_stats *fields;
+};
+
+struct gobstat {
+  struct gob_types types;
+  struct type_stats *stats;        // by type id
+  int size;
+  unsigned long long messages;
+  unsigned long long bytes;
+  unsigned long long definitions;
+  unsigned long long definition_bytes;
+  unsigned long long offset;       // of the next message in the stream
+};
+
+static struct type_stats *type_stats(struct gobstat *s, int id) {
+  const struct gob_type *t = gob_types_lookup(&s->types, id);
+  struct type_stats *grown;
+  struct type_stats *ts;
+  int size;
+
+  if (id >= s->size) {
+    size = s->size * 2 > id ? s->size * 2 : id + 1;
+    grown = realloc(s->stats, size * sizeof(struct type_stats));
+    if (grown == NULL) {
+      perror("gobstat");
+      exit(1);
+    }
+    memset(grown + s->size, 0, (size - s->size) * sizeof(struct type_stats));
+    s->stats = grown;
+    s->size = size;
+  }
+  ts = &s->stats[id];
+  if (t != NULL && ts->nfields < t->nfields) {
+    ts->fields = realloc(ts->fields, t->nfields * sizeof(struct field_stats));
+    if (ts->fields == NULL) {
+      perror("gobstat");
+      exit(1);
+    }
+    memset(ts->fields + ts->nfields, 0, (t->nfields - ts->nfields) * sizeof(struct field_stats));
+    ts->nfields = t->nfields;
+  }
+  return ts;
+}
+
+static void count_field(void *ctx, int struct_id, int field, const char *value, size_t len, size_t delta_len) {
+  struct gobstat *s = ctx;
+  struct type_stats *ts = type_stats(s, struct_id);
+  struct field_stats *fs = &ts->fields[field];
+  const struct gob_type *t = gob_types_lookup(&s->types, s->types.types[struct_id].fields[field].id);
+
+  (void)value;
+  fs->values++;
+  fs->bytes += len + delta_len;
+  if (t->kind <= GOB_KIND_FLOAT && len < WIDTHS) {
+    fs->widths[len]++;
+  }
+  ts->field_bytes += len + delta_len;
+}
+
+// Processes all complete messages in buf, returns the number of bytes used.
+static size_t scan(struct gobstat *s, const char *buf, size_t buf_size) {
+  struct type_stats *ts;
+  const char *body;
+  size_t body_len;
+  size_t pos = 0;
+  int id;
+  int len;
+
+  while ((len = gob_decode_message(buf + pos, buf_size - pos, &id, &body, &body_len)) > 0) {
+    s->messages++;
+    s->bytes += len;
+    if (id < 0) {
+      s->definitions++;
+      s->definition_bytes += len;
+      if (gob_types_define(&s->types, -id, body, body_len) != (int)body_len) {
+	fprintf(stderr, "gobstat: bad definition of type %d at offset %llu\n", -id, s->offset);
+	exit(1);
+      }
+    } else {
+      if (gob_walk_value(&s->types, id, body, body_len, count_field, s) != (int)body_len) {
+	fprintf(stderr, "gobstat: bad value of type %d at offset %llu\n", id, s->offset);
+	exit(1);
+      }
+      ts = type_stats(s, id);
+      ts->messages++;
+      ts->bytes += len;
+    }
+    pos += len;
+    s->offset += len;
+  }
+  if (len < 0) {
+    fprintf(stderr, "gobstat: bad message at offset %llu\n", s->offset);
+    exit(1);
+  }
+  return pos;
+}
+
+static void scan_fd(struct gobstat *s, int fd) {
+  struct stat st;
+  size_t size = READ_SIZE;
+  size_t len = 0;
+  size_t used;
+  ssize_t n;
+  char *buf;
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (buf != MAP_FAILED) {
+      madvise(buf, st.st_size, MADV_SEQUENTIAL);
+      used = scan(s, buf, st.st_size);
+      munmap(buf, st.st_size);
+      if (used != (size_t)st.st_size) {
+	fprintf(stderr, "gobstat: truncated message at offset %llu\n", s->offset);
+	exit(1);
+      }
+      return;
+    }
+  }
+
+  buf = malloc(size);
+  if (buf == NULL) {
+    perror("gobstat");
+    exit(1);
+  }
+  for (;;) {
+    if (len == size) {
+      // a message larger than the buffer
+      size *= 2;
+      buf = realloc(buf, size);
+      if (buf == NULL) {
+	perror("gobstat");
+	exit(1);
+      }
+    }
+    n = read(fd, buf + len, size - len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      perror("gobstat");
+      exit(1);
+    }
+    if (n == 0) {
+      break;
+    }
+    len += n;
+    used = scan(s, buf, len);
+    memmove(buf, buf + used, len - used);
+    len -= used;
+  }
+  free(buf);
+  if (len != 0) {
+    fprintf(stderr, "gobstat: truncated message at offset %llu\n", s->offset);
+    exit(1);
+  }
+}
+
+static struct gobstat *sort_stats;
+
+// Message types by message bytes, then nested types by field bytes.
+static unsigned long long sort_key(int id) {
+  const struct type_stats *ts = &sort_stats->stats[id];
+  return ts->messages != 0 ? ts->bytes : ts->field_bytes;
+}
+
+static int by_bytes(const void *a, const void *b) {
+  unsigned long long x = sort_key(*(const int*)a);
+  unsigned long long y = sort_key(*(const int*)b);
+  int nested_x = sort_stats->stats[*(const int*)a].messages == 0;
+  int nested_y = sort_stats->stats[*(const int*)b].messages == 0;
+  if (nested_x != nested_y) {
+    return nested_x - nested_y;
+  }
+  return x < y ? 1 : x > y ? -1 : *(const int*)a - *(const int*)b;
+}
+
+static void report(struct gobstat *s) {
+  const struct gob_type *t;
+  struct type_stats *ts;
+  struct field_stats *fs;
+  char def[4096];
+  int *order;
+  int n = 0;
+  int i;
+  int j;
+  int k;
+
+  printf("messages:         %llu\n"
+	 "bytes:            %llu\n"
+	 "type definitions: %llu (%llu bytes)\n",
+	 s->messages, s->bytes, s->definitions, s->definition_bytes);
+
+  order = malloc((s->size ? s->size : 1) * sizeof(int));
+  if (order == NULL) {
+    perror("gobstat");
+    exit(1);
+  }
+  for (i = 0; i < s->size; i++) {
+    if (s->stats[i].messages != 0 || s->stats[i].field_bytes != 0) {
+      order[n++] = i;
+    }
+  }
+  sort_stats = s;
+  qsort(order, n, sizeof(int), by_bytes);
+
+  for (i = 0; i < n; i++) {
+    ts = &s->stats[order[i]];
+    t = gob_types_lookup(&s->types, order[i]);
+    gob_types_format(&s->types, order[i], 1, def, sizeof(def));
+    if (ts->messages != 0) {
+      printf("\ntype %d %s: %llu messages, %llu bytes\n  %s\n", order[i],
+	     t->name != NULL ? t->name : "", ts->messages, ts->bytes, def);
+    } else {
+      printf("\ntype %d %s: nested, %llu bytes of fields\n  %s\n", order[i],
+	     t->name != NULL ? t->name : "", ts->field_bytes, def);
+    }
+    for (j = 0; j < ts->nfields && j < t->nfields; j++) {
+      fs = &ts->fields[j];
+      if (fs->values == 0) {
+	continue;
+      }
+      gob_types_format(&s->types, t->fields[j].id, 0, def, sizeof(def));
+      printf("  field %d %s %s: %llu values, %llu bytes", j, t->fields[j].name, def,
+	     fs->values, fs->bytes);
+      for (k = 1; k < WIDTHS; k++) {
+	if (fs->widths[k] != 0) {
+	  printf(", %d byte%s %llu", k, k == 1 ? "" : "s", fs->widths[k]);
+	}
+      }
+      printf("\n");
+    }
+  }
+  free(order);
+}
+
+int main(int argc, char **argv) {
+  struct gobstat s;
+  int fd = 0;
+
+  if (argc > 2 || (argc == 2 && argv[1][0] == '-' && argv[1][1] != '\0')) {
+    fprintf(stderr, "usage: gobstat [file]\n");
+    return 2;
+  }
+  if (argc == 2 && strcmp(argv[1], "-") != 0) {
+    fd = open(argv[1], O_RDONLY);
+    if (fd < 0) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+  memset(&s, 0, sizeof(s));
+  if (gob_types_init(&s.types) < 0) {
+    perror("gobstat");
+    return 1;
+  }
+  scan_fd(&s, fd);
+  report(&s);
+  gob_types_destroy(&s.types);
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "memo.h"
+#include "intern.h"
+
+// The size of the blocks strings are copied to; longer strings get a block
+// of their own.
+#define GOB_INTERN_BLOCK_SIZE (64 * 1024)
+
+// Every block starts with a pointer to the previous one.
+#define GOB_INTERN_LINK (sizeof(char*))
+
+int gob_intern_init(struct gob_intern *intern, size_t max_entries, size_t max_bytes) {
+  size_t nslots = 1;
+
+  memset(intern, 0, sizeof(struct gob_intern));
+  // at most half full, so misses end after a probe or two
+  while (nslots < 2 * max_entries) {
+    nslots *= 2;
+  }
+  intern->slots = calloc(nslots, sizeof(struct gob_intern_slot));
+  if (intern->slots == NULL) {
+    return -1;
+  }
+  intern->mask = nslots - 1;
+  intern->max_entries = max_entries;
+  intern->max_bytes = max_bytes;
+  return 0;
+}
+
+void gob_intern_destroy(struct gob_intern *intern) {
+  char *block = intern->block;
+  char *prev;
+
+  while (block != NULL) {
+    memcpy(&prev, block, sizeof(prev));
+    free(block);
+    block = prev;
+  }
+  free(intern->slots);
+  memset(intern, 0, sizeof(struct gob_intern));
+}
+
+// Copies a string into the current block, starting a new one if it is full.
+static char *gob_intern_copy(struct gob_intern *intern, const char *data, size_t len) {
+  size_t size = GOB_INTERN_BLOCK_SIZE;
+  char *block;
+  char *copy;
+
+  if (intern->block == NULL || intern->block_size - intern->block_used < len + 1) {
+    if (GOB_INTERN_LINK + len + 1 > size) {
+      size = GOB_INTERN_LINK + len + 1;
+    }
+    block = malloc(size);
+    if (block == NULL) {
+      return NULL;
+    }
+    memcpy(block, &intern->block, sizeof(intern->block));
+    intern->block = block;
+    intern->block_used = GOB_INTERN_LINK;
+    intern->block_size = size;
+  }
+  copy = intern->block + intern->block_used;
+  memcpy(copy, data, len);
+  copy[len] = '\0';
+  intern->block_used += len + 1;
+  return copy;
+}
+
+const char *gob_intern_get(struct gob_intern *intern, const char *data, size_t len) {
+  unsigned long long hash = gob_memo_hash(data, len);
+  struct gob_intern_slot *slot;
+  size_t i;
+
+  for (i = (size_t)(hash * 0x9e3779b97f4a7c15ULL >> 32) & intern->mask;
+       intern->slots[i].data != NULL; i = (i + 1) & intern->mask) {
+    slot = &intern->slots[i];
+    if (slot->hash == hash && slot->len == len && memcmp(slot->data, data, len) == 0) {
+      intern->hits++;
+      return slot->data;
+    }
+  }
+  if (intern->count == intern->max_entries || len + 1 > intern->max_bytes - intern->bytes) {
+    intern->refused++;
+    return NULL;
+  }
+  slot = &intern->slots[i];
+  slot->data = gob_intern_copy(intern, data, len);
+  if (slot->data == NULL) {
+    return NULL;
+  }
+  slot->hash = hash;
+  slot->len = len;
+  intern->count++;
+  intern->bytes += len + 1;
+  intern->misses++;
+  return slot->data;
+}
@@ -0,0 +1,81 @@
+#ifndef _INTERN_H
+#define _INTERN_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Interning of decoded strings.
+ *
+ * Streams repeat the same few strings, e.g. symbols or host names, over and
+ * over.  A gob_intern keeps one copy of each, so a decoded string can be
+ * kept as a pointer to that copy instead of being copied once per message:
+ *
+ * \code
+ * gob_intern_init(&intern, 4096, 1 << 20);
+ * dec.intern = &intern;   // and GOB_LOCAL_INTERN fields, see plan.h
+ * \endcode
+ *
+ * The copies are NUL-terminated and stay where they are until the table is
+ * destroyed; they are allocated in blocks, not one by one.  Lookups hash
+ * the bytes and probe an open-addressed table that never grows, so a hit
+ * costs a hash, usually one probe and a memcmp.  The table holds a bounded
+ * number of strings and bytes; once full, it keeps what it has and refuses
+ * new strings.  It is not synchronized.
+ */
+
+struct gob_intern_slot {
+  unsigned long long hash;
+  const char *data;         // NULL if free
+  size_t len;
+};
+
+struct gob_intern {
+  struct gob_intern_slot *slots;
+  size_t mask;
+  size_t count;
+  size_t max_entries;
+  size_t bytes;             // of all strings, terminators included
+  size_t max_bytes;
+  char *block;              // the block strings are copied to
+  size_t block_used;
+  size_t block_size;
+  unsigned long long hits;
+  unsigned long long misses; // strings added
+  unsigned long long refused; // strings not added since the table was full
+};
+
+/**
+ * Initializes a table.
+ *
+ * @param max_entries
+ *   The number of strings kept at most.
+ * @param max_bytes
+ *   The total size of the strings kept at most.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_intern_init(struct gob_intern *intern, size_t max_entries, size_t max_bytes);
+
+/**
+ * Frees the table and all strings in it.
+ */
+void gob_intern_destroy(struct gob_intern *intern);
+
+/**
+ * Returns the copy of a string, making one if it is not in the table yet.
+ *
+ * @return
+ *   The NUL-terminated copy, or NULL if the table is full or memory ran out.
+ */
+const char *gob_intern_get(struct gob_intern *intern, const char *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "builder.h"
+#include "intern.h"
+#include "plan.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+void test_gob_intern_table() {
+  struct gob_intern intern;
+  const char *copies[1000];
+  char long_string[100000];
+  char s[32];
+  const char *p;
+  int i;
+
+  CU_ASSERT_EQUAL(0, gob_intern_init(&intern, 1000, 1 << 20));
+  for (i = 0; i < 1000; i++) {
+    snprintf(s, sizeof(s), "host-%d.example.com", i);
+    copies[i] = gob_intern_get(&intern, s, strlen(s));
+    CU_ASSERT_PTR_NOT_NULL(copies[i]);
+    CU_ASSERT(copies[i] != s);
+    CU_ASSERT_STRING_EQUAL(s, copies[i]);
+  }
+  // the copies stay where they are, and the same strings find them
+  for (i = 0; i < 1000; i++) {
+    snprintf(s, sizeof(s), "host-%d.example.com", i);
+    CU_ASSERT_PTR_EQUAL(copies[i], gob_intern_get(&intern, s, strlen(s)));
+  }
+  CU_ASSERT_EQUAL(1000, intern.misses);
+  CU_ASSERT_EQUAL(1000, intern.hits);
+  CU_ASSERT_EQUAL(1000, intern.count);
+
+  // the table is full: known strings are found, others refused
+  CU_ASSERT_PTR_NULL(gob_intern_get(&intern, "new", 3));
+  CU_ASSERT_EQUAL(1, intern.refused);
+  CU_ASSERT_PTR_EQUAL(copies[7], gob_intern_get(&intern, "host-7.example.com", 18));
+  // bytes, not NUL-terminated strings, are interned
+  CU_ASSERT_PTR_EQUAL(copies[1], gob_intern_get(&intern, "host-1.example.com-", 18));
+  gob_intern_destroy(&intern);
+
+  // bounded by bytes; a string larger than a block gets its own
+  CU_ASSERT_EQUAL(0, gob_intern_init(&intern, 100, sizeof(long_string) + 10));
+  memset(long_string, 'x', sizeof(long_string));
+  p = gob_intern_get(&intern, "a", 1);
+  CU_ASSERT_PTR_NOT_NULL(gob_intern_get(&intern, long_string, sizeof(long_string)));
+  CU_ASSERT_PTR_NOT_NULL(gob_intern_get(&intern, "b", 1));
+  CU_ASSERT_PTR_NULL(gob_intern_get(&intern, "0123456789", 10));
+  CU_ASSERT_PTR_EQUAL(p, gob_intern_get(&intern, "a", 1));
+  CU_ASSERT_EQUAL(sizeof(long_string) + 5, intern.bytes);
+  gob_intern_destroy(&intern);
+
+  // an empty table refuses everything
+  CU_ASSERT_EQUAL(0, gob_intern_init(&intern, 0, 0));
+  CU_ASSERT_PTR_NULL(gob_intern_get(&intern, "", 0));
+  gob_intern_destroy(&intern);
+}
+
+// type Point struct { Host string; Value float64 }
+static int encode_point_type(char *buf, size_t buf_size, int id) {
+  int total_bytes = 0;
+  total_bytes += gob_start_type_definition(buf, buf_size, id, GOB_STRUCTTYPE_ID);
+  total_bytes += gob_start_struct_type(buf+total_bytes, buf_size-total_bytes, "Point", id);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_start_slice(buf+total_bytes, buf_size-total_bytes, 2);
+  total_bytes += gob_encode_field_type(buf+total_bytes, buf_size-total_bytes, "Host", GOB_STRING_ID);
+  total_bytes += gob_encode_field_type(buf+total_bytes, buf_size-total_bytes, "Value", GOB_FLOAT_ID);
+  total_bytes += gob_end_slice(buf+total_bytes, buf_size-total_bytes);
+  total_bytes += gob_end_struct_type(buf+total_bytes, buf_size-total_bytes);
+  total_bytes += gob_end_type_definition(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+struct point {
+  struct gob_string host;
+  double value;
+};
+
+static const struct gob_local_field sPointFields[] = {
+  { "Host", GOB_LOCAL_INTERN, offsetof(struct point, host) },
+  { "Value", GOB_LOCAL_DOUBLE, offsetof(struct point, value) },
+};
+static const struct gob_local_struct sPoint = { sPointFields, 2 };
+
+// Encodes a point and decodes it with dec.
+static void decode_point(struct gob_decoder *dec, const char *host, double value, struct point *point) {
+  struct gob_builder b;
+  char buf[256];
+  int id;
+
+  gob_builder_init(&b, buf, sizeof(buf));
+  gob_builder_start_message(&b, 65);
+  gob_builder_string(&b, 0, host);
+  gob_builder_double(&b, 1, value);
+  CU_ASSERT(gob_builder_end_message(&b) > 0);
+  CU_ASSERT_EQUAL(b.len, gob_decoder_next(dec, buf, b.len, &sPoint, point, &id));
+  CU_ASSERT_EQUAL(65, id);
+  // the message is gone
+  memset(buf, 0, sizeof(buf));
+}
+
+void test_gob_intern_decoder() {
+  struct gob_decoder dec;
+  struct gob_intern intern;
+  struct point first;
+  struct point point;
+  char buf[256];
+  int len;
+  int id;
+
+  CU_ASSERT_EQUAL(0, gob_decoder_init(&dec));
+  CU_ASSERT_EQUAL(0, gob_intern_init(&intern, 2, 1024));
+  dec.intern = &intern;
+  len = encode_point_type(buf, sizeof(buf), 65);
+  CU_ASSERT_EQUAL(len, gob_decoder_next(&dec, buf, len, &sPoint, &point, &id));
+  CU_ASSERT_EQUAL(0, id);
+
+  decode_point(&dec, "web-1", 1.5, &first);
+  CU_ASSERT_EQUAL(5, first.host.len);
+  CU_ASSERT_STRING_EQUAL("web-1", first.host.data);
+  CU_ASSERT_EQUAL(1.5, first.value);
+  decode_point(&dec, "web-1", 2.5, &point);
+  CU_ASSERT_PTR_EQUAL(first.host.data, point.host.data);
+  CU_ASSERT_EQUAL(2.5, point.value);
+  decode_point(&dec, "web-2", 0, &point);
+  CU_ASSERT_STRING_EQUAL("web-2", point.host.data);
+  CU_ASSERT_EQUAL(0, point.value);
+  CU_ASSERT_EQUAL(1, intern.hits);
+  CU_ASSERT_EQUAL(2, intern.misses);
+
+  // an omitted string is empty; a full table leaves strings in the message
+  decode_point(&dec, "", 1, &point);
+  CU_ASSERT_EQUAL(0, point.host.len);
+  decode_point(&dec, "web-3", 1, &point);
+  CU_ASSERT_EQUAL(5, point.host.len);
+  CU_ASSERT_EQUAL(1, intern.refused);
+
+  // without a table, interned fields are plain strings
+  dec.intern = NULL;
+  decode_point(&dec, "web-1", 1, &point);
+  CU_ASSERT_EQUAL(5, point.host.len);
+  CU_ASSERT(point.host.data != first.host.data);
+  CU_ASSERT_EQUAL(1, intern.hits);
+
+  gob_decoder_destroy(&dec);
+  gob_intern_destroy(&intern);
+}
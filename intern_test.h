@@ -0,0 +1,7 @@
+#ifndef _INTERN_TEST_H
+#define _INTERN_TEST_H
+
+void test_gob_intern_table();
+void test_gob_intern_decoder();
+
+#endif
@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "memo.h"
+
+int gob_memo_init(struct gob_memo *memo, int max_entries, size_t max_bytes) {
+  int nbuckets = 1;
+  int i;
+
+  memset(memo, 0, sizeof(struct gob_memo));
+  while (nbuckets < 2 * max_entries) {
+    nbuckets *= 2;
+  }
+  memo->entries = malloc((max_entries > 0 ? max_entries : 1) * sizeof(struct gob_memo_entry));
+  memo->buckets = malloc(nbuckets * sizeof(int));
+  if (memo->entries == NULL || memo->buckets == NULL) {
+    free(memo->entries);
+    free(memo->buckets);
+    return -1;
+  }
+  for (i = 0; i < nbuckets; i++) {
+    memo->buckets[i] = -1;
+  }
+  memo->bucket_mask = nbuckets - 1;
+  memo->max_entries = max_entries;
+  memo->max_bytes = max_bytes;
+  memo->front = -1;
+  memo->back = -1;
+  return 0;
+}
+
+void gob_memo_destroy(struct gob_memo *memo) {
+  int i;
+  for (i = 0; i < memo->nentries; i++) {
+    free(memo->entries[i].bytes);
+  }
+  free(memo->entries);
+  free(memo->buckets);
+  memset(memo, 0, sizeof(struct gob_memo));
+}
+
+// FNV-1a
+unsigned long long gob_memo_hash(const void *data, size_t len) {
+  const unsigned char *p = data;
+  unsigned long long h = 0xcbf29ce484222325ULL;
+  size_t i;
+
+  for (i = 0; i < len; i++) {
+    h = (h ^ p[i]) * 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static int gob_memo_bucket(const struct gob_memo *memo, unsigned long long key) {
+  return (int)((key * 0x9e3779b97f4a7c15ULL) >> 32) & memo->bucket_mask;
+}
+
+static int gob_memo_find(const struct gob_memo *memo, unsigned long long key) {
+  int i;
+  for (i = memo->buckets[gob_memo_bucket(memo, key)]; i >= 0 && memo->entries[i].key != key;
+       i = memo->entries[i].chain) {
+  }
+  return i;
+}
+
+static void gob_memo_unlink(struct gob_memo *memo, int i) {
+  struct gob_memo_entry *e = &memo->entries[i];
+  if (e->prev >= 0) {
+    memo->entries[e->prev].next = e->next;
+  } else {
+    memo->front = e->next;
+  }
+  if (e->next >= 0) {
+    memo->entries[e->next].prev = e->prev;
+  } else {
+    memo->back = e->prev;
+  }
+}
+
+static void gob_memo_link_front(struct gob_memo *memo, int i) {
+  struct gob_memo_entry *e = &memo->entries[i];
+  e->prev = -1;
+  e->next = memo->front;
+  if (memo->front >= 0) {
+    memo->entries[memo->front].prev = i;
+  } else {
+    memo->back = i;
+  }
+  memo->front = i;
+}
+
+// Drops entry i, moving the last entry in use into its place.
+static void gob_memo_remove(struct gob_memo *memo, int i) {
+  struct gob_memo_entry *e = &memo->entries[i];
+  int last = memo->nentries - 1;
+  int *link;
+
+  for (link = &memo->buckets[gob_memo_bucket(memo, e->key)]; *link != i; link = &memo->entries[*link].chain) {
+  }
+  *link = e->chain;
+  gob_memo_unlink(memo, i);
+  memo->bytes -= e->len;
+  free(e->bytes);
+
+  if (i != last) {
+    *e = memo->entries[last];
+    for (link = &memo->buckets[gob_memo_bucket(memo, e->key)]; *link != last;
+	 link = &memo->entries[*link].chain) {
+    }
+    *link = i;
+    if (e->prev >= 0) {
+      memo->entries[e->prev].next = i;
+    } else {
+      memo->front = i;
+    }
+    if (e->next >= 0) {
+      memo->entries[e->next].prev = i;
+    } else {
+      memo->back = i;
+    }
+  }
+  memo->nentries--;
+}
+
+const char *gob_memo_get(struct gob_memo *memo, unsigned long long key, size_t *len) {
+  int i = gob_memo_find(memo, key);
+
+  if (i < 0) {
+    memo->misses++;
+    return NULL;
+  }
+  memo->hits++;
+  if (memo->front != i) {
+    gob_memo_unlink(memo, i);
+    gob_memo_link_front(memo, i);
+  }
+  *len = memo->entries[i].len;
+  return memo->entries[i].bytes;
+}
+
+int gob_memo_put(struct gob_memo *memo, unsigned long long key, const char *bytes, size_t len) {
+  struct gob_memo_entry *e;
+  char *copy;
+  int bucket;
+  int i;
+
+  if (len > memo->max_bytes || memo->max_entries == 0) {
+    return -1;
+  }
+  copy = malloc(len > 0 ? len : 1);
+  if (copy == NULL) {
+    return -1;
+  }
+  memcpy(copy, bytes, len);
+  i = gob_memo_find(memo, key);
+  if (i >= 0) {
+    gob_memo_remove(memo, i);
+  }
+  while (memo->nentries == memo->max_entries || memo->bytes + len > memo->max_bytes) {
+    gob_memo_remove(memo, memo->back);
+    memo->evictions++;
+  }
+
+  i = memo->nentries++;
+  e = &memo->entries[i];
+  bucket = gob_memo_bucket(memo, key);
+  e->key = key;
+  e->bytes = copy;
+  e->len = len;
+  e->chain = memo->buckets[bucket];
+  memo->buckets[bucket] = i;
+  gob_memo_link_front(memo, i);
+  memo->bytes += len;
+  return 0;
+}
+
+int gob_memo_encode(struct gob_memo *memo, unsigned long long key, char *buf, size_t buf_size,
+		    gob_memo_encoder encode, void *ctx) {
+  const char *bytes;
+  size_t len;
+  int num_bytes;
+
+  bytes = gob_memo_get(memo, key, &len);
+  if (bytes != NULL) {
+    memcpy(buf, bytes, len < buf_size ? len : buf_size);
+    return (int)len;
+  }
+  num_bytes = encode(buf, buf_size, ctx);
+  if (num_bytes >= 0 && (size_t)num_bytes <= buf_size) {
+    gob_memo_put(memo, key, buf, num_bytes);
+  }
+  return num_bytes;
+}
@@ -0,0 +1,125 @@
+#ifndef _MEMO_H
+#define _MEMO_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Memoization of encoded values.
+ *
+ * Values sent over and over, e.g. a configuration struct embedded in every
+ * message, need to be encoded only once.  A gob_memo keeps the encoded bytes
+ * of such values under a 64-bit key and copies them into later encodings:
+ *
+ * \code
+ * static int encode_config(char *buf, size_t buf_size, void *ctx) {
+ *   ...encode the struct, as following its field delta...
+ * }
+ *
+ * total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, delta);
+ * total_bytes += gob_memo_encode(&memo, config->version, buf+total_bytes, buf_size-total_bytes,
+ *                                encode_config, config);
+ * \endcode
+ *
+ * The key is whatever identifies the value to the caller, e.g. an id and
+ * version, or gob_memo_hash() of the value's contents.  Two values under the
+ * same key are taken to encode the same.
+ *
+ * The memo holds a bounded number of entries and bytes; when either bound is
+ * reached, the least recently used entries are dropped.  It is not
+ * synchronized, threads use memos of their own.
+ */
+
+struct gob_memo_entry {
+  unsigned long long key;
+  char *bytes;
+  size_t len;
+  int prev;                 // towards the most recently used, -1 at the front
+  int next;                 // towards the least recently used, -1 at the back
+  int chain;                // next entry in the same hash bucket, -1 at the end
+};
+
+struct gob_memo {
+  struct gob_memo_entry *entries;
+  int max_entries;
+  int nentries;             // entries in use, the rest are free
+  int *buckets;             // first entry by hash, -1 if none
+  int bucket_mask;
+  int front;                // most recently used entry, -1 if none
+  int back;                 // least recently used entry, -1 if none
+  size_t bytes;             // of all entries
+  size_t max_bytes;
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;
+};
+
+/**
+ * Initializes a memo.
+ *
+ * @param max_entries
+ *   The number of values kept at most.
+ * @param max_bytes
+ *   The total size of the values kept at most.  Larger values are not kept.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_memo_init(struct gob_memo *memo, int max_entries, size_t max_bytes);
+
+void gob_memo_destroy(struct gob_memo *memo);
+
+/**
+ * Hashes the contents of a value into a key.
+ */
+unsigned long long gob_memo_hash(const void *data, size_t len);
+
+/**
+ * Looks up a value and marks it as recently used.  Counts a hit or a miss.
+ *
+ * @param len
+ *   Receives the size of the value.
+ *
+ * @return
+ *   The encoded value, valid until the next change of the memo, or NULL.
+ */
+const char *gob_memo_get(struct gob_memo *memo, unsigned long long key, size_t *len);
+
+/**
+ * Keeps a copy of an encoded value, replacing any value under the same key.
+ *
+ * @return
+ *   0 on success, -1 if the value is larger than the memo or memory ran
+ *   out.
+ */
+int gob_memo_put(struct gob_memo *memo, unsigned long long key, const char *bytes, size_t len);
+
+/**
+ * Encodes a value as the encoders in encode.h do.
+ *
+ * @param buf_size
+ *   The size of buf, which the encoder is called with as well.
+ *
+ * @return
+ *   The number of bytes that would have been written.
+ */
+typedef int (*gob_memo_encoder)(char *buf, size_t buf_size, void *ctx);
+
+/**
+ * Copies the value under key into buf, or encodes it with encode and keeps
+ * it if it is not there yet.
+ *
+ * @return
+ *   The number of bytes that would have been written.
+ */
+int gob_memo_encode(struct gob_memo *memo, unsigned long long key, char *buf, size_t buf_size,
+		    gob_memo_encoder encode, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,137 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "memo.h"
+#include <stdio.h>
+#include <string.h>
+
+void test_gob_memo_lru() {
+  struct gob_memo memo;
+  const char *bytes;
+  char value[128];
+  size_t len;
+  int i;
+
+  CU_ASSERT_EQUAL(0, gob_memo_init(&memo, 4, 100));
+  CU_ASSERT_PTR_NULL(gob_memo_get(&memo, 1, &len));
+  for (i = 1; i <= 4; i++) {
+    memset(value, 'a' + i, i);
+    CU_ASSERT_EQUAL(0, gob_memo_put(&memo, i, value, i));
+  }
+  bytes = gob_memo_get(&memo, 3, &len);
+  CU_ASSERT_PTR_NOT_NULL_FATAL(bytes);
+  CU_ASSERT_EQUAL(3, len);
+  CU_ASSERT(memcmp(bytes, "ddd", 3) == 0);
+  CU_ASSERT_EQUAL(1, memo.hits);
+  CU_ASSERT_EQUAL(1, memo.misses);
+
+  // a fifth entry drops the least recently used one, 1
+  gob_memo_get(&memo, 2, &len);
+  gob_memo_get(&memo, 4, &len);
+  CU_ASSERT_EQUAL(0, gob_memo_put(&memo, 5, "eeeee", 5));
+  CU_ASSERT_EQUAL(1, memo.evictions);
+  CU_ASSERT_PTR_NULL(gob_memo_get(&memo, 1, &len));
+  CU_ASSERT_PTR_NOT_NULL(gob_memo_get(&memo, 2, &len));
+  CU_ASSERT_PTR_NOT_NULL(gob_memo_get(&memo, 5, &len));
+  CU_ASSERT_EQUAL(2 + 3 + 4 + 5, memo.bytes);
+
+  // 90 more bytes exceed 100, dropping 3 and 4 but not 2 and 5
+  memset(value, 'x', 90);
+  CU_ASSERT_EQUAL(0, gob_memo_put(&memo, 6, value, 90));
+  CU_ASSERT_EQUAL(3, memo.evictions);
+  CU_ASSERT_EQUAL(3, memo.nentries);
+  CU_ASSERT_EQUAL(2 + 5 + 90, memo.bytes);
+  CU_ASSERT_PTR_NULL(gob_memo_get(&memo, 3, &len));
+  CU_ASSERT_PTR_NULL(gob_memo_get(&memo, 4, &len));
+  bytes = gob_memo_get(&memo, 2, &len);
+  CU_ASSERT(bytes != NULL && len == 2 && memcmp(bytes, "cc", 2) == 0);
+
+  // replacing a value, and one too large to keep
+  CU_ASSERT_EQUAL(0, gob_memo_put(&memo, 2, "zz", 2));
+  bytes = gob_memo_get(&memo, 2, &len);
+  CU_ASSERT(bytes != NULL && len == 2 && memcmp(bytes, "zz", 2) == 0);
+  CU_ASSERT_EQUAL(3, memo.nentries);
+  CU_ASSERT_EQUAL(-1, gob_memo_put(&memo, 7, value, 101));
+
+  CU_ASSERT_EQUAL(gob_memo_hash("abc", 3), gob_memo_hash("abc", 3));
+  CU_ASSERT_NOT_EQUAL(gob_memo_hash("abc", 3), gob_memo_hash("abd", 3));
+  gob_memo_destroy(&memo);
+}
+
+struct instrument {
+  const char *symbol;
+  const char *exchange;
+  long long lot;
+  int encodes;
+};
+
+// type Instrument struct { Symbol string; Exchange string; Lot int }
+static int encode_instrument(char *buf, size_t buf_size, void *ctx) {
+  struct instrument *in = ctx;
+  int total_bytes = 0;
+  in->encodes++;
+  total_bytes += gob_start_struct(buf, buf_size);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, buf_size-total_bytes, in->symbol);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, buf_size-total_bytes, in->exchange);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_long_long(buf+total_bytes, buf_size-total_bytes, in->lot);
+  total_bytes += gob_end_struct(buf+total_bytes, buf_size-total_bytes);
+  return total_bytes;
+}
+
+// type Order struct { Id int; Instrument Instrument }
+static int encode_order(char *buf, size_t buf_size, struct gob_memo *memo, long long id,
+			struct instrument *in) {
+  int total_bytes = 0;
+  total_bytes += gob_start_message(buf, buf_size, 66);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_long_long(buf+total_bytes, buf_size-total_bytes, id);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  if (memo != NULL) {
+    total_bytes += gob_memo_encode(memo, gob_memo_hash(in->symbol, strlen(in->symbol)),
+				   buf+total_bytes, buf_size-total_bytes, encode_instrument, in);
+  } else {
+    total_bytes += encode_instrument(buf+total_bytes, buf_size-total_bytes, in);
+  }
+  total_bytes += gob_end_struct(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+void test_gob_memo_encode() {
+  struct instrument instruments[] = {
+    { "GOOG", "NASDAQ", 100 },
+    { "IBM", "NYSE", 10 },
+  };
+  struct instrument plain = instruments[0];
+  struct gob_memo memo;
+  char expected[128];
+  char buf[128];
+  int expected_len;
+  int errors = 0;
+  int i;
+
+  CU_ASSERT_EQUAL(0, gob_memo_init(&memo, 16, 4096));
+  for (i = 0; i < 100; i++) {
+    plain = instruments[i % 2];
+    expected_len = encode_order(expected, sizeof(expected), NULL, i, &plain);
+    errors += encode_order(buf, sizeof(buf), &memo, i, &instruments[i % 2]) != expected_len;
+    errors += memcmp(expected, buf, expected_len) != 0;
+  }
+  CU_ASSERT_EQUAL(0, errors);
+  CU_ASSERT_EQUAL(1, instruments[0].encodes);
+  CU_ASSERT_EQUAL(1, instruments[1].encodes);
+  CU_ASSERT_EQUAL(98, memo.hits);
+  CU_ASSERT_EQUAL(2, memo.misses);
+
+  // an encoding that did not fit is not kept
+  gob_memo_destroy(&memo);
+  CU_ASSERT_EQUAL(0, gob_memo_init(&memo, 16, 4096));
+  CU_ASSERT_EQUAL(expected_len, encode_order(buf, 10, &memo, 99, &instruments[1]));
+  CU_ASSERT_EQUAL(0, memo.nentries);
+  gob_memo_destroy(&memo);
+}
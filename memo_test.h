@@ -0,0 +1,7 @@
+#ifndef _MEMO_TEST_H
+#define _MEMO_TEST_H
+
+void test_gob_memo_lru();
+void test_gob_memo_encode();
+
+#endif
@@ -0,0 +1,154 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+#include "mpsc.h"
+
+// Every message in the ring starts with this header.  Reservations are
+// multiples of GOB_MPSC_ALIGN, so a padding record always fits in front of
+// the wrap-around.
+struct gob_mpsc_header {
+  unsigned int state;   // GOB_MPSC_COMMITTED, GOB_MPSC_PADDING
+  int id;
+  unsigned int len;     // committed message length
+  unsigned int span;    // bytes reserved including the header
+};
+
+#define GOB_MPSC_ALIGN (sizeof(struct gob_mpsc_header))
+#define GOB_MPSC_COMMITTED (1u)
+#define GOB_MPSC_PADDING   (2u)
+
+int gob_mpsc_init(struct gob_mpsc *ring, size_t size) {
+  size_t rounded = GOB_MPSC_ALIGN;
+  while (rounded < size) {
+    rounded <<= 1;
+  }
+  memset(ring, 0, sizeof(struct gob_mpsc));
+  ring->buf = aligned_alloc(GOB_MPSC_ALIGN, rounded);
+  if (ring->buf == NULL) {
+    return -1;
+  }
+  memset(ring->buf, 0, rounded);
+  ring->size = rounded;
+  return 0;
+}
+
+void gob_mpsc_destroy(struct gob_mpsc *ring) {
+  free(ring->buf);
+  ring->buf = NULL;
+  ring->size = 0;
+}
+
+int gob_mpsc_define(struct gob_mpsc *ring, int id, const char *def, size_t len, const int *deps, int ndeps) {
+  struct gob_mpsc_type *type;
+
+  if (id <= 0 || id >= GOB_MPSC_MAX_TYPES || ndeps < 0 || ndeps > GOB_MPSC_MAX_DEPS) {
+    errno = EINVAL;
+    return -1;
+  }
+  type = &ring->types[id];
+  type->def = def;
+  type->len = len;
+  if (ndeps > 0) {
+    memcpy(type->deps, deps, ndeps * sizeof(int));
+  }
+  type->ndeps = ndeps;
+  __atomic_store_n(&type->defined, 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+char *gob_mpsc_reserve(struct gob_mpsc *ring, size_t len) {
+  size_t mask = ring->size - 1;
+  size_t span = (sizeof(struct gob_mpsc_header) + len + GOB_MPSC_ALIGN - 1) & ~(GOB_MPSC_ALIGN - 1);
+  unsigned long long head;
+  unsigned long long tail;
+  size_t offset;
+  size_t padding;
+  struct gob_mpsc_header *hdr;
+
+  if (span > ring->size) {
+    return NULL;
+  }
+  head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  do {
+    tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    offset = head & mask;
+    padding = span > ring->size - offset ? ring->size - offset : 0;
+    if (head + padding + span - tail > ring->size) {
+      return NULL;
+    }
+  } while (!__atomic_compare_exchange_n(&ring->head, &head, head + padding + span, 1,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  if (padding != 0) {
+    hdr = (struct gob_mpsc_header*)(ring->buf + offset);
+    hdr->span = padding;
+    __atomic_store_n(&hdr->state, GOB_MPSC_COMMITTED | GOB_MPSC_PADDING, __ATOMIC_RELEASE);
+    offset = 0;
+  }
+  hdr = (struct gob_mpsc_header*)(ring->buf + offset);
+  hdr->span = span;
+  return (char*)(hdr + 1);
+}
+
+void gob_mpsc_commit(struct gob_mpsc *ring, char *msg, size_t len, int id) {
+  struct gob_mpsc_header *hdr = (struct gob_mpsc_header*)msg - 1;
+
+  (void)ring;
+  hdr->id = id;
+  hdr->len = len;
+  __atomic_store_n(&hdr->state, GOB_MPSC_COMMITTED, __ATOMIC_RELEASE);
+}
+
+// Passes the definition of id and its dependencies to the sink unless they
+// have been sent already.  Returns the sink's verdict.
+static int gob_mpsc_send_definition(struct gob_mpsc *ring, int id, gob_mpsc_sink sink, void *ctx) {
+  struct gob_mpsc_type *type;
+  int i;
+  int ret;
+
+  if (id <= 0 || id >= GOB_MPSC_MAX_TYPES || (ring->sent[id/8] & (1 << (id%8)))) {
+    return 0;
+  }
+  type = &ring->types[id];
+  if (!__atomic_load_n(&type->defined, __ATOMIC_ACQUIRE)) {
+    return 0;
+  }
+  ring->sent[id/8] |= 1 << (id%8);
+  ret = sink(ctx, type->def, type->len);
+  for (i = 0; i < type->ndeps && ret == 0; i++) {
+    ret = gob_mpsc_send_definition(ring, type->deps[i], sink, ctx);
+  }
+  return ret;
+}
+
+int gob_mpsc_consume(struct gob_mpsc *ring, gob_mpsc_sink sink, void *ctx, int max) {
+  size_t mask = ring->size - 1;
+  unsigned long long tail = ring->tail;
+  struct gob_mpsc_header *hdr;
+  unsigned int state;
+  int count = 0;
+  int stop = 0;
+
+  while (count < max && !stop) {
+    hdr = (struct gob_mpsc_header*)(ring->buf + (tail & mask));
+    state = __atomic_load_n(&hdr->state, __ATOMIC_ACQUIRE);
+    if (!(state & GOB_MPSC_COMMITTED)) {
+      break;
+    }
+    if (!(state & GOB_MPSC_PADDING) && hdr->len > 0) {
+      stop = gob_mpsc_send_definition(ring, hdr->id, sink, ctx);
+      if (stop) {
+	break;
+      }
+      stop = sink(ctx, (const char*)(hdr + 1), hdr->len);
+      count++;
+    }
+    tail += hdr->span;
+    // messages of other sizes put their headers anywhere in the span
+    memset(hdr, 0, hdr->span);
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  }
+  return count;
+}
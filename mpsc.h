@@ -0,0 +1,153 @@
+#ifndef _MPSC_H
+#define _MPSC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Lock-free multi-producer, single-consumer ring of framed messages.
+ *
+ * Any number of threads encode messages straight into space reserved in a
+ * shared ring; one thread takes them out in reservation order and writes
+ * them to a single gob stream, e.g. through a gob_writer:
+ *
+ * \code
+ * // producer
+ * char *p = gob_mpsc_reserve(ring, max_len);
+ * if (p != NULL) {
+ *   int body_len = ...encode the value into p...;
+ *   gob_mpsc_commit(ring, p, gob_end_message(p, max_len, body_len), type_id);
+ * }
+ *
+ * // consumer
+ * gob_mpsc_consume(ring, write_message, &writer, 64);
+ * \endcode
+ *
+ * Reserving is a single compare-and-swap on the ring's head; committing is a
+ * release store into the message's header.
+ *
+ * Type definitions are registered once with gob_mpsc_define().  The
+ * consumer hands out the definition of a type (and of the types it depends
+ * on) right before the first value of that type, so every definition is sent
+ * exactly once and before it is needed.
+ */
+
+/**
+ * Type ids below this value can be registered with gob_mpsc_define().
+ */
+#define GOB_MPSC_MAX_TYPES (1024)
+
+/**
+ * The number of types a definition may depend on.
+ */
+#define GOB_MPSC_MAX_DEPS (16)
+
+struct gob_mpsc_type {
+  const char *def;     // framed definition message
+  size_t len;
+  int deps[GOB_MPSC_MAX_DEPS];
+  int ndeps;
+  int defined;
+};
+
+struct gob_mpsc {
+  char *buf;
+  size_t size;               // a power of two
+  // producers and consumer write these, keep them on separate cache lines
+  unsigned long long head __attribute__((aligned(64)));
+  unsigned long long tail __attribute__((aligned(64)));
+  // consumer state
+  unsigned char sent[GOB_MPSC_MAX_TYPES/8] __attribute__((aligned(64)));
+  struct gob_mpsc_type types[GOB_MPSC_MAX_TYPES];
+};
+
+/**
+ * Called by gob_mpsc_consume() for every message, in stream order.
+ *
+ * @return
+ *   0 to continue, anything else stops gob_mpsc_consume() before the next
+ *   message.
+ */
+typedef int (*gob_mpsc_sink)(void *ctx, const char *msg, size_t len);
+
+/**
+ * Initializes a ring.
+ *
+ * @param size
+ *   The size of the ring in bytes, rounded up to a power of two.
+ *
+ * @return
+ *   0 on success, -1 with errno set if the ring could not be allocated.
+ */
+int gob_mpsc_init(struct gob_mpsc *ring, size_t size);
+
+/**
+ * Releases the ring's buffer.  No producer may be using the ring anymore.
+ */
+void gob_mpsc_destroy(struct gob_mpsc *ring);
+
+/**
+ * Registers the definition of a type.  Must happen before the first value of
+ * the type is committed.
+ *
+ * @param id
+ *   The type id, below GOB_MPSC_MAX_TYPES.
+ * @param def
+ *   The framed type definition message.  It is not copied and must outlive
+ *   the ring.
+ * @param len
+ *   The length of the definition.
+ * @param deps
+ *   The ids of the user types the definition refers to, which are sent
+ *   after it if they have not been sent yet.
+ * @param ndeps
+ *   The number of dependencies, at most GOB_MPSC_MAX_DEPS.
+ *
+ * @return
+ *   0 on success, -1 if id or ndeps are out of range.
+ */
+int gob_mpsc_define(struct gob_mpsc *ring, int id, const char *def, size_t len, const int *deps, int ndeps);
+
+/**
+ * Reserves space for a framed message of up to len bytes.  Safe to call from
+ * any thread.
+ *
+ * @return
+ *   The space to encode the message into, or NULL if the ring is full.
+ */
+char *gob_mpsc_reserve(struct gob_mpsc *ring, size_t len);
+
+/**
+ * Publishes a message encoded into reserved space.  Every reservation must be
+ * committed, since the consumer waits for it; commit a length of 0 to
+ * abandon a reservation.
+ *
+ * @param msg
+ *   The pointer returned by gob_mpsc_reserve().
+ * @param len
+ *   The length of the framed message, at most the reserved length.
+ * @param id
+ *   The type id of the value, or 0 if no definition has to precede it.
+ */
+void gob_mpsc_commit(struct gob_mpsc *ring, char *msg, size_t len, int id);
+
+/**
+ * Passes committed messages to the sink, preceded by any definitions they
+ * need.  Must only be called from one thread at a time.
+ *
+ * @param max
+ *   The maximum number of value messages to pass on.
+ *
+ * @return
+ *   The number of value messages passed on.
+ */
+int gob_mpsc_consume(struct gob_mpsc *ring, gob_mpsc_sink sink, void *ctx, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,250 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "mpsc.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define PRODUCERS (4)
+#define MESSAGES (20000)
+
+static const char sOuterDef[] = "outer";
+static const char sInnerDef[] = "inner";
+static const char sOtherDef[] = "other";
+
+struct producer {
+  struct gob_mpsc *ring;
+  int index;
+};
+
+struct collector {
+  int next[PRODUCERS];
+  int defs[3];
+  int values;
+  int errors;
+};
+
+static void *produce(void *arg) {
+  struct producer *p = arg;
+  char *space;
+  int msg[2];
+  int i;
+
+  for (i = 0; i < MESSAGES; i++) {
+    while ((space = gob_mpsc_reserve(p->ring, sizeof(msg))) == NULL) {
+      sched_yield();
+    }
+    msg[0] = p->index;
+    msg[1] = i;
+    memcpy(space, msg, sizeof(msg));
+    gob_mpsc_commit(p->ring, space, sizeof(msg), i % 2 ? 65 : 67);
+  }
+  return NULL;
+}
+
+static int collect(void *ctx, const char *msg, size_t len) {
+  struct collector *c = ctx;
+  int value[2];
+
+  if (msg == sOuterDef) {
+    c->errors += c->defs[0]++ != 0 || c->defs[1] != 0;
+  } else if (msg == sInnerDef) {
+    c->errors += c->defs[1]++ != 0 || c->defs[0] != 1;
+  } else if (msg == sOtherDef) {
+    c->errors += c->defs[2]++ != 0;
+  } else {
+    memcpy(value, msg, sizeof(value));
+    c->errors += len != sizeof(value);
+    c->errors += value[0] < 0 || value[0] >= PRODUCERS || c->next[value[0]] != value[1];
+    // values of type 65 need both definitions, 67 needs its own
+    c->errors += value[1] % 2 ? c->defs[0] != 1 || c->defs[1] != 1 : c->defs[2] != 1;
+    c->next[value[0]] = value[1] + 1;
+    c->values++;
+  }
+  return 0;
+}
+
+void test_gob_mpsc_producers() {
+  static struct gob_mpsc ring;
+  struct producer producers[PRODUCERS];
+  pthread_t threads[PRODUCERS];
+  struct collector c;
+  int inner = 66;
+  int i;
+
+  memset(&c, 0, sizeof(c));
+  CU_ASSERT_EQUAL(0, gob_mpsc_init(&ring, 4096));
+  CU_ASSERT_EQUAL(0, gob_mpsc_define(&ring, 65, sOuterDef, sizeof(sOuterDef), &inner, 1));
+  CU_ASSERT_EQUAL(0, gob_mpsc_define(&ring, 66, sInnerDef, sizeof(sInnerDef), NULL, 0));
+  CU_ASSERT_EQUAL(0, gob_mpsc_define(&ring, 67, sOtherDef, sizeof(sOtherDef), NULL, 0));
+  CU_ASSERT_EQUAL(-1, gob_mpsc_define(&ring, GOB_MPSC_MAX_TYPES, sOtherDef, sizeof(sOtherDef), NULL, 0));
+
+  for (i = 0; i < PRODUCERS; i++) {
+    producers[i].ring = &ring;
+    producers[i].index = i;
+    pthread_create(&threads[i], NULL, produce, &producers[i]);
+  }
+  while (c.values < PRODUCERS * MESSAGES) {
+    if (gob_mpsc_consume(&ring, collect, &c, 64) == 0) {
+      sched_yield();
+    }
+  }
+  for (i = 0; i < PRODUCERS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  CU_ASSERT_EQUAL(0, c.errors);
+  CU_ASSERT_EQUAL(1, c.defs[0]);
+  CU_ASSERT_EQUAL(1, c.defs[1]);
+  CU_ASSERT_EQUAL(1, c.defs[2]);
+  for (i = 0; i < PRODUCERS; i++) {
+    CU_ASSERT_EQUAL(MESSAGES, c.next[i]);
+  }
+  CU_ASSERT_EQUAL(0, gob_mpsc_consume(&ring, collect, &c, 64));
+  gob_mpsc_destroy(&ring);
+}
+
+struct stream {
+  char buf[256];
+  size_t len;
+};
+
+static int append(void *ctx, const char *msg, size_t len) {
+  struct stream *s = ctx;
+  memcpy(s->buf + s->len, msg, len);
+  s->len += len;
+  return 0;
+}
+
+void test_gob_mpsc_wrap() {
+  static struct gob_mpsc ring;
+  struct stream s;
+  char expected[16];
+  char *p;
+  char *q;
+  int len;
+
+  memset(&s, 0, sizeof(s));
+  CU_ASSERT_EQUAL(0, gob_mpsc_init(&ring, 100));
+  CU_ASSERT_EQUAL(128, ring.size);
+
+  // a 32-byte record is followed by one abandoned reservation
+  p = gob_mpsc_reserve(&ring, 16);
+  q = gob_mpsc_reserve(&ring, 60);
+  CU_ASSERT_PTR_NOT_NULL(p);
+  CU_ASSERT_PTR_NOT_NULL(q);
+  CU_ASSERT_PTR_NULL(gob_mpsc_reserve(&ring, 60));
+
+  // the abandoned space is reclaimed only once committed, in order
+  gob_mpsc_commit(&ring, q, 0, 0);
+  CU_ASSERT_EQUAL(0, gob_mpsc_consume(&ring, append, &s, 8));
+  len = gob_start_message(p, 16, 65);
+  len += gob_encode_unsigned_int(p+len, 16-len, 7);
+  len = gob_end_message(p, 16, len);
+  memcpy(expected, p, len);
+  gob_mpsc_commit(&ring, p, len, 0);
+  CU_ASSERT_EQUAL(1, gob_mpsc_consume(&ring, append, &s, 8));
+  CU_ASSERT_EQUAL(112, ring.tail);
+
+  // 16 bytes are left before the end; the next record pads them and wraps
+  p = gob_mpsc_reserve(&ring, 16);
+  CU_ASSERT_PTR_EQUAL(ring.buf + 16, p);
+  CU_ASSERT_EQUAL(112 + 16 + 32, ring.head);
+  memcpy(p, expected, len);
+  gob_mpsc_commit(&ring, p, len, 0);
+  CU_ASSERT_EQUAL(1, gob_mpsc_consume(&ring, append, &s, 8));
+  CU_ASSERT_EQUAL(ring.head, ring.tail);
+
+  CU_ASSERT_EQUAL(2*len, s.len);
+  CU_ASSERT(memcmp(expected, s.buf, len) == 0);
+  CU_ASSERT(memcmp(expected, s.buf + len, len) == 0);
+  gob_mpsc_destroy(&ring);
+}
+
+struct sizes {
+  size_t lens[4];
+  int n;
+  int errors;
+};
+
+static int check_sizes(void *ctx, const char *msg, size_t len) {
+  struct sizes *c = ctx;
+  size_t i;
+
+  c->errors += c->n >= 4;
+  if (c->n < 4) {
+    c->lens[c->n++] = len;
+  }
+  for (i = 0; i < len; i++) {
+    c->errors += msg[i] != (char)len;
+  }
+  return 0;
+}
+
+void test_gob_mpsc_sizes() {
+  static struct gob_mpsc ring;
+  struct sizes c;
+  char *p;
+  char *q;
+  char *r;
+  size_t a;
+  size_t b;
+  int lap;
+
+  // payload bytes of an earlier lap under the header of a reservation that
+  // is not committed yet
+  memset(&c, 0, sizeof(c));
+  CU_ASSERT_EQUAL(0, gob_mpsc_init(&ring, 128));
+  p = gob_mpsc_reserve(&ring, 41);
+  memset(p, 41, 41);        // odd, as a committed state
+  gob_mpsc_commit(&ring, p, 41, 0);
+  p = gob_mpsc_reserve(&ring, 8);
+  memset(p, 8, 8);
+  gob_mpsc_commit(&ring, p, 8, 0);
+  CU_ASSERT_EQUAL(2, gob_mpsc_consume(&ring, check_sizes, &c, 8));
+  p = gob_mpsc_reserve(&ring, 8);
+  q = gob_mpsc_reserve(&ring, 8);
+  r = gob_mpsc_reserve(&ring, 8);
+  CU_ASSERT_PTR_EQUAL(ring.buf + 96 + 16, p);
+  CU_ASSERT_PTR_EQUAL(ring.buf + 16, q);
+  CU_ASSERT_PTR_EQUAL(ring.buf + 32 + 16, r);
+  memset(p, 8, 8);
+  memset(q, 8, 8);
+  memset(r, 8, 8);
+  gob_mpsc_commit(&ring, p, 8, 0);
+  gob_mpsc_commit(&ring, q, 8, 0);
+  c.n = 0;
+  CU_ASSERT_EQUAL(2, gob_mpsc_consume(&ring, check_sizes, &c, 8));
+  gob_mpsc_commit(&ring, r, 8, 0);
+  CU_ASSERT_EQUAL(1, gob_mpsc_consume(&ring, check_sizes, &c, 8));
+  CU_ASSERT_EQUAL(0, c.errors);
+  gob_mpsc_destroy(&ring);
+
+  // lap after lap of records of all sizes, the first of every pair held back
+  // until the second has been committed
+  memset(&c, 0, sizeof(c));
+  CU_ASSERT_EQUAL(0, gob_mpsc_init(&ring, 512));
+  for (lap = 0; lap < 5000; lap++) {
+    a = 1 + (lap * 7) % 96;
+    b = 1 + (lap * 13) % 96;
+    p = gob_mpsc_reserve(&ring, a);
+    q = gob_mpsc_reserve(&ring, b);
+    CU_ASSERT_FATAL(p != NULL && q != NULL);
+    memset(p, (char)a, a);
+    memset(q, (char)b, b);
+    gob_mpsc_commit(&ring, q, b, 0);
+    c.n = 0;
+    CU_ASSERT_EQUAL(0, gob_mpsc_consume(&ring, check_sizes, &c, 8));
+    gob_mpsc_commit(&ring, p, a, 0);
+    CU_ASSERT_EQUAL(2, gob_mpsc_consume(&ring, check_sizes, &c, 8));
+    CU_ASSERT(c.lens[0] == a && c.lens[1] == b);
+    CU_ASSERT_EQUAL(ring.head, ring.tail);
+  }
+  CU_ASSERT_EQUAL(0, c.errors);
+  gob_mpsc_destroy(&ring);
+}
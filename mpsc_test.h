@@ -0,0 +1,8 @@
+#ifndef _MPSC_TEST_H
+#define _MPSC_TEST_H
+
+void test_gob_mpsc_producers();
+void test_gob_mpsc_wrap();
+void test_gob_mpsc_sizes();
+
+#endif
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include "outq.h"
+
+int gob_outq_init(struct gob_outq *q, size_t size, size_t high_water, size_t low_water) {
+  memset(q, 0, sizeof(struct gob_outq));
+  q->buf = malloc(size);
+  if (q->buf == NULL) {
+    return -1;
+  }
+  q->size = size;
+  q->high_water = high_water;
+  q->low_water = low_water;
+  return 0;
+}
+
+void gob_outq_destroy(struct gob_outq *q) {
+  free(q->buf);
+  q->buf = NULL;
+  q->size = 0;
+}
+
+int gob_outq_empty(const struct gob_outq *q) {
+  return q->queued == 0;
+}
+
+int gob_outq_blocked(const struct gob_outq *q) {
+  return q->blocked;
+}
+
+char *gob_outq_reserve(struct gob_outq *q, size_t size) {
+  if (q->wrap != 0) {
+    // lower part grows towards head; keep tail != head
+    if (q->head - q->tail > size) {
+      q->reserved = q->tail;
+      return q->buf + q->tail;
+    }
+    return NULL;
+  }
+  if (q->size - q->tail >= size) {
+    q->reserved = q->tail;
+    return q->buf + q->tail;
+  }
+  if (q->head > size) {
+    q->reserved = 0;
+    return q->buf;
+  }
+  return NULL;
+}
+
+void gob_outq_commit(struct gob_outq *q, size_t len) {
+  if (q->wrap == 0 && q->reserved == 0 && q->tail != 0) {
+    // the reservation started a lower part
+    q->wrap = q->tail;
+    q->tail = 0;
+  }
+  q->tail += len;
+  q->queued += len;
+  if (q->queued >= q->high_water) {
+    q->blocked = 1;
+  }
+}
+
+int gob_outq_push(struct gob_outq *q, const char *msg, size_t len) {
+  char *space = gob_outq_reserve(q, len);
+  if (space == NULL) {
+    errno = EAGAIN;
+    return -1;
+  }
+  memcpy(space, msg, len);
+  gob_outq_commit(q, len);
+  return 0;
+}
+
+// Consumes n sent bytes.
+static void gob_outq_consume(struct gob_outq *q, size_t n) {
+  q->queued -= n;
+  if (q->wrap != 0) {
+    size_t upper = q->wrap - q->head;
+    if (n < upper) {
+      q->head += n;
+      return;
+    }
+    n -= upper;
+    q->head = 0;
+    q->wrap = 0;
+  }
+  q->head += n;
+  if (q->queued == 0) {
+    q->head = q->tail = 0;
+  }
+}
+
+long gob_outq_drain(struct gob_outq *q, int fd) {
+  long total = 0;
+
+  while (q->queued > 0) {
+    struct iovec iov[2];
+    int iovcnt = 0;
+    ssize_t n;
+
+    if (q->wrap != 0) {
+      iov[iovcnt].iov_base = q->buf + q->head;
+      iov[iovcnt].iov_len = q->wrap - q->head;
+      iovcnt++;
+      if (q->tail > 0) {
+	iov[iovcnt].iov_base = q->buf;
+	iov[iovcnt].iov_len = q->tail;
+	iovcnt++;
+      }
+    } else {
+      iov[iovcnt].iov_base = q->buf + q->head;
+      iov[iovcnt].iov_len = q->tail - q->head;
+      iovcnt++;
+    }
+    n = writev(fd, iov, iovcnt);
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	break;
+      }
+      return -1;
+    }
+    gob_outq_consume(q, n);
+    total += n;
+  }
+  if (q->queued <= q->low_water) {
+    q->blocked = 0;
+  }
+  return total;
+}
@@ -0,0 +1,122 @@
+#ifndef _OUTQ_H
+#define _OUTQ_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Non-blocking output queue for event loops.
+ *
+ * A gob_outq is a fixed-size bipartite ring buffer of framed messages waiting
+ * to be sent on a non-blocking socket.  Messages are encoded directly into
+ * the queue with gob_outq_reserve() and gob_outq_commit() (or copied in with
+ * gob_outq_push()), so queueing a message allocates nothing.  The event loop
+ * calls gob_outq_drain() when the socket is writable; a message cut short by
+ * EAGAIN stays in the queue and continues on the next call.
+ *
+ * \code
+ * if (events & EPOLLOUT) {
+ *   if (gob_outq_drain(&q, fd) < 0) ... error ...
+ *   if (gob_outq_empty(&q)) ... stop polling for EPOLLOUT ...
+ *   if (!gob_outq_blocked(&q)) ... resume producing ...
+ * }
+ * \endcode
+ *
+ * Backpressure: once the queued bytes reach the high-water mark the queue
+ * reports itself blocked, and stays so until draining brings it down to the
+ * low-water mark.  The queue keeps accepting messages while blocked, as long
+ * as they fit.
+ */
+
+struct gob_outq {
+  char *buf;
+  size_t size;
+  size_t head;      // first byte to send
+  size_t tail;      // end of queued bytes (in the lower part when wrapped)
+  size_t wrap;      // end of the upper part when wrapped, otherwise 0
+  size_t reserved;  // offset of the current reservation
+  size_t queued;    // bytes queued
+  size_t high_water;
+  size_t low_water;
+  int blocked;
+};
+
+/**
+ * Initializes a queue.
+ *
+ * @param q
+ *   The queue to initialize.
+ * @param size
+ *   The capacity in bytes; no message may be larger.
+ * @param high_water
+ *   The number of queued bytes at which the queue becomes blocked.
+ * @param low_water
+ *   The number of queued bytes at which a blocked queue is released.
+ *
+ * @return
+ *   0 on success, -1 with errno set if the buffer could not be allocated.
+ */
+int gob_outq_init(struct gob_outq *q, size_t size, size_t high_water, size_t low_water);
+
+/**
+ * Releases the queue's buffer, dropping anything not yet sent.
+ */
+void gob_outq_destroy(struct gob_outq *q);
+
+/**
+ * Returns contiguous space for a message of up to size bytes.
+ *
+ * @return
+ *   A pointer to the space, or NULL if the queue does not have that much
+ *   contiguous space free right now.
+ */
+char *gob_outq_reserve(struct gob_outq *q, size_t size);
+
+/**
+ * Queues the message encoded into the space returned by the last
+ * gob_outq_reserve().
+ *
+ * @param len
+ *   The size of the framed message, at most the reserved size.
+ */
+void gob_outq_commit(struct gob_outq *q, size_t len);
+
+/**
+ * Copies a framed message into the queue.
+ *
+ * @return
+ *   0 on success, -1 (errno EAGAIN) if it does not fit right now.
+ */
+int gob_outq_push(struct gob_outq *q, const char *msg, size_t len);
+
+/**
+ * Sends as much as the socket accepts.
+ *
+ * @param fd
+ *   A non-blocking file descriptor.
+ *
+ * @return
+ *   The number of bytes sent (0 if the socket would block), or -1 with errno
+ *   set on an error other than EAGAIN.
+ */
+long gob_outq_drain(struct gob_outq *q, int fd);
+
+/**
+ * Returns non-zero if nothing is waiting to be sent.
+ */
+int gob_outq_empty(const struct gob_outq *q);
+
+/**
+ * Returns non-zero while the queue is above its water marks and producers
+ * should hold back.
+ */
+int gob_outq_blocked(const struct gob_outq *q);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "outq.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+static int encode_counter(char *buf, size_t buf_size, int n) {
+  int total_bytes = 0;
+  total_bytes += gob_start_message(buf, buf_size, 65);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_int(buf+total_bytes, buf_size-total_bytes, n);
+  total_bytes += gob_end_struct(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+static ssize_t read_all(int fd, char *buf, size_t buf_size) {
+  ssize_t total = 0;
+  ssize_t n;
+  while (total < (ssize_t)buf_size && (n = read(fd, buf + total, buf_size - total)) > 0) {
+    total += n;
+  }
+  return total;
+}
+
+void test_gob_outq_backpressure() {
+  struct gob_outq q;
+  int fds[2];
+  int sndbuf = 4096;
+  char *space;
+  static char expected[1 << 20];
+  static char in[1 << 20];
+  size_t expected_len = 0;
+  size_t in_len = 0;
+  int n = 0;
+  long sent;
+
+  CU_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  CU_ASSERT_EQUAL(0, gob_outq_init(&q, 65536, 32768, 4096));
+
+  // produce until blocked, draining as an event loop would
+  while (!gob_outq_blocked(&q)) {
+    space = gob_outq_reserve(&q, 16);
+    CU_ASSERT_PTR_NOT_NULL(space);
+    int len = encode_counter(space, 16, n++);
+    memcpy(expected + expected_len, space, len);
+    expected_len += len;
+    gob_outq_commit(&q, len);
+    CU_ASSERT(gob_outq_drain(&q, fds[0]) >= 0);
+  }
+  // the socket is full, a message is partially sent
+  CU_ASSERT(!gob_outq_empty(&q));
+  CU_ASSERT_EQUAL(0, gob_outq_drain(&q, fds[0]));
+
+  // consume and drain until done
+  while (!gob_outq_empty(&q)) {
+    in_len += read_all(fds[1], in + in_len, sizeof(in) - in_len);
+    sent = gob_outq_drain(&q, fds[0]);
+    CU_ASSERT(sent >= 0);
+  }
+  CU_ASSERT(!gob_outq_blocked(&q));
+  in_len += read_all(fds[1], in + in_len, sizeof(in) - in_len);
+
+  CU_ASSERT_EQUAL(expected_len, in_len);
+  CU_ASSERT(memcmp(expected, in, expected_len) == 0);
+
+  gob_outq_destroy(&q);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void test_gob_outq_wrap() {
+  struct gob_outq q;
+  int fds[2];
+  char msg[16];
+  char in[256];
+  char expected[256];
+  size_t expected_len = 0;
+  int len;
+  int i;
+
+  CU_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  CU_ASSERT_EQUAL(0, gob_outq_init(&q, 40, 40, 0));
+
+  len = encode_counter(msg, sizeof(msg), 1000);
+  CU_ASSERT_EQUAL(8, len);
+
+  // five messages fill all 40 bytes
+  for (i = 0; i < 5; i++) {
+    CU_ASSERT_EQUAL(0, gob_outq_push(&q, msg, len));
+  }
+  CU_ASSERT_EQUAL(-1, gob_outq_push(&q, msg, len));
+
+  // pretend two messages went out, then the next one wraps around
+  q.head += 2*len;
+  q.queued -= 2*len;
+  CU_ASSERT_EQUAL(0, gob_outq_push(&q, msg, len));
+  CU_ASSERT_EQUAL(len, q.tail);
+  CU_ASSERT_EQUAL(40, q.wrap);
+  for (i = 0; i < 4; i++) {
+    memcpy(expected + expected_len, msg, len);
+    expected_len += len;
+  }
+
+  CU_ASSERT_EQUAL((long)expected_len, gob_outq_drain(&q, fds[0]));
+  CU_ASSERT(gob_outq_empty(&q));
+  CU_ASSERT_EQUAL(0, q.wrap);
+  CU_ASSERT_EQUAL((ssize_t)expected_len, read(fds[1], in, sizeof(in)));
+  CU_ASSERT(memcmp(expected, in, expected_len) == 0);
+
+  gob_outq_destroy(&q);
+  close(fds[0]);
+  close(fds[1]);
+}
@@ -0,0 +1,7 @@
+#ifndef _OUTQ_TEST_H
+#define _OUTQ_TEST_H
+
+void test_gob_outq_backpressure();
+void test_gob_outq_wrap();
+
+#endif
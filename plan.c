@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+
+#include "decode.h"
+#include "plan.h"
+
+int gob_decoder_init(struct gob_decoder *dec) {
+  memset(dec, 0, sizeof(struct gob_decoder));
+  return gob_types_init(&dec->types);
+}
+
+static void gob_plan_clear(struct gob_plan *plan) {
+  free(plan->steps);
+  memset(plan, 0, sizeof(struct gob_plan));
+}
+
+void gob_decoder_destroy(struct gob_decoder *dec) {
+  int i;
+  for (i = 0; i < dec->nplans; i++) {
+    gob_plan_clear(&dec->plans[i]);
+  }
+  free(dec->plans);
+  gob_types_destroy(&dec->types);
+  memset(dec, 0, sizeof(struct gob_decoder));
+}
+
+// Whether a field of kind can be decoded into a C field of type, and whether
+// without conversion.
+static int gob_plan_compatible(int kind, int type, int *native) {
+  switch (type) {
+  case GOB_LOCAL_INT:
+  case GOB_LOCAL_INT32:
+    *native = type == GOB_LOCAL_INT;
+    return kind == GOB_KIND_INT;
+  case GOB_LOCAL_UINT:
+  case GOB_LOCAL_UINT32:
+    *native = type == GOB_LOCAL_UINT;
+    return kind == GOB_KIND_UINT;
+  case GOB_LOCAL_BOOL:
+    *native = 1;
+    return kind == GOB_KIND_BOOL;
+  case GOB_LOCAL_DOUBLE:
+  case GOB_LOCAL_FLOAT:
+    *native = type == GOB_LOCAL_DOUBLE;
+    return kind == GOB_KIND_FLOAT;
+  case GOB_LOCAL_STRING:
+  case GOB_LOCAL_INTERN:
+    *native = type == GOB_LOCAL_STRING;
+    return kind == GOB_KIND_STRING || kind == GOB_KIND_BYTES;
+  }
+  return 0;
+}
+
+// Matches the fields of type id with those of local by name.
+static void gob_plan_compile(struct gob_decoder *dec, int id, const struct gob_local_struct *local,
+			     struct gob_plan *plan) {
+  const struct gob_type *t = gob_types_lookup(&dec->types, id);
+  const struct gob_type *ft;
+  int identical;
+  int matched = 0;
+  int native;
+  int i;
+  int j;
+
+  gob_plan_clear(plan);
+  plan->local = local;
+  plan->state = -1;
+  if (t == NULL || t->kind != GOB_KIND_STRUCT || t->nfields == 0) {
+    return;
+  }
+  plan->steps = calloc(t->nfields, sizeof(struct gob_plan_step));
+  if (plan->steps == NULL) {
+    return;
+  }
+  plan->nsteps = t->nfields;
+  identical = t->nfields == local->nfields;
+  for (j = 0; j < t->nfields; j++) {
+    plan->steps[j].id = t->fields[j].id;
+    for (i = 0; i < local->nfields && strcmp(local->fields[i].name, t->fields[j].name) != 0; i++) {
+    }
+    if (i == local->nfields) {
+      identical = 0;
+      continue;
+    }
+    ft = gob_types_lookup(&dec->types, t->fields[j].id);
+    if (!gob_plan_compatible(ft != NULL ? ft->kind : 0, local->fields[i].type, &native)) {
+      return;
+    }
+    plan->steps[j].type = local->fields[i].type;
+    plan->steps[j].offset = local->fields[i].offset;
+    identical = identical && i == j && native;
+    matched++;
+  }
+  // as Go, a struct without any field in common does not match
+  if (matched > 0) {
+    plan->state = identical ? 1 : 0;
+  }
+}
+
+int gob_local_compatible(int kind, int type) {
+  int native;
+  return gob_plan_compatible(kind, type, &native);
+}
+
+const struct gob_plan *gob_decoder_plan(struct gob_decoder *dec, int id, const struct gob_local_struct *local) {
+  struct gob_plan *grown;
+  int size;
+
+  if (id >= dec->nplans) {
+    size = dec->nplans * 2 > id ? dec->nplans * 2 : id + 1;
+    grown = realloc(dec->plans, size * sizeof(struct gob_plan));
+    if (grown == NULL) {
+      return NULL;
+    }
+    memset(grown + dec->nplans, 0, (size - dec->nplans) * sizeof(struct gob_plan));
+    dec->plans = grown;
+    dec->nplans = size;
+  }
+  if (dec->plans[id].local != local) {
+    gob_plan_compile(dec, id, local, &dec->plans[id]);
+  }
+  return &dec->plans[id];
+}
+
+static void gob_plan_zero(const struct gob_local_struct *local, char *out) {
+  const struct gob_local_field *f;
+  int i;
+
+  for (i = 0; i < local->nfields; i++) {
+    f = &local->fields[i];
+    switch (f->type) {
+    case GOB_LOCAL_INT:
+    case GOB_LOCAL_UINT:
+      memset(out + f->offset, 0, sizeof(long long));
+      break;
+    case GOB_LOCAL_DOUBLE:
+      *(double*)(out + f->offset) = 0;
+      break;
+    case GOB_LOCAL_FLOAT:
+      *(float*)(out + f->offset) = 0;
+      break;
+    case GOB_LOCAL_STRING:
+    case GOB_LOCAL_INTERN:
+      memset(out + f->offset, 0, sizeof(struct gob_string));
+      break;
+    default:
+      memset(out + f->offset, 0, sizeof(int));
+      break;
+    }
+  }
+}
+
+// Decodes a field value without conversion.
+static inline int gob_plan_native(const struct gob_plan_step *step, const char *buf, size_t buf_size,
+				  char *out) {
+  struct gob_string *s;
+  unsigned long long u;
+  int num_bytes;
+
+  switch (step->type) {
+  case GOB_LOCAL_INT:
+    return gob_decode_long_long(buf, buf_size, (long long*)(out + step->offset));
+  case GOB_LOCAL_UINT:
+    return gob_decode_unsigned_long_long(buf, buf_size, (unsigned long long*)(out + step->offset));
+  case GOB_LOCAL_BOOL:
+    num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &u);
+    *(int*)(out + step->offset) = u != 0;
+    return num_bytes;
+  case GOB_LOCAL_DOUBLE:
+    return gob_decode_double(buf, buf_size, (double*)(out + step->offset));
+  default:
+    s = (struct gob_string*)(out + step->offset);
+    return gob_decode_bytes(buf, buf_size, &s->data, &s->len);
+  }
+}
+
+// Decodes a field value, converting it to a narrower C type or interning it.
+static int gob_plan_convert(const struct gob_decoder *dec, const struct gob_plan_step *step,
+			    const char *buf, size_t buf_size, char *out) {
+  struct gob_string *s;
+  const char *copy;
+  unsigned long long u;
+  long long i;
+  double d;
+  int num_bytes;
+
+  switch (step->type) {
+  case GOB_LOCAL_INT32:
+    num_bytes = gob_decode_long_long(buf, buf_size, &i);
+    if (num_bytes < 0 || i < INT_MIN || i > INT_MAX) {
+      return -1;
+    }
+    *(int*)(out + step->offset) = (int)i;
+    return num_bytes;
+  case GOB_LOCAL_UINT32:
+    num_bytes = gob_decode_unsigned_long_long(buf, buf_size, &u);
+    if (num_bytes < 0 || u > UINT_MAX) {
+      return -1;
+    }
+    *(unsigned int*)(out + step->offset) = (unsigned int)u;
+    return num_bytes;
+  case GOB_LOCAL_FLOAT:
+    num_bytes = gob_decode_double(buf, buf_size, &d);
+    // infinities and NaN convert, finite values must fit
+    if (num_bytes < 0 || (d - d == 0 && (d > FLT_MAX || d < -FLT_MAX))) {
+      return -1;
+    }
+    *(float*)(out + step->offset) = (float)d;
+    return num_bytes;
+  case GOB_LOCAL_INTERN:
+    s = (struct gob_string*)(out + step->offset);
+    num_bytes = gob_decode_bytes(buf, buf_size, &s->data, &s->len);
+    if (num_bytes >= 0 && dec->intern != NULL &&
+	(copy = gob_intern_get(dec->intern, s->data, s->len)) != NULL) {
+      s->data = copy;
+    }
+    return num_bytes;
+  default:
+    return gob_plan_native(step, buf, buf_size, out);
+  }
+}
+
+// Decodes a struct value with the plan.  Returns the number of bytes
+// consumed, or -1 if the value is malformed or does not fit.
+static int gob_plan_decode(const struct gob_decoder *dec, const struct gob_plan *plan,
+			   const char *buf, size_t buf_size, char *out) {
+  const struct gob_plan_step *step;
+  unsigned long long delta;
+  size_t pos = 0;
+  int field = -1;
+  int num_bytes;
+
+  for (;;) {
+    num_bytes = gob_decode_unsigned_long_long(buf + pos, buf_size - pos, &delta);
+    if (num_bytes < 0 || delta > (unsigned long long)(plan->nsteps - 1 - field)) {
+      return -1;
+    }
+    pos += num_bytes;
+    if (delta == 0) {
+      return (int)pos;
+    }
+    field += (int)delta;
+    step = &plan->steps[field];
+    if (plan->state == 1) {
+      // every field is known, and of the C type
+      num_bytes = gob_plan_native(step, buf + pos, buf_size - pos, out);
+    } else if (step->type == 0) {
+      num_bytes = gob_skip_value(&dec->types, step->id, buf + pos, buf_size - pos);
+    } else {
+      num_bytes = gob_plan_convert(dec, step, buf + pos, buf_size - pos, out);
+    }
+    if (num_bytes < 0) {
+      return -1;
+    }
+    pos += num_bytes;
+  }
+}
+
+int gob_decoder_define(struct gob_decoder *dec, int id, const char *buf, size_t buf_size) {
+  int num_bytes = gob_types_define(&dec->types, id, buf, buf_size);
+  if (num_bytes >= 0 && id < dec->nplans) {
+    gob_plan_clear(&dec->plans[id]);
+  }
+  return num_bytes;
+}
+
+long gob_decoder_next(struct gob_decoder *dec, const char *buf, size_t buf_size,
+		      const struct gob_local_struct *local, void *out, int *id) {
+  const struct gob_plan *plan;
+  const char *body;
+  size_t body_len;
+  size_t pos = 0;
+  int msg_id;
+  int len;
+
+  *id = 0;
+  while ((len = gob_decode_message(buf + pos, buf_size - pos, &msg_id, &body, &body_len)) > 0) {
+    if (msg_id < 0) {
+      if (gob_decoder_define(dec, -msg_id, body, body_len) != (int)body_len) {
+	return -1;
+      }
+      pos += len;
+      continue;
+    }
+    plan = gob_decoder_plan(dec, msg_id, local);
+    if (plan == NULL || plan->state < 0) {
+      return -1;
+    }
+    gob_plan_zero(local, out);
+    if (gob_plan_decode(dec, plan, body, body_len, out) != (int)body_len) {
+      return -1;
+    }
+    *id = msg_id;
+    return pos + len;
+  }
+  return len < 0 ? -1 : (long)pos;
+}
+
+int gob_decoder_struct(const struct gob_decoder *dec, const struct gob_plan *plan,
+		       const char *buf, size_t buf_size, void *out) {
+  if (plan->state < 0) {
+    return -1;
+  }
+  gob_plan_zero(plan->local, out);
+  return gob_plan_decode(dec, plan, buf, buf_size, out);
+}
+
+int gob_decoder_value(const struct gob_decoder *dec, const char *buf, size_t buf_size, int type, void *out) {
+  struct gob_plan_step step;
+
+  step.type = type;
+  step.offset = 0;
+  step.id = 0;
+  return gob_plan_convert(dec, &step, buf, buf_size, out);
+}
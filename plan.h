@@ -0,0 +1,169 @@
+#ifndef _PLAN_H
+#define _PLAN_H
+
+#include <stddef.h>
+
+#include "decode.h"
+#include "intern.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Decoding of struct messages into C structs.
+ *
+ * As Go does, the fields of the sender's struct type are matched with those
+ * of the receiving struct by name.  The C struct is described field by field:
+ *
+ * \code
+ * struct tick { struct gob_string sym; double px; int qty; };
+ * static const struct gob_local_field tick_fields[] = {
+ *   { "Sym", GOB_LOCAL_STRING, offsetof(struct tick, sym) },
+ *   { "Px", GOB_LOCAL_DOUBLE, offsetof(struct tick, px) },
+ *   { "Qty", GOB_LOCAL_INT32, offsetof(struct tick, qty) },
+ * };
+ * static const struct gob_local_struct tick_struct = { tick_fields, 3 };
+ *
+ * while ((used = gob_decoder_next(&dec, buf, len, &tick_struct, &tick, &id)) > 0) {
+ *   if (id > 0) ...use tick...
+ * }
+ * \endcode
+ *
+ * The matching is done once per type id, the first time a message of the
+ * type is decoded, into a plan kept in an array indexed by type id.  A plan
+ * maps each field number of the message to the offset of the C field and
+ * the conversion to apply, or to skipping the field.  If the sender's fields
+ * are exactly the described ones, in the same order and without conversions,
+ * the plan decodes them in a straight line.
+ *
+ * Fields missing from a message are set to zero.  Strings and byte slices
+ * are not copied, they point into the message.  GOB_LOCAL_INTERN fields
+ * point to the string's copy in the decoder's intern table instead, if it
+ * has one, which stays valid after the message is gone; see intern.h.
+ * Should the table be full, they point into the message.
+ */
+
+#define GOB_LOCAL_INT    (1) // long long, from int
+#define GOB_LOCAL_INT32  (2) // int, from int
+#define GOB_LOCAL_UINT   (3) // unsigned long long, from uint
+#define GOB_LOCAL_UINT32 (4) // unsigned int, from uint
+#define GOB_LOCAL_BOOL   (5) // int, from bool
+#define GOB_LOCAL_DOUBLE (6) // double, from float
+#define GOB_LOCAL_FLOAT  (7) // float, from float
+#define GOB_LOCAL_STRING (8) // struct gob_string, from string and []byte
+#define GOB_LOCAL_INTERN (9) // struct gob_string, from string and []byte,
+                             // pointing into the decoder's intern table
+
+struct gob_string {
+  const char *data;
+  size_t len;
+};
+
+struct gob_local_field {
+  const char *name;
+  int type;                 // GOB_LOCAL_*
+  size_t offset;
+};
+
+struct gob_local_struct {
+  const struct gob_local_field *fields;
+  int nfields;
+};
+
+// What to do with one field of a message.
+struct gob_plan_step {
+  int type;                 // GOB_LOCAL_*, 0 to skip the field
+  size_t offset;
+  int id;                   // type id of the field
+};
+
+struct gob_plan {
+  const struct gob_local_struct *local; // NULL if not compiled
+  int state;                // 1 for a straight line, 0 with conversions, -1 incompatible
+  int nsteps;
+  struct gob_plan_step *steps; // by field number
+};
+
+struct gob_decoder {
+  struct gob_types types;
+  struct gob_plan *plans;   // by type id
+  int nplans;
+  struct gob_intern *intern; // for GOB_LOCAL_INTERN fields, NULL for none
+};
+
+/**
+ * Initializes a decoder.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_decoder_init(struct gob_decoder *dec);
+
+void gob_decoder_destroy(struct gob_decoder *dec);
+
+/**
+ * Decodes messages up to and including the next value message, which is
+ * decoded into out.  Type definitions in front of it are registered.
+ *
+ * @param local
+ *   The description of out.
+ * @param id
+ *   Receives the type id of the value, or 0 if buf only held definitions.
+ *
+ * @return
+ *   The number of bytes consumed, 0 if buf does not hold a complete message,
+ *   or -1 if the stream is malformed or the value's type does not match the
+ *   description, e.g. a field of the same name has an incompatible type or
+ *   an integer does not fit.
+ */
+long gob_decoder_next(struct gob_decoder *dec, const char *buf, size_t buf_size,
+		      const struct gob_local_struct *local, void *out, int *id);
+
+/**
+ * Registers a type definition as gob_types_define(), dropping the plan of an
+ * earlier definition of the id.
+ */
+int gob_decoder_define(struct gob_decoder *dec, int id, const char *buf, size_t buf_size);
+
+/**
+ * Returns the plan for decoding values of type id into local, compiling it
+ * if need be.  Its state is -1 if the type does not match.  The plan stays
+ * valid until the next call.
+ *
+ * @return
+ *   The plan, or NULL if memory ran out.
+ */
+const struct gob_plan *gob_decoder_plan(struct gob_decoder *dec, int id, const struct gob_local_struct *local);
+
+/**
+ * Decodes a struct value inside a message, e.g. a slice element, with a
+ * plan from gob_decoder_plan().
+ *
+ * @return
+ *   The number of bytes consumed, or -1 if buf does not hold a complete,
+ *   matching value.
+ */
+int gob_decoder_struct(const struct gob_decoder *dec, const struct gob_plan *plan,
+		       const char *buf, size_t buf_size, void *out);
+
+/**
+ * Decodes a value of a basic type into a C value of type GOB_LOCAL_*, which
+ * must be compatible with the value's type, see gob_local_compatible().
+ *
+ * @return
+ *   The number of bytes consumed, or -1 as gob_decoder_struct().
+ */
+int gob_decoder_value(const struct gob_decoder *dec, const char *buf, size_t buf_size, int type, void *out);
+
+/**
+ * Returns whether values of kind (GOB_KIND_*) decode into C values of type
+ * GOB_LOCAL_*.
+ */
+int gob_local_compatible(int kind, int type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,144 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "plan.h"
+#include "tick_fixture.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+
+struct tick {
+  struct gob_string sym;
+  double px;
+  long long qty;
+  unsigned long long seq;
+};
+
+static const struct gob_local_field sTickFields[] = {
+  { "Sym", GOB_LOCAL_STRING, offsetof(struct tick, sym) },
+  { "Px", GOB_LOCAL_DOUBLE, offsetof(struct tick, px) },
+  { "Qty", GOB_LOCAL_INT, offsetof(struct tick, qty) },
+  { "Seq", GOB_LOCAL_UINT, offsetof(struct tick, seq) },
+};
+static const struct gob_local_struct sTick = { sTickFields, 4 };
+
+void test_gob_decoder_identical() {
+  struct gob_decoder dec;
+  struct tick tick;
+  char buf[256];
+  size_t len;
+  int id;
+
+  len = encode_tick_type(buf, sizeof(buf), 65);
+  CU_ASSERT_EQUAL(0, gob_decoder_init(&dec));
+
+  // definitions alone, and an incomplete message
+  CU_ASSERT_EQUAL(len, gob_decoder_next(&dec, buf, len, &sTick, &tick, &id));
+  CU_ASSERT_EQUAL(0, id);
+  len = encode_tick(buf, sizeof(buf), 65, "GOOG", 101.5, -7, 3);
+  CU_ASSERT_EQUAL(0, gob_decoder_next(&dec, buf, len - 1, &sTick, &tick, &id));
+
+  CU_ASSERT_EQUAL(len, gob_decoder_next(&dec, buf, len, &sTick, &tick, &id));
+  CU_ASSERT_EQUAL(65, id);
+  CU_ASSERT_EQUAL(1, dec.plans[65].state);
+  CU_ASSERT(tick.sym.len == 4 && memcmp(tick.sym.data, "GOOG", 4) == 0);
+  CU_ASSERT_EQUAL(101.5, tick.px);
+  CU_ASSERT_EQUAL(-7, tick.qty);
+  CU_ASSERT_EQUAL(3, tick.seq);
+
+  // omitted fields are zeroed
+  len = encode_tick(buf, sizeof(buf), 65, "", 0, 5, 0);
+  CU_ASSERT_EQUAL(len, gob_decoder_next(&dec, buf, len, &sTick, &tick, &id));
+  CU_ASSERT(tick.sym.len == 0 && tick.px == 0 && tick.qty == 5 && tick.seq == 0);
+  gob_decoder_destroy(&dec);
+}
+
+struct small_tick {
+  int qty;
+  float px;
+  struct gob_string sym;
+  long long unused;
+};
+
+static const struct gob_local_field sSmallTickFields[] = {
+  { "Qty", GOB_LOCAL_INT32, offsetof(struct small_tick, qty) },
+  { "Px", GOB_LOCAL_FLOAT, offsetof(struct small_tick, px) },
+  { "Sym", GOB_LOCAL_STRING, offsetof(struct small_tick, sym) },
+  { "Unused", GOB_LOCAL_INT, offsetof(struct small_tick, unused) },
+};
+static const struct gob_local_struct sSmallTick = { sSmallTickFields, 4 };
+
+void test_gob_decoder_conversions() {
+  static char stream[8192];
+  struct gob_decoder dec;
+  struct small_tick tick;
+  size_t stream_len;
+  size_t pos = 0;
+  long used;
+  int errors = 0;
+  int id;
+  int i;
+
+  stream_len = encode_tick_type(stream, sizeof(stream), 65);
+  for (i = 0; i < 100; i++) {
+    stream_len += encode_tick(stream + stream_len, sizeof(stream) - stream_len, 65,
+			      i % 2 ? "IBM" : "", i * 0.25, i - 50, i);
+  }
+  CU_ASSERT_EQUAL(0, gob_decoder_init(&dec));
+  for (i = 0; i < 100; i++) {
+    tick.unused = 99;
+    used = gob_decoder_next(&dec, stream + pos, stream_len - pos, &sSmallTick, &tick, &id);
+    CU_ASSERT(used > 0);
+    if (used <= 0) {
+      break;
+    }
+    pos += used;
+    errors += id != 65 || tick.qty != i - 50 || tick.px != (float)(i * 0.25) || tick.unused != 0;
+    errors += tick.sym.len != (i % 2 ? 3 : 0);
+  }
+  CU_ASSERT_EQUAL(0, errors);
+  CU_ASSERT_EQUAL(stream_len, pos);
+  CU_ASSERT_EQUAL(0, dec.plans[65].state);
+  CU_ASSERT_EQUAL(0, dec.plans[65].steps[3].type);
+
+  // an int that does not fit into the C int
+  stream_len = encode_tick(stream, sizeof(stream), 65, "", 0, 1LL << 40, 0);
+  CU_ASSERT_EQUAL(-1, gob_decoder_next(&dec, stream, stream_len, &sSmallTick, &tick, &id));
+  gob_decoder_destroy(&dec);
+}
+
+void test_gob_decoder_mismatch() {
+  static const struct gob_local_field wrong_fields[] = {
+    { "Px", GOB_LOCAL_INT, 0 },
+  };
+  static const struct gob_local_struct wrong = { wrong_fields, 1 };
+  static const struct gob_local_field other_fields[] = {
+    { "Other", GOB_LOCAL_INT, 0 },
+  };
+  static const struct gob_local_struct other = { other_fields, 1 };
+  struct gob_decoder dec;
+  struct tick tick;
+  char buf[256];
+  size_t def_len;
+  size_t len;
+  int id;
+
+  def_len = encode_tick_type(buf, sizeof(buf), 65);
+  len = def_len + encode_tick(buf + def_len, sizeof(buf) - def_len, 65, "GOOG", 1, 2, 3);
+  CU_ASSERT_EQUAL(0, gob_decoder_init(&dec));
+  CU_ASSERT_EQUAL(-1, gob_decoder_next(&dec, buf, len, &wrong, &tick, &id));
+  gob_decoder_destroy(&dec);
+
+  CU_ASSERT_EQUAL(0, gob_decoder_init(&dec));
+  CU_ASSERT_EQUAL(-1, gob_decoder_next(&dec, buf, len, &other, &tick, &id));
+
+  // another description of the target recompiles the plan
+  CU_ASSERT_EQUAL(def_len, gob_decoder_next(&dec, buf, def_len, &sTick, &tick, &id));
+  CU_ASSERT_EQUAL(len - def_len, gob_decoder_next(&dec, buf + def_len, len - def_len, &sTick, &tick, &id));
+  CU_ASSERT_EQUAL(65, id);
+  CU_ASSERT_EQUAL(3, tick.seq);
+  gob_decoder_destroy(&dec);
+}
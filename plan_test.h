@@ -0,0 +1,8 @@
+#ifndef _PLAN_TEST_H
+#define _PLAN_TEST_H
+
+void test_gob_decoder_identical();
+void test_gob_decoder_conversions();
+void test_gob_decoder_mismatch();
+
+#endif
@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "pool.h"
+#include "trace.h"
+
+// Header in front of every buffer.
+struct gob_pool_buffer {
+  unsigned int next;      // free list successor (index + 1), 0 at the end
+  unsigned int index;
+  int cls;                // -1 for buffers not kept by the pool
+  size_t size;
+};
+
+#define GOB_POOL_INDEX_MASK (0xffffffffULL)
+
+static char *gob_pool_data(struct gob_pool_buffer *b) {
+  return (char*)(b + 1);
+}
+
+static struct gob_pool_buffer *gob_pool_header(const char *buf) {
+  return (struct gob_pool_buffer*)buf - 1;
+}
+
+static int gob_pool_class_of(size_t size) {
+  int cls = 0;
+  while (cls < GOB_POOL_CLASSES && ((size_t)GOB_POOL_MIN_SIZE << cls) < size) {
+    cls++;
+  }
+  return cls < GOB_POOL_CLASSES ? cls : -1;
+}
+
+// Lock-free stack push.  The generation in the upper half of head changes
+// with every push and pop, so a head that was popped and pushed again in
+// between does not fool the compare-and-swap.
+static void gob_pool_push(struct gob_pool_class *c, struct gob_pool_buffer *b) {
+  unsigned long long head = __atomic_load_n(&c->head, __ATOMIC_RELAXED);
+  unsigned long long next;
+  do {
+    __atomic_store_n(&b->next, (unsigned int)(head & GOB_POOL_INDEX_MASK), __ATOMIC_RELAXED);
+    next = (((head >> 32) + 1) << 32) | (b->index + 1);
+  } while (!__atomic_compare_exchange_n(&c->head, &head, next, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static struct gob_pool_buffer *gob_pool_pop(struct gob_pool_class *c) {
+  unsigned long long head = __atomic_load_n(&c->head, __ATOMIC_ACQUIRE);
+  unsigned long long next;
+  struct gob_pool_buffer *b;
+  do {
+    if ((head & GOB_POOL_INDEX_MASK) == 0) {
+      return NULL;
+    }
+    // buffers are never freed while the pool lives, so reading a stale
+    // successor is harmless; the compare-and-swap fails then
+    b = c->buffers[(head & GOB_POOL_INDEX_MASK) - 1];
+    next = (((head >> 32) + 1) << 32) | __atomic_load_n(&b->next, __ATOMIC_RELAXED);
+  } while (!__atomic_compare_exchange_n(&c->head, &head, next, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+  return b;
+}
+
+static struct gob_pool_buffer *gob_pool_new(struct gob_pool *pool, int cls, size_t size) {
+  struct gob_pool_class *c = NULL;
+  struct gob_pool_buffer *b;
+  unsigned int index = 0;
+
+  if (cls >= 0) {
+    c = &pool->classes[cls];
+    size = (size_t)GOB_POOL_MIN_SIZE << cls;
+    index = __atomic_fetch_add(&c->allocated, 1, __ATOMIC_RELAXED);
+    if (index >= c->max) {
+      __atomic_fetch_sub(&c->allocated, 1, __ATOMIC_RELAXED);
+      cls = -1;
+    }
+  }
+  b = malloc(sizeof(struct gob_pool_buffer) + size);
+  if (b == NULL) {
+    if (cls >= 0) {
+      // the slot stays unused
+      c->buffers[index] = NULL;
+    }
+    return NULL;
+  }
+  b->next = 0;
+  b->index = index;
+  b->cls = cls;
+  b->size = size;
+  if (cls >= 0) {
+    c->buffers[index] = b;
+  }
+  return b;
+}
+
+int gob_pool_init(struct gob_pool *pool, unsigned int max_buffers) {
+  int i;
+
+  memset(pool, 0, sizeof(struct gob_pool));
+  for (i = 0; i < GOB_POOL_CLASSES; i++) {
+    pool->classes[i].max = max_buffers;
+    pool->classes[i].buffers = calloc(max_buffers ? max_buffers : 1, sizeof(struct gob_pool_buffer*));
+    if (pool->classes[i].buffers == NULL) {
+      gob_pool_destroy(pool);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void gob_pool_destroy(struct gob_pool *pool) {
+  unsigned int j;
+  int i;
+
+  for (i = 0; i < GOB_POOL_CLASSES; i++) {
+    if (pool->classes[i].buffers != NULL) {
+      for (j = 0; j < pool->classes[i].allocated; j++) {
+	free(pool->classes[i].buffers[j]);
+      }
+      free(pool->classes[i].buffers);
+    }
+  }
+  memset(pool, 0, sizeof(struct gob_pool));
+}
+
+void gob_pool_cache_init(struct gob_pool_cache *cache, struct gob_pool *pool) {
+  memset(cache, 0, sizeof(struct gob_pool_cache));
+  cache->pool = pool;
+}
+
+void gob_pool_cache_flush(struct gob_pool_cache *cache) {
+  int i;
+
+  for (i = 0; i < GOB_POOL_CLASSES; i++) {
+    while (cache->count[i] > 0) {
+      gob_pool_push(&cache->pool->classes[i], cache->buffers[i][--cache->count[i]]);
+    }
+  }
+}
+
+char *gob_pool_acquire(struct gob_pool_cache *cache, size_t size) {
+  int cls = gob_pool_class_of(size);
+  struct gob_pool_buffer *b;
+
+  if (cls >= 0) {
+    if (cache->count[cls] == 0) {
+      // refill half the cache at once
+      while (cache->count[cls] < GOB_POOL_CACHE_SIZE/2 &&
+	     (b = gob_pool_pop(&cache->pool->classes[cls])) != NULL) {
+	cache->buffers[cls][cache->count[cls]++] = b;
+      }
+    }
+    if (cache->count[cls] > 0) {
+      return gob_pool_data(cache->buffers[cls][--cache->count[cls]]);
+    }
+  }
+  b = gob_pool_new(cache->pool, cls, size);
+  return b != NULL ? gob_pool_data(b) : NULL;
+}
+
+void gob_pool_release(struct gob_pool_cache *cache, char *buf) {
+  struct gob_pool_buffer *b = gob_pool_header(buf);
+  int cls = b->cls;
+
+  if (cls < 0) {
+    free(b);
+    return;
+  }
+  if (cache->count[cls] == GOB_POOL_CACHE_SIZE) {
+    // spill half the cache
+    while (cache->count[cls] > GOB_POOL_CACHE_SIZE/2) {
+      gob_pool_push(&cache->pool->classes[cls], cache->buffers[cls][--cache->count[cls]]);
+    }
+  }
+  cache->buffers[cls][cache->count[cls]++] = b;
+}
+
+size_t gob_pool_capacity(const char *buf) {
+  return gob_pool_header(buf)->size;
+}
+
+char *gob_pool_grow(struct gob_pool_cache *cache, char *buf, size_t len, size_t size) {
+  size_t old_size = gob_pool_capacity(buf);
+  char *grown;
+
+  if (size <= old_size) {
+    return buf;
+  }
+  grown = gob_pool_acquire(cache, size);
+  if (grown == NULL) {
+    return NULL;
+  }
+  GOB_TRACE_BUFFER_GROW(old_size, gob_pool_capacity(grown));
+  memcpy(grown, buf, len < old_size ? len : old_size);
+  gob_pool_release(cache, buf);
+  return grown;
+}
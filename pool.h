@@ -0,0 +1,134 @@
+#ifndef _POOL_H
+#define _POOL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Recyclable encode buffers.
+ *
+ * A gob_pool hands out buffers in a few size classes.  A buffer may be
+ * acquired on one thread, filled with gob_* encoders and released by another
+ * thread once it has been sent:
+ *
+ * \code
+ * // encoding thread
+ * char *buf = gob_pool_acquire(&cache, 256);
+ * int len = encode_message(buf, gob_pool_capacity(buf), ...);
+ * if (len > gob_pool_capacity(buf)) {
+ *   buf = gob_pool_grow(&cache, buf, 0, len);
+ *   len = encode_message(buf, gob_pool_capacity(buf), ...);
+ * }
+ * ...hand buf and len to the I/O thread...
+ *
+ * // I/O thread
+ * gob_writer_write(&writer, buf, len);
+ * gob_pool_release(&io_cache, buf);
+ * \endcode
+ *
+ * Every thread uses its own gob_pool_cache, which keeps a few buffers of each
+ * class without any synchronization.  An empty cache refills from, and a
+ * full cache spills half of its buffers to, the pool's lock-free free lists.
+ * Once enough buffers circulate, acquiring and releasing allocates nothing.
+ */
+
+/**
+ * The number of size classes.  Class k holds buffers of GOB_POOL_MIN_SIZE << k
+ * bytes; larger requests are served by malloc() and freed on release.
+ */
+#define GOB_POOL_CLASSES (8)
+
+/**
+ * The size of the smallest class.
+ */
+#define GOB_POOL_MIN_SIZE (256)
+
+/**
+ * The number of buffers per class a gob_pool_cache holds.
+ */
+#define GOB_POOL_CACHE_SIZE (16)
+
+struct gob_pool_buffer;
+
+struct gob_pool_class {
+  // free list: generation in the upper, buffer index + 1 in the lower 32 bits
+  unsigned long long head __attribute__((aligned(64)));
+  unsigned int allocated;             // buffers created so far
+  unsigned int max;                   // buffers kept at most
+  struct gob_pool_buffer **buffers;   // by index
+};
+
+struct gob_pool {
+  struct gob_pool_class classes[GOB_POOL_CLASSES];
+};
+
+struct gob_pool_cache {
+  struct gob_pool *pool;
+  int count[GOB_POOL_CLASSES];
+  struct gob_pool_buffer *buffers[GOB_POOL_CLASSES][GOB_POOL_CACHE_SIZE];
+};
+
+/**
+ * Initializes a pool.
+ *
+ * @param max_buffers
+ *   The number of buffers of each class the pool keeps.  Buffers acquired
+ *   beyond that are freed when released.
+ *
+ * @return
+ *   0 on success, -1 with errno set if the pool could not be allocated.
+ */
+int gob_pool_init(struct gob_pool *pool, unsigned int max_buffers);
+
+/**
+ * Frees all buffers of the pool.  No buffer may be in use and all caches must
+ * have been flushed.
+ */
+void gob_pool_destroy(struct gob_pool *pool);
+
+/**
+ * Initializes the calling thread's cache.
+ */
+void gob_pool_cache_init(struct gob_pool_cache *cache, struct gob_pool *pool);
+
+/**
+ * Returns all buffers held by the cache to the pool, e.g. before the thread
+ * exits.
+ */
+void gob_pool_cache_flush(struct gob_pool_cache *cache);
+
+/**
+ * Acquires a buffer of at least size bytes.
+ *
+ * @return
+ *   The buffer, or NULL with errno set if memory ran out.
+ */
+char *gob_pool_acquire(struct gob_pool_cache *cache, size_t size);
+
+/**
+ * Releases a buffer acquired from any cache of the same pool.
+ */
+void gob_pool_release(struct gob_pool_cache *cache, char *buf);
+
+/**
+ * Returns the usable size of a buffer, at least the size it was acquired with.
+ */
+size_t gob_pool_capacity(const char *buf);
+
+/**
+ * Replaces a buffer with one of at least size bytes, copying the first len
+ * bytes over, and releases the old one.
+ *
+ * @return
+ *   The new buffer, or NULL with errno set (the old buffer is kept then).
+ */
+char *gob_pool_grow(struct gob_pool_cache *cache, char *buf, size_t len, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
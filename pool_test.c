@@ -0,0 +1,169 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "pool.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+void test_gob_pool_reuse() {
+  struct gob_pool pool;
+  struct gob_pool_cache producer;
+  struct gob_pool_cache consumer;
+  char *bufs[64];
+  char *again[64];
+  int i;
+  int j;
+  int found;
+
+  CU_ASSERT_EQUAL(0, gob_pool_init(&pool, 64));
+  gob_pool_cache_init(&producer, &pool);
+  gob_pool_cache_init(&consumer, &pool);
+
+  bufs[0] = gob_pool_acquire(&producer, 1);
+  CU_ASSERT_EQUAL(GOB_POOL_MIN_SIZE, gob_pool_capacity(bufs[0]));
+  gob_pool_release(&producer, bufs[0]);
+  CU_ASSERT_PTR_EQUAL(bufs[0], gob_pool_acquire(&producer, GOB_POOL_MIN_SIZE));
+  gob_pool_release(&producer, bufs[0]);
+
+  // acquired by one cache, released to the other
+  for (i = 0; i < 64; i++) {
+    bufs[i] = gob_pool_acquire(&producer, 1000);
+    CU_ASSERT_EQUAL(1024, gob_pool_capacity(bufs[i]));
+  }
+  CU_ASSERT_EQUAL(64, pool.classes[2].allocated);
+  for (i = 0; i < 64; i++) {
+    gob_pool_release(&consumer, bufs[i]);
+  }
+
+  // the spilled buffers come back without allocating
+  gob_pool_cache_flush(&consumer);
+  for (i = 0; i < 64; i++) {
+    again[i] = gob_pool_acquire(&producer, 1000);
+    found = 0;
+    for (j = 0; j < 64; j++) {
+      found += again[i] == bufs[j];
+    }
+    CU_ASSERT_EQUAL(1, found);
+  }
+  CU_ASSERT_EQUAL(64, pool.classes[2].allocated);
+
+  // beyond the limit buffers are allocated and freed on release
+  bufs[0] = gob_pool_acquire(&producer, 1000);
+  CU_ASSERT_PTR_NOT_NULL(bufs[0]);
+  CU_ASSERT_EQUAL(64, pool.classes[2].allocated);
+  gob_pool_release(&consumer, bufs[0]);
+  bufs[0] = gob_pool_acquire(&producer, (size_t)GOB_POOL_MIN_SIZE << GOB_POOL_CLASSES);
+  CU_ASSERT_EQUAL((size_t)GOB_POOL_MIN_SIZE << GOB_POOL_CLASSES, gob_pool_capacity(bufs[0]));
+  gob_pool_release(&consumer, bufs[0]);
+
+  for (i = 0; i < 64; i++) {
+    gob_pool_release(&consumer, again[i]);
+  }
+  gob_pool_cache_flush(&producer);
+  gob_pool_cache_flush(&consumer);
+  gob_pool_destroy(&pool);
+}
+
+// Encodes a message of n strings, counting the bytes beyond buf_size.
+static int encode_strings(char *buf, size_t buf_size, int n) {
+  int total_bytes = 0;
+  int i;
+  total_bytes += gob_start_message(buf, buf_size, 65);
+  total_bytes += gob_start_slice(buf+total_bytes, buf_size-total_bytes, n);
+  for (i = 0; i < n; i++) {
+    if ((size_t)total_bytes < buf_size) {
+      total_bytes += gob_encode_string(buf+total_bytes, buf_size-total_bytes, "0123456789");
+    } else {
+      total_bytes += gob_encode_string(buf, 0, "0123456789");
+    }
+  }
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+void test_gob_pool_grow() {
+  struct gob_pool pool;
+  struct gob_pool_cache cache;
+  char expected[2048];
+  char *buf;
+  int len;
+
+  CU_ASSERT_EQUAL(0, gob_pool_init(&pool, 4));
+  gob_pool_cache_init(&cache, &pool);
+
+  len = encode_strings(expected, sizeof(expected), 100);
+  CU_ASSERT(len > 1024 && len <= 2048);
+
+  buf = gob_pool_acquire(&cache, 256);
+  len = encode_strings(buf, gob_pool_capacity(buf), 100);
+  CU_ASSERT(len > (int)gob_pool_capacity(buf));
+  memcpy(buf, "keep", 4);
+  buf = gob_pool_grow(&cache, buf, 4, len);
+  CU_ASSERT_EQUAL(2048, gob_pool_capacity(buf));
+  CU_ASSERT(memcmp(buf, "keep", 4) == 0);
+  CU_ASSERT_EQUAL(len, encode_strings(buf, gob_pool_capacity(buf), 100));
+  CU_ASSERT(memcmp(expected, buf, len) == 0);
+  gob_pool_release(&cache, buf);
+
+  gob_pool_cache_flush(&cache);
+  gob_pool_destroy(&pool);
+}
+
+#define POOL_THREADS (4)
+#define POOL_ROUNDS (20000)
+
+struct pool_worker {
+  struct gob_pool *pool;
+  int index;
+  int errors;
+};
+
+static void *pool_work(void *arg) {
+  struct pool_worker *w = arg;
+  struct gob_pool_cache cache;
+  char *held[GOB_POOL_CACHE_SIZE * 2];
+  int i;
+  int j;
+  int n;
+
+  gob_pool_cache_init(&cache, w->pool);
+  for (i = 0; i < POOL_ROUNDS; i++) {
+    // hold a varying number of buffers so caches spill and refill
+    n = 1 + (i * 7 + w->index) % (GOB_POOL_CACHE_SIZE * 2);
+    for (j = 0; j < n; j++) {
+      held[j] = gob_pool_acquire(&cache, 300);
+      memset(held[j], w->index, 300);
+    }
+    for (j = 0; j < n; j++) {
+      w->errors += held[j][0] != w->index || held[j][299] != w->index;
+      gob_pool_release(&cache, held[j]);
+    }
+  }
+  gob_pool_cache_flush(&cache);
+  return NULL;
+}
+
+void test_gob_pool_threads() {
+  struct gob_pool pool;
+  struct pool_worker workers[POOL_THREADS];
+  pthread_t threads[POOL_THREADS];
+  int i;
+
+  CU_ASSERT_EQUAL(0, gob_pool_init(&pool, 1024));
+  for (i = 0; i < POOL_THREADS; i++) {
+    workers[i].pool = &pool;
+    workers[i].index = i;
+    workers[i].errors = 0;
+    pthread_create(&threads[i], NULL, pool_work, &workers[i]);
+  }
+  for (i = 0; i < POOL_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    CU_ASSERT_EQUAL(0, workers[i].errors);
+  }
+  // every buffer went back to the free list
+  CU_ASSERT(pool.classes[1].allocated <= POOL_THREADS * GOB_POOL_CACHE_SIZE * 3);
+  gob_pool_destroy(&pool);
+}
@@ -0,0 +1,8 @@
+#ifndef _POOL_TEST_H
+#define _POOL_TEST_H
+
+void test_gob_pool_reuse();
+void test_gob_pool_grow();
+void test_gob_pool_threads();
+
+#endif
@@ -0,0 +1,335 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "encode.h"
+#include "decode.h"
+#include "scan.h"
+
+// The encoding of every zero value, which omitted fields are compared with.
+static const char sZero[1] = { 0 };
+
+int gob_scan_init(struct gob_scan *scan) {
+  memset(scan, 0, sizeof(struct gob_scan));
+  return gob_types_init(&scan->types);
+}
+
+static void gob_scan_plan_clear(struct gob_scan_plan *plan) {
+  int i;
+  for (i = 0; i < plan->nsteps; i++) {
+    free(plan->steps[i].encoded);
+  }
+  memset(plan, 0, sizeof(struct gob_scan_plan));
+}
+
+void gob_scan_destroy(struct gob_scan *scan) {
+  int i;
+  for (i = 0; i < scan->nplans; i++) {
+    gob_scan_plan_clear(&scan->plans[i]);
+  }
+  free(scan->plans);
+  gob_types_destroy(&scan->types);
+  memset(scan, 0, sizeof(struct gob_scan));
+}
+
+int gob_scan_type(struct gob_scan *scan, int id) {
+  if (scan->ntypes == GOB_SCAN_MAX_TYPES) {
+    return -1;
+  }
+  scan->type_ids[scan->ntypes++] = id;
+  return 0;
+}
+
+static struct gob_scan_cond *gob_scan_add(struct gob_scan *scan, const char *name, int kind) {
+  struct gob_scan_cond *cond;
+  int i;
+
+  if (scan->ncond == GOB_SCAN_MAX_CONDS) {
+    return NULL;
+  }
+  // plans compiled so far lack the new condition
+  for (i = 0; i < scan->nplans; i++) {
+    gob_scan_plan_clear(&scan->plans[i]);
+  }
+  cond = &scan->conds[scan->ncond++];
+  memset(cond, 0, sizeof(struct gob_scan_cond));
+  cond->name = name;
+  cond->kind = kind;
+  return cond;
+}
+
+int gob_scan_int(struct gob_scan *scan, const char *name, long long lo, long long hi) {
+  struct gob_scan_cond *cond = gob_scan_add(scan, name, GOB_KIND_INT);
+  if (cond == NULL) {
+    return -1;
+  }
+  cond->int_lo = lo;
+  cond->int_hi = hi;
+  return 0;
+}
+
+int gob_scan_uint(struct gob_scan *scan, const char *name, unsigned long long lo, unsigned long long hi) {
+  struct gob_scan_cond *cond = gob_scan_add(scan, name, GOB_KIND_UINT);
+  if (cond == NULL) {
+    return -1;
+  }
+  cond->uint_lo = lo;
+  cond->uint_hi = hi;
+  return 0;
+}
+
+int gob_scan_double(struct gob_scan *scan, const char *name, double lo, double hi) {
+  struct gob_scan_cond *cond = gob_scan_add(scan, name, GOB_KIND_FLOAT);
+  if (cond == NULL) {
+    return -1;
+  }
+  cond->float_lo = lo;
+  cond->float_hi = hi;
+  return 0;
+}
+
+int gob_scan_string(struct gob_scan *scan, const char *name, const char *lo, const char *hi) {
+  struct gob_scan_cond *cond = gob_scan_add(scan, name, GOB_KIND_STRING);
+  if (cond == NULL) {
+    return -1;
+  }
+  cond->string_lo = lo;
+  cond->string_hi = hi;
+  return 0;
+}
+
+// Pre-encodes the value an equality condition compares with.
+static int gob_scan_encode(struct gob_scan_step *step, const struct gob_scan_cond *cond) {
+  size_t size = sizeof(unsigned long long) + 1;
+
+  if (cond->kind == GOB_KIND_STRING) {
+    if (cond->string_hi != NULL) {
+      return 0;
+    }
+    size += strlen(cond->string_lo);
+  } else if (cond->kind == GOB_KIND_INT ? cond->int_lo != cond->int_hi :
+	     cond->kind == GOB_KIND_UINT ? cond->uint_lo != cond->uint_hi : 1) {
+    // ranges, and floats since -0 == 0 but their encodings differ
+    return 0;
+  }
+  step->encoded = malloc(size);
+  if (step->encoded == NULL) {
+    return -1;
+  }
+  switch (cond->kind) {
+  case GOB_KIND_INT:
+    step->encoded_len = gob_encode_long_long(step->encoded, size, cond->int_lo);
+    break;
+  case GOB_KIND_UINT:
+    step->encoded_len = gob_encode_unsigned_long_long(step->encoded, size, cond->uint_lo);
+    break;
+  default:
+    step->encoded_len = gob_encode_string(step->encoded, size, cond->string_lo);
+    break;
+  }
+  return 0;
+}
+
+static int gob_scan_by_field(const void *a, const void *b) {
+  const struct gob_scan_step *x = a;
+  const struct gob_scan_step *y = b;
+  return x->field != y->field ? x->field - y->field : x->cond - y->cond;
+}
+
+// Resolves the conditions against the definition of type id.
+static void gob_scan_compile(struct gob_scan *scan, int id, struct gob_scan_plan *plan) {
+  const struct gob_type *t = gob_types_lookup(&scan->types, id);
+  const struct gob_type *ft;
+  struct gob_scan_step *step;
+  int kind;
+  int i;
+  int j;
+
+  plan->state = -1;
+  if (scan->ntypes > 0) {
+    for (i = 0; i < scan->ntypes && scan->type_ids[i] != id; i++) {
+    }
+    if (i == scan->ntypes) {
+      return;
+    }
+  }
+  if (scan->ncond > 0 && (t == NULL || t->kind != GOB_KIND_STRUCT)) {
+    return;
+  }
+  for (i = 0; i < scan->ncond; i++) {
+    for (j = 0; j < t->nfields && strcmp(t->fields[j].name, scan->conds[i].name) != 0; j++) {
+    }
+    if (j == t->nfields) {
+      return;
+    }
+    ft = gob_types_lookup(&scan->types, t->fields[j].id);
+    kind = ft != NULL ? ft->kind : 0;
+    if (kind == GOB_KIND_BOOL) {
+      kind = GOB_KIND_UINT;
+    } else if (kind == GOB_KIND_BYTES) {
+      kind = GOB_KIND_STRING;
+    }
+    if (kind != scan->conds[i].kind) {
+      return;
+    }
+    step = &plan->steps[plan->nsteps++];
+    step->field = j;
+    step->cond = i;
+    if (gob_scan_encode(step, &scan->conds[i]) < 0) {
+      return;
+    }
+  }
+  qsort(plan->steps, plan->nsteps, sizeof(struct gob_scan_step), gob_scan_by_field);
+  plan->state = 1;
+}
+
+static struct gob_scan_plan *gob_scan_plan(struct gob_scan *scan, int id) {
+  struct gob_scan_plan *grown;
+  int size;
+
+  if (id >= scan->nplans) {
+    size = scan->nplans * 2 > id ? scan->nplans * 2 : id + 1;
+    grown = realloc(scan->plans, size * sizeof(struct gob_scan_plan));
+    if (grown == NULL) {
+      return NULL;
+    }
+    memset(grown + scan->nplans, 0, (size - scan->nplans) * sizeof(struct gob_scan_plan));
+    scan->plans = grown;
+    scan->nplans = size;
+  }
+  if (scan->plans[id].state == 0) {
+    gob_scan_compile(scan, id, &scan->plans[id]);
+  }
+  return &scan->plans[id];
+}
+
+static int gob_scan_compare_bytes(const char *a, size_t a_len, const char *b) {
+  size_t b_len = strlen(b);
+  int c = memcmp(a, b, a_len < b_len ? a_len : b_len);
+  return c != 0 ? c : a_len < b_len ? -1 : a_len > b_len;
+}
+
+// Checks a condition against an encoded value.  Returns 1 if it holds, 0 if
+// not and -1 if the value is malformed.
+static int gob_scan_check(const struct gob_scan_step *step, const struct gob_scan_cond *cond,
+			  const char *buf, size_t buf_size) {
+  unsigned long long u;
+  long long i;
+  double d;
+  const char *data;
+  size_t len;
+
+  if (step->encoded != NULL) {
+    return step->encoded_len <= buf_size && memcmp(buf, step->encoded, step->encoded_len) == 0;
+  }
+  switch (cond->kind) {
+  case GOB_KIND_INT:
+    if (gob_decode_long_long(buf, buf_size, &i) < 0) {
+      return -1;
+    }
+    return cond->int_lo <= i && i <= cond->int_hi;
+  case GOB_KIND_UINT:
+    if (gob_decode_unsigned_long_long(buf, buf_size, &u) < 0) {
+      return -1;
+    }
+    return cond->uint_lo <= u && u <= cond->uint_hi;
+  case GOB_KIND_FLOAT:
+    if (gob_decode_double(buf, buf_size, &d) < 0) {
+      return -1;
+    }
+    return cond->float_lo <= d && d <= cond->float_hi;
+  default:
+    if (gob_decode_bytes(buf, buf_size, &data, &len) < 0) {
+      return -1;
+    }
+    return gob_scan_compare_bytes(data, len, cond->string_lo) >= 0 &&
+      gob_scan_compare_bytes(data, len, cond->string_hi) <= 0;
+  }
+}
+
+// Matches a struct value against a plan.  Returns 1 on a match, 0 if not and
+// -1 if the value is malformed.
+static int gob_scan_match_struct(struct gob_scan *scan, const struct gob_type *t,
+				 const struct gob_scan_plan *plan, const char *buf, size_t buf_size) {
+  const struct gob_scan_step *step = plan->steps;
+  const struct gob_scan_step *end = plan->steps + plan->nsteps;
+  unsigned long long delta;
+  size_t pos = 0;
+  int field = -1;
+  int num_bytes;
+  int ok;
+
+  while (step < end) {
+    num_bytes = gob_decode_unsigned_long_long(buf + pos, buf_size - pos, &delta);
+    if (num_bytes < 0 || delta > (unsigned long long)(t->nfields - 1 - field)) {
+      return -1;
+    }
+    pos += num_bytes;
+    field = delta == 0 ? t->nfields : field + (int)delta;
+    // conditions on omitted fields see the zero value
+    for (; step < end && step->field < field; step++) {
+      if (gob_scan_check(step, &scan->conds[step->cond], sZero, sizeof(sZero)) != 1) {
+	return 0;
+      }
+    }
+    if (step == end || field == t->nfields) {
+      break;
+    }
+    for (; step < end && step->field == field; step++) {
+      ok = gob_scan_check(step, &scan->conds[step->cond], buf + pos, buf_size - pos);
+      if (ok != 1) {
+	return ok;
+      }
+    }
+    if (step < end) {
+      num_bytes = gob_skip_value(&scan->types, t->fields[field].id, buf + pos, buf_size - pos);
+      if (num_bytes < 0) {
+	return -1;
+      }
+      pos += num_bytes;
+    }
+  }
+  return 1;
+}
+
+long gob_scan_buffer(struct gob_scan *scan, const char *buf, size_t buf_size,
+		     gob_scan_match match, void *ctx) {
+  const struct gob_scan_plan *plan;
+  const char *body;
+  size_t body_len;
+  size_t pos = 0;
+  int len;
+  int id;
+  int ok;
+
+  while ((len = gob_decode_message(buf + pos, buf_size - pos, &id, &body, &body_len)) > 0) {
+    if (id < 0) {
+      if (gob_types_define(&scan->types, -id, body, body_len) != (int)body_len) {
+	return -1;
+      }
+      if (-id < scan->nplans) {
+	gob_scan_plan_clear(&scan->plans[-id]);
+      }
+    } else {
+      scan->messages++;
+      plan = gob_scan_plan(scan, id);
+      if (plan == NULL) {
+	return -1;
+      }
+      ok = plan->state;
+      if (ok == 1 && plan->nsteps > 0) {
+	ok = gob_scan_match_struct(scan, gob_types_lookup(&scan->types, id), plan, body, body_len);
+	if (ok < 0) {
+	  return -1;
+	}
+      }
+      if (ok == 1) {
+	scan->matches++;
+	if (match(ctx, id, buf + pos, len, body, body_len) != 0) {
+	  return pos + len;
+	}
+      }
+    }
+    pos += len;
+  }
+  return len < 0 ? -1 : (long)pos;
+}
@@ -0,0 +1,156 @@
+#ifndef _SCAN_H
+#define _SCAN_H
+
+#include <stddef.h>
+
+#include "decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Filtering scans over gob streams.
+ *
+ * A gob_scan holds a few conditions on top-level struct fields (all of which
+ * must hold) and optionally a set of type ids.  gob_scan_buffer() walks the
+ * messages of a stream and passes only the matching value messages on,
+ * undecoded:
+ *
+ * \code
+ * gob_scan_init(&scan);
+ * gob_scan_string(&scan, "Sym", "sym", NULL);
+ * gob_scan_int(&scan, "Qty", 100, LLONG_MAX);
+ * while (...more input...) {
+ *   used = gob_scan_buffer(&scan, buf, len, print_tick, NULL);
+ *   ...keep the len - used bytes of the incomplete message...
+ * }
+ * \endcode
+ *
+ * Conditions name fields, which are resolved against the type definitions
+ * found in the stream once per type.  Equality conditions on integers and
+ * strings are compared with the encoded bytes of the message directly, since
+ * gob's encodings of these are prefix-free; ranges decode the field.  Fields
+ * before a conditioned field are skipped by their encoded sizes, and the rest
+ * of a message is not looked at once all conditions have been decided.  A
+ * field omitted from a message has the zero value.
+ */
+
+/**
+ * The maximum number of conditions and type ids of a scan.
+ */
+#define GOB_SCAN_MAX_CONDS (16)
+#define GOB_SCAN_MAX_TYPES (16)
+
+struct gob_scan_cond {
+  const char *name;
+  int kind;                 // GOB_KIND_INT, _UINT, _FLOAT or _STRING
+  long long int_lo, int_hi;
+  unsigned long long uint_lo, uint_hi;
+  double float_lo, float_hi;
+  const char *string_lo;
+  const char *string_hi;    // NULL for equality
+};
+
+// A condition resolved against one type.
+struct gob_scan_step {
+  int field;                // field number
+  int cond;                 // index into conds
+  char *encoded;            // for bytewise equality, allocated
+  size_t encoded_len;
+};
+
+struct gob_scan_plan {
+  int state;                // 0 not compiled, 1 matches, -1 never matches
+  int nsteps;
+  struct gob_scan_step steps[GOB_SCAN_MAX_CONDS]; // by field number
+};
+
+struct gob_scan {
+  struct gob_types types;
+  int ncond;
+  struct gob_scan_cond conds[GOB_SCAN_MAX_CONDS];
+  int ntypes;
+  int type_ids[GOB_SCAN_MAX_TYPES];
+  struct gob_scan_plan *plans;  // by type id
+  int nplans;
+  unsigned long long messages;  // value messages looked at
+  unsigned long long matches;
+};
+
+/**
+ * Called by gob_scan_buffer() for every matching value message.
+ *
+ * @param msg
+ *   The whole message, length prefix included.
+ * @param body
+ *   The value, following the type id.
+ *
+ * @return
+ *   0 to continue, anything else stops the scan after this message.
+ */
+typedef int (*gob_scan_match)(void *ctx, int id, const char *msg, size_t len,
+			      const char *body, size_t body_len);
+
+/**
+ * Initializes a scan without conditions, which matches all value messages.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_scan_init(struct gob_scan *scan);
+
+void gob_scan_destroy(struct gob_scan *scan);
+
+/**
+ * Restricts the scan to messages of type id.  Calling this more than once
+ * accepts any of the ids.
+ *
+ * @return
+ *   0 on success, -1 if there are too many type ids.
+ */
+int gob_scan_type(struct gob_scan *scan, int id);
+
+/**
+ * Adds a condition lo <= field <= hi on an int field.  The name must stay
+ * valid as long as the scan.
+ *
+ * @return
+ *   0 on success, -1 if there are too many conditions.
+ */
+int gob_scan_int(struct gob_scan *scan, const char *name, long long lo, long long hi);
+
+/**
+ * Adds a condition lo <= field <= hi on a uint or bool field.
+ */
+int gob_scan_uint(struct gob_scan *scan, const char *name, unsigned long long lo, unsigned long long hi);
+
+/**
+ * Adds a condition lo <= field <= hi on a float64 field.
+ */
+int gob_scan_double(struct gob_scan *scan, const char *name, double lo, double hi);
+
+/**
+ * Adds a condition on a string or []byte field: equality with lo if hi is
+ * NULL, otherwise lo <= field <= hi in byte order.  The strings must stay
+ * valid as long as the scan.
+ */
+int gob_scan_string(struct gob_scan *scan, const char *name, const char *lo, const char *hi);
+
+/**
+ * Scans the complete messages in buf.  Type definitions are registered as
+ * they are found.
+ *
+ * @return
+ *   The number of bytes scanned, less than buf_size if the last message is
+ *   incomplete or the match callback stopped the scan, or -1 if the stream
+ *   is malformed.
+ */
+long gob_scan_buffer(struct gob_scan *scan, const char *buf, size_t buf_size,
+		     gob_scan_match match, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,160 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "scan.h"
+#include "tick_fixture.h"
+#include <stdio.h>
+#include <string.h>
+
+static char sStream[8192];
+static size_t sStreamLen;
+static size_t sOffsets[101];
+
+// 100 ticks of type 65 cycling through four symbols, then one of type 66
+static void build_stream() {
+  static const char *syms[] = { "sym", "abc", "", "symbol" };
+  int i;
+
+  sStreamLen = encode_tick_type(sStream, sizeof(sStream), 65);
+  for (i = 0; i < 100; i++) {
+    sOffsets[i] = sStreamLen;
+    sStreamLen += encode_tick(sStream + sStreamLen, sizeof(sStream) - sStreamLen, 65,
+			      syms[i % 4], i * 0.5, i - 50, i);
+  }
+  sStreamLen += encode_tick_type(sStream + sStreamLen, sizeof(sStream) - sStreamLen, 66);
+  sOffsets[100] = sStreamLen;
+  sStreamLen += encode_tick(sStream + sStreamLen, sizeof(sStream) - sStreamLen, 66, "sym", 1, 1, 1000);
+  CU_ASSERT(sStreamLen < sizeof(sStream));
+}
+
+struct matches {
+  int count;
+  int ticks[128];   // indices of the matching ticks
+  int stop_after;
+};
+
+static int collect(void *ctx, int id, const char *msg, size_t len, const char *body, size_t body_len) {
+  struct matches *m = ctx;
+  int i;
+
+  for (i = 0; i < 101 && sStream + sOffsets[i] != msg; i++) {
+  }
+  if (m->count < 128) {
+    m->ticks[m->count] = i;
+  }
+  m->count++;
+  return m->stop_after != 0 && m->count == m->stop_after;
+}
+
+static void run(struct gob_scan *scan, struct matches *m) {
+  memset(m, 0, sizeof(struct matches));
+  CU_ASSERT_EQUAL((long)sStreamLen, gob_scan_buffer(scan, sStream, sStreamLen, collect, m));
+}
+
+void test_gob_scan_equality() {
+  struct gob_scan scan;
+  struct matches m;
+  int i;
+
+  build_stream();
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_string(&scan, "Sym", "sym", NULL));
+  run(&scan, &m);
+  CU_ASSERT_EQUAL(26, m.count);
+  for (i = 0; i < 25; i++) {
+    CU_ASSERT_EQUAL(i * 4, m.ticks[i]);
+  }
+  CU_ASSERT_EQUAL(100, m.ticks[25]);
+  CU_ASSERT_EQUAL(101, scan.messages);
+  gob_scan_destroy(&scan);
+
+  // omitted fields compare as zero values
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_string(&scan, "Sym", "", NULL));
+  CU_ASSERT_EQUAL(0, gob_scan_int(&scan, "Qty", 0, 0));
+  run(&scan, &m);
+  CU_ASSERT_EQUAL(1, m.count);
+  CU_ASSERT_EQUAL(50, m.ticks[0]);
+  gob_scan_destroy(&scan);
+
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_int(&scan, "Qty", 0, 0));
+  CU_ASSERT_EQUAL(0, gob_scan_uint(&scan, "Seq", 50, 50));
+  run(&scan, &m);
+  CU_ASSERT_EQUAL(1, m.count);
+  CU_ASSERT_EQUAL(50, m.ticks[0]);
+  gob_scan_destroy(&scan);
+
+  // an unknown field or a mismatching kind never matches
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_int(&scan, "Seq", 1, 1));
+  run(&scan, &m);
+  CU_ASSERT_EQUAL(0, m.count);
+  gob_scan_destroy(&scan);
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_int(&scan, "Missing", 1, 1));
+  run(&scan, &m);
+  CU_ASSERT_EQUAL(0, m.count);
+  gob_scan_destroy(&scan);
+}
+
+void test_gob_scan_ranges() {
+  struct gob_scan scan;
+  struct matches m;
+
+  build_stream();
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_double(&scan, "Px", 10, 12));
+  CU_ASSERT_EQUAL(0, gob_scan_int(&scan, "Qty", -30, 100));
+  run(&scan, &m);
+  // Px 10..12 are ticks 20..24, of which Qty >= -30 holds for all
+  CU_ASSERT_EQUAL(5, m.count);
+  CU_ASSERT_EQUAL(20, m.ticks[0]);
+  CU_ASSERT_EQUAL(24, m.ticks[4]);
+  gob_scan_destroy(&scan);
+
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_string(&scan, "Sym", "sym", "symz"));
+  CU_ASSERT_EQUAL(0, gob_scan_uint(&scan, "Seq", 0, 10));
+  run(&scan, &m);
+  // "sym" and "symbol" among ticks 0..10
+  CU_ASSERT_EQUAL(5, m.count);
+  CU_ASSERT_EQUAL(3, m.ticks[1]);
+  gob_scan_destroy(&scan);
+}
+
+void test_gob_scan_types() {
+  struct gob_scan scan;
+  struct matches m;
+  long used;
+
+  build_stream();
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_type(&scan, 66));
+  run(&scan, &m);
+  CU_ASSERT_EQUAL(1, m.count);
+  CU_ASSERT_EQUAL(100, m.ticks[0]);
+  gob_scan_destroy(&scan);
+
+  // stopping early, and resuming with an incomplete message at the end
+  CU_ASSERT_EQUAL(0, gob_scan_init(&scan));
+  CU_ASSERT_EQUAL(0, gob_scan_type(&scan, 65));
+  memset(&m, 0, sizeof(m));
+  m.stop_after = 10;
+  used = gob_scan_buffer(&scan, sStream, sStreamLen, collect, &m);
+  CU_ASSERT_EQUAL((long)sOffsets[10], used);
+  m.stop_after = 0;
+  used += gob_scan_buffer(&scan, sStream + used, sOffsets[50] + 3 - used, collect, &m);
+  CU_ASSERT_EQUAL((long)sOffsets[50], used);
+  used += gob_scan_buffer(&scan, sStream + used, sStreamLen - used, collect, &m);
+  CU_ASSERT_EQUAL((long)sStreamLen, used);
+  CU_ASSERT_EQUAL(100, m.count);
+  CU_ASSERT_EQUAL(99, m.ticks[99]);
+
+  // garbage
+  CU_ASSERT_EQUAL(-1, gob_scan_buffer(&scan, "\x02\x00\x00", 3, collect, &m));
+  gob_scan_destroy(&scan);
+}
@@ -0,0 +1,8 @@
+#ifndef _SCAN_TEST_H
+#define _SCAN_TEST_H
+
+void test_gob_scan_equality();
+void test_gob_scan_ranges();
+void test_gob_scan_types();
+
+#endif
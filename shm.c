@@ -0,0 +1,439 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "shm.h"
+
+// Every message in the ring starts with this header, as in mpsc.c.
+struct gob_shm_record {
+  unsigned int state;   // GOB_SHM_COMMITTED, GOB_SHM_PADDING
+  int id;
+  unsigned int len;     // committed message length
+  unsigned int span;    // bytes reserved including the header
+};
+
+#define GOB_SHM_ALIGN (sizeof(struct gob_shm_record))
+#define GOB_SHM_COMMITTED (1u)
+#define GOB_SHM_PADDING   (2u)
+
+#define GOB_SHM_MAGIC (0x676f6231u)
+
+// States of a definition.
+#define GOB_SHM_FREE    (0u)
+#define GOB_SHM_WRITING (1u)
+#define GOB_SHM_DEFINED (2u)
+
+struct gob_shm_type {
+  unsigned int state;
+  unsigned int len;
+  unsigned long long offset; // into the definitions
+  int deps[GOB_SHM_MAX_DEPS];
+  int ndeps;
+};
+
+// The start of the shared memory, followed by the definitions and the ring.
+struct gob_shm_header {
+  unsigned int magic;
+  unsigned long long size;
+  unsigned long long defs_used;
+  // producers and consumer write these, keep them on separate cache lines
+  unsigned long long head __attribute__((aligned(64)));
+  unsigned long long tail __attribute__((aligned(64)));
+  // futex words, bumped to wake those waiting
+  unsigned int data_seq __attribute__((aligned(64)));
+  unsigned int data_waiters;
+  unsigned int space_seq __attribute__((aligned(64)));
+  unsigned int space_waiters;
+  pid_t consumer __attribute__((aligned(64))); // 0 for none
+  struct gob_shm_type types[GOB_SHM_MAX_TYPES];
+};
+
+static size_t gob_shm_header_size(void) {
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  return (sizeof(struct gob_shm_header) + page - 1) & ~(page - 1);
+}
+
+static int gob_shm_map(struct gob_shm *shm, int fd, size_t map_size) {
+  shm->map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (shm->map == MAP_FAILED) {
+    shm->map = NULL;
+    return -1;
+  }
+  shm->fd = fd;
+  shm->map_size = map_size;
+  shm->hdr = shm->map;
+  shm->defs = (char*)shm->map + gob_shm_header_size();
+  shm->buf = shm->defs + GOB_SHM_DEFS_SIZE;
+  return 0;
+}
+
+int gob_shm_create(struct gob_shm *shm, size_t size) {
+  size_t rounded = (size_t)sysconf(_SC_PAGESIZE);
+  size_t map_size;
+  int fd;
+
+  while (rounded < size) {
+    rounded <<= 1;
+  }
+  memset(shm, 0, sizeof(struct gob_shm));
+  shm->fd = -1;
+  map_size = gob_shm_header_size() + GOB_SHM_DEFS_SIZE + rounded;
+  fd = memfd_create("gob_shm", MFD_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  // a new memfd reads as zeros
+  if (ftruncate(fd, map_size) < 0 || gob_shm_map(shm, fd, map_size) < 0) {
+    close(fd);
+    return -1;
+  }
+  shm->size = rounded;
+  shm->hdr->size = rounded;
+  __atomic_store_n(&shm->hdr->magic, GOB_SHM_MAGIC, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int gob_shm_open(struct gob_shm *shm, int fd) {
+  struct gob_shm_header hdr;
+  struct stat st;
+  size_t size;
+
+  memset(shm, 0, sizeof(struct gob_shm));
+  shm->fd = -1;
+  if (fstat(fd, &st) < 0) {
+    return -1;
+  }
+  if (pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) || hdr.magic != GOB_SHM_MAGIC ||
+      (hdr.size & (hdr.size - 1)) != 0 ||
+      (unsigned long long)st.st_size != gob_shm_header_size() + GOB_SHM_DEFS_SIZE + hdr.size) {
+    errno = EINVAL;
+    return -1;
+  }
+  size = hdr.size;
+  fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (gob_shm_map(shm, fd, st.st_size) < 0) {
+    close(fd);
+    return -1;
+  }
+  shm->size = size;
+  return 0;
+}
+
+void gob_shm_close(struct gob_shm *shm) {
+  pid_t self = getpid();
+
+  if (shm->consumer) {
+    __atomic_compare_exchange_n(&shm->hdr->consumer, &self, 0, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+  }
+  if (shm->map != NULL) {
+    munmap(shm->map, shm->map_size);
+  }
+  if (shm->fd >= 0) {
+    close(shm->fd);
+  }
+  memset(shm, 0, sizeof(struct gob_shm));
+  shm->fd = -1;
+}
+
+int gob_shm_claim(struct gob_shm *shm) {
+  pid_t self = getpid();
+  pid_t current = __atomic_load_n(&shm->hdr->consumer, __ATOMIC_ACQUIRE);
+
+  while (current != self) {
+    // a consumer that died without closing leaves its pid behind
+    if (current != 0 && (kill(current, 0) == 0 || errno == EPERM)) {
+      errno = EBUSY;
+      return -1;
+    }
+    if (__atomic_compare_exchange_n(&shm->hdr->consumer, &current, self, 0,
+				    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+  }
+  shm->consumer = 1;
+  memset(shm->sent, 0, sizeof(shm->sent));
+  return 0;
+}
+
+static int gob_shm_same_definition(const struct gob_shm *shm, const struct gob_shm_type *type,
+				   const char *def, size_t len, const int *deps, int ndeps) {
+  return type->len == len && memcmp(shm->defs + type->offset, def, len) == 0 &&
+    type->ndeps == ndeps && (ndeps == 0 || memcmp(type->deps, deps, ndeps * sizeof(int)) == 0);
+}
+
+int gob_shm_define(struct gob_shm *shm, int id, const char *def, size_t len, const int *deps, int ndeps) {
+  struct gob_shm_type *type;
+  unsigned long long offset;
+  unsigned int state;
+
+  if (id <= 0 || id >= GOB_SHM_MAX_TYPES || ndeps < 0 || ndeps > GOB_SHM_MAX_DEPS) {
+    errno = EINVAL;
+    return -1;
+  }
+  type = &shm->hdr->types[id];
+  for (;;) {
+    state = GOB_SHM_FREE;
+    if (__atomic_compare_exchange_n(&type->state, &state, GOB_SHM_WRITING, 0,
+				    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+      break;
+    }
+    if (state == GOB_SHM_DEFINED) {
+      if (gob_shm_same_definition(shm, type, def, len, deps, ndeps)) {
+	return 0;
+      }
+      errno = EEXIST;
+      return -1;
+    }
+    // another process is writing the definition
+    sched_yield();
+  }
+  offset = __atomic_fetch_add(&shm->hdr->defs_used, len, __ATOMIC_RELAXED);
+  if (offset + len > GOB_SHM_DEFS_SIZE) {
+    __atomic_store_n(&type->state, GOB_SHM_FREE, __ATOMIC_RELEASE);
+    errno = ENOSPC;
+    return -1;
+  }
+  memcpy(shm->defs + offset, def, len);
+  type->offset = offset;
+  type->len = len;
+  if (ndeps > 0) {
+    memcpy(type->deps, deps, ndeps * sizeof(int));
+  }
+  type->ndeps = ndeps;
+  __atomic_store_n(&type->state, GOB_SHM_DEFINED, __ATOMIC_RELEASE);
+  return 0;
+}
+
+static size_t gob_shm_span(size_t len) {
+  return (sizeof(struct gob_shm_record) + len + GOB_SHM_ALIGN - 1) & ~(GOB_SHM_ALIGN - 1);
+}
+
+// The bytes a reservation of span at head takes, including the padding up
+// to the end of the ring.
+static size_t gob_shm_needed(const struct gob_shm *shm, unsigned long long head, size_t span) {
+  size_t offset = head & (shm->size - 1);
+  return span > shm->size - offset ? shm->size - offset + span : span;
+}
+
+char *gob_shm_reserve(struct gob_shm *shm, size_t len) {
+  struct gob_shm_header *hdr = shm->hdr;
+  size_t span = gob_shm_span(len);
+  unsigned long long head;
+  unsigned long long tail;
+  size_t offset;
+  size_t needed;
+  struct gob_shm_record *rec;
+
+  if (span > shm->size) {
+    return NULL;
+  }
+  do {
+    // tail first: a head read after it is never behind it
+    tail = __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE);
+    head = __atomic_load_n(&hdr->head, __ATOMIC_RELAXED);
+    needed = gob_shm_needed(shm, head, span);
+    if (head + needed - tail > shm->size) {
+      return NULL;
+    }
+  } while (!__atomic_compare_exchange_n(&hdr->head, &head, head + needed, 1,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  offset = head & (shm->size - 1);
+  if (needed != span) {
+    rec = (struct gob_shm_record*)(shm->buf + offset);
+    rec->span = needed - span;
+    __atomic_store_n(&rec->state, GOB_SHM_COMMITTED | GOB_SHM_PADDING, __ATOMIC_RELEASE);
+    offset = 0;
+  }
+  rec = (struct gob_shm_record*)(shm->buf + offset);
+  rec->span = span;
+  return (char*)(rec + 1);
+}
+
+static int gob_shm_futex_wait(unsigned int *addr, unsigned int val, int timeout_ms) {
+  struct timespec ts;
+
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  return syscall(SYS_futex, addr, FUTEX_WAIT, val, timeout_ms < 0 ? NULL : &ts, NULL, 0);
+}
+
+// Wakes everyone waiting on seq, if anyone is.  The caller's stores are
+// ordered before the check of waiters, as the waiters' increment is before
+// their check of the ring.
+static void gob_shm_wake(unsigned int *seq, unsigned int *waiters) {
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(waiters, __ATOMIC_RELAXED) > 0) {
+    __atomic_fetch_add(seq, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, seq, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+  }
+}
+
+void gob_shm_commit(struct gob_shm *shm, char *msg, size_t len, int id) {
+  struct gob_shm_record *rec = (struct gob_shm_record*)msg - 1;
+
+  rec->id = id;
+  rec->len = len;
+  __atomic_store_n(&rec->state, GOB_SHM_COMMITTED, __ATOMIC_RELEASE);
+  gob_shm_wake(&shm->hdr->data_seq, &shm->hdr->data_waiters);
+}
+
+// Passes the definition of id and its dependencies to the sink unless they
+// have been handed out already.  Returns the sink's verdict.
+static int gob_shm_send_definition(struct gob_shm *shm, int id, gob_shm_sink sink, void *ctx) {
+  const struct gob_shm_type *type;
+  int i;
+  int ret;
+
+  if (id <= 0 || id >= GOB_SHM_MAX_TYPES || (shm->sent[id/8] & (1 << (id%8)))) {
+    return 0;
+  }
+  type = &shm->hdr->types[id];
+  if (__atomic_load_n(&type->state, __ATOMIC_ACQUIRE) != GOB_SHM_DEFINED) {
+    return 0;
+  }
+  shm->sent[id/8] |= 1 << (id%8);
+  ret = sink(ctx, shm->defs + type->offset, type->len);
+  for (i = 0; i < type->ndeps && ret == 0; i++) {
+    ret = gob_shm_send_definition(shm, type->deps[i], sink, ctx);
+  }
+  return ret;
+}
+
+int gob_shm_consume(struct gob_shm *shm, gob_shm_sink sink, void *ctx, int max) {
+  size_t mask = shm->size - 1;
+  unsigned long long start = shm->hdr->tail;
+  unsigned long long tail = start;
+  struct gob_shm_record *rec;
+  unsigned int state;
+  int count = 0;
+  int stop = 0;
+
+  while (count < max && !stop) {
+    rec = (struct gob_shm_record*)(shm->buf + (tail & mask));
+    state = __atomic_load_n(&rec->state, __ATOMIC_ACQUIRE);
+    if (!(state & GOB_SHM_COMMITTED)) {
+      break;
+    }
+    if (!(state & GOB_SHM_PADDING) && rec->len > 0) {
+      stop = gob_shm_send_definition(shm, rec->id, sink, ctx);
+      if (stop) {
+	break;
+      }
+      stop = sink(ctx, (const char*)(rec + 1), rec->len);
+      count++;
+    }
+    tail += rec->span;
+    // messages of other sizes put their headers anywhere in the span
+    memset(rec, 0, rec->span);
+    __atomic_store_n(&shm->hdr->tail, tail, __ATOMIC_RELEASE);
+  }
+  // padding and abandoned records free space too
+  if (tail != start) {
+    gob_shm_wake(&shm->hdr->space_seq, &shm->hdr->space_waiters);
+  }
+  return count;
+}
+
+// Whether a message is committed at the tail.
+static int gob_shm_ready(const struct gob_shm *shm) {
+  unsigned long long tail = __atomic_load_n(&shm->hdr->tail, __ATOMIC_ACQUIRE);
+  const struct gob_shm_record *rec = (struct gob_shm_record*)(shm->buf + (tail & (shm->size - 1)));
+  unsigned int state = __atomic_load_n(&rec->state, __ATOMIC_ACQUIRE);
+
+  if (state == (GOB_SHM_COMMITTED | GOB_SHM_PADDING)) {
+    rec = (struct gob_shm_record*)shm->buf;
+    state = __atomic_load_n(&rec->state, __ATOMIC_ACQUIRE);
+  }
+  return (state & GOB_SHM_COMMITTED) != 0;
+}
+
+// Whether a message of span bytes would fit.
+static int gob_shm_room(const struct gob_shm *shm, size_t span) {
+  unsigned long long tail = __atomic_load_n(&shm->hdr->tail, __ATOMIC_ACQUIRE);
+  unsigned long long head = __atomic_load_n(&shm->hdr->head, __ATOMIC_RELAXED);
+  return head + gob_shm_needed(shm, head, span) - tail <= shm->size;
+}
+
+static long long gob_shm_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// Waits on seq until ready() holds or timeout_ms have passed.  The futex
+// also returns when seq moved for something else, e.g. a message committed
+// behind the one at the tail, so it is waited on again for the time left.
+static int gob_shm_wait_for(struct gob_shm *shm, unsigned int *seq, unsigned int *waiters,
+			    int (*ready)(const struct gob_shm*, size_t), size_t arg, int timeout_ms) {
+  long long deadline = 0;
+  unsigned int value;
+  int left = timeout_ms;
+  int ret;
+
+  if (ready(shm, arg)) {
+    return 1;
+  }
+  if (timeout_ms > 0) {
+    deadline = gob_shm_now_ms() + timeout_ms;
+  }
+  for (;;) {
+    ret = 0;
+    __atomic_fetch_add(waiters, 1, __ATOMIC_SEQ_CST);
+    value = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+    if (!ready(shm, arg)) {
+      ret = gob_shm_futex_wait(seq, value, left);
+    }
+    __atomic_fetch_sub(waiters, 1, __ATOMIC_RELAXED);
+    if (ready(shm, arg)) {
+      return 1;
+    }
+    if (ret < 0 && errno == EINTR) {
+      return 0;
+    }
+    if (ret < 0 && errno != EAGAIN && errno != ETIMEDOUT) {
+      return -1;
+    }
+    if (timeout_ms >= 0) {
+      left = timeout_ms > 0 ? (int)(deadline - gob_shm_now_ms()) : 0;
+      if (left <= 0) {
+	return 0;
+      }
+    }
+  }
+}
+
+static int gob_shm_data_ready(const struct gob_shm *shm, size_t unused) {
+  (void)unused;
+  return gob_shm_ready(shm);
+}
+
+int gob_shm_wait(struct gob_shm *shm, int timeout_ms) {
+  return gob_shm_wait_for(shm, &shm->hdr->data_seq, &shm->hdr->data_waiters,
+			  gob_shm_data_ready, 0, timeout_ms);
+}
+
+int gob_shm_wait_space(struct gob_shm *shm, size_t len, int timeout_ms) {
+  if (gob_shm_span(len) > shm->size) {
+    errno = EMSGSIZE;
+    return -1;
+  }
+  return gob_shm_wait_for(shm, &shm->hdr->space_seq, &shm->hdr->space_waiters,
+			  gob_shm_room, gob_shm_span(len), timeout_ms);
+}
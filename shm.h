@@ -0,0 +1,206 @@
+#ifndef _SHM_H
+#define _SHM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Shared-memory ring of framed messages between processes on one host.
+ *
+ * A gob_shm is the ring of gob_mpsc (see mpsc.h) placed in a memfd, which
+ * is mapped by every process using it: any number of producers encode
+ * messages straight into the ring, and one consumer is handed views of them
+ * in place, without a copy or a system call per message.
+ *
+ * \code
+ * // creator, before fork()ing or passing shm.fd on (SCM_RIGHTS)
+ * gob_shm_create(&shm, 1 << 20);
+ * gob_shm_define(&shm, 65, tick_def, tick_def_len, NULL, 0);
+ *
+ * // producer
+ * while ((p = gob_shm_reserve(&shm, max_len)) == NULL) {
+ *   gob_shm_wait_space(&shm, max_len, 100);
+ * }
+ * gob_shm_commit(&shm, p, gob_end_message(p, max_len, body_len), 65);
+ *
+ * // consumer
+ * gob_shm_open(&shm, fd);
+ * gob_shm_claim(&shm);
+ * for (;;) {
+ *   gob_shm_wait(&shm, 100);
+ *   gob_shm_consume(&shm, decode, &dec, 64);
+ * }
+ * \endcode
+ *
+ * Type definitions are copied into the shared memory, and the consumer
+ * hands out the definition of a type before the first value of that type
+ * it sees, as gob_mpsc_consume() does.  Which definitions were handed out is
+ * kept by the consumer process, so a consumer that restarts, or takes over
+ * from one that died, gets the definitions again: the stream it sees is
+ * always decodable from its start.  A message is only removed from the ring
+ * once the sink returns, so one being consumed when the consumer died is
+ * handed out again.  A producer that dies between reserving and committing
+ * blocks the ring, as a thread would in gob_mpsc.
+ *
+ * Waiting uses futexes on words in the shared memory.  A producer commit
+ * and a consumer release only make the system call if the other side is
+ * waiting.
+ */
+
+/**
+ * Type ids below this value can be registered with gob_shm_define().
+ */
+#define GOB_SHM_MAX_TYPES (1024)
+
+/**
+ * The number of types a definition may depend on.
+ */
+#define GOB_SHM_MAX_DEPS (16)
+
+/**
+ * The room for type definitions in the shared memory.
+ */
+#define GOB_SHM_DEFS_SIZE (64 * 1024)
+
+struct gob_shm_header;
+
+struct gob_shm {
+  int fd;
+  void *map;
+  size_t map_size;
+  struct gob_shm_header *hdr;
+  char *buf;                // the ring
+  size_t size;              // a power of two
+  char *defs;               // the definitions' bytes
+  int consumer;             // whether this process claimed the ring
+  unsigned char sent[GOB_SHM_MAX_TYPES/8]; // definitions handed out
+};
+
+/**
+ * Called by gob_shm_consume() for every message, in stream order.
+ *
+ * @param msg
+ *   The message inside the shared memory, valid until the sink returns.
+ *
+ * @return
+ *   0 to continue, anything else stops gob_shm_consume() before the next
+ *   message.
+ */
+typedef int (*gob_shm_sink)(void *ctx, const char *msg, size_t len);
+
+/**
+ * Creates a ring in a new memfd and maps it.  The memfd is closed on exec.
+ *
+ * @param size
+ *   The size of the ring in bytes, rounded up to a power of two.
+ *
+ * @return
+ *   0 on success, -1 with errno set on failure.
+ */
+int gob_shm_create(struct gob_shm *shm, size_t size);
+
+/**
+ * Maps a ring created by another process from its memfd, which is
+ * duplicated.  A child process that inherited the mapping through fork()
+ * can use its copy of the gob_shm instead.
+ *
+ * @return
+ *   0 on success, -1 with errno set on failure, EINVAL if fd does not hold
+ *   a ring.
+ */
+int gob_shm_open(struct gob_shm *shm, int fd);
+
+/**
+ * Unmaps the ring and closes the descriptor, releasing the claim of a
+ * consumer.
+ */
+void gob_shm_close(struct gob_shm *shm);
+
+/**
+ * Makes this process the ring's consumer.  The claim of a consumer whose
+ * process is gone passes on.  The definitions are handed out anew.
+ *
+ * @return
+ *   0 on success, -1 with errno EBUSY if another live process is the
+ *   consumer.
+ */
+int gob_shm_claim(struct gob_shm *shm);
+
+/**
+ * Registers the definition of a type, copying it into the shared memory.
+ * Registering the same definition again, e.g. from a producer that
+ * restarted, does nothing.
+ *
+ * @param def
+ *   The framed type definition message.
+ * @param deps
+ *   The ids of the user types the definition refers to, as for
+ *   gob_mpsc_define().
+ *
+ * @return
+ *   0 on success, -1 with errno EINVAL if id or ndeps are out of range,
+ *   EEXIST if id has a different definition and ENOSPC if the definitions
+ *   do not fit.
+ */
+int gob_shm_define(struct gob_shm *shm, int id, const char *def, size_t len, const int *deps, int ndeps);
+
+/**
+ * Reserves space for a framed message of up to len bytes.  Safe to call from
+ * any thread of any process.
+ *
+ * @return
+ *   The space to encode the message into, or NULL if the ring is full.
+ */
+char *gob_shm_reserve(struct gob_shm *shm, size_t len);
+
+/**
+ * Publishes a message encoded into reserved space, waking the consumer if
+ * it waits.  Every reservation must be committed; commit a length of 0 to
+ * abandon one.
+ *
+ * @param id
+ *   The type id of the value, or 0 if no definition has to precede it.
+ */
+void gob_shm_commit(struct gob_shm *shm, char *msg, size_t len, int id);
+
+/**
+ * Passes committed messages to the sink, preceded by any definitions they
+ * need.  Only the consumer may call this.
+ *
+ * @param max
+ *   The maximum number of value messages to pass on.
+ *
+ * @return
+ *   The number of value messages passed on.
+ */
+int gob_shm_consume(struct gob_shm *shm, gob_shm_sink sink, void *ctx, int max);
+
+/**
+ * Waits until a message is committed, for the consumer.
+ *
+ * @param timeout_ms
+ *   The longest time to wait, or -1 to wait indefinitely.
+ *
+ * @return
+ *   1 if a message is ready, 0 on timeout or signal, -1 with errno set on
+ *   failure.
+ */
+int gob_shm_wait(struct gob_shm *shm, int timeout_ms);
+
+/**
+ * Waits until the consumer has made room for a message of len bytes, for
+ * producers.
+ *
+ * @return
+ *   As gob_shm_wait().
+ */
+int gob_shm_wait_space(struct gob_shm *shm, size_t len, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "shm.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#define PRODUCERS (3)
+#define MESSAGES (20000)
+
+static const char sOuterDef[] = "outer";
+static const char sInnerDef[] = "inner";
+
+struct collector {
+  int next[PRODUCERS];
+  int defs[2];
+  int values;
+  int errors;
+};
+
+// Writes MESSAGES messages of producer index, of up to 40 bytes, waiting
+// for room as needed.
+static void produce(struct gob_shm *shm, int index) {
+  char *space;
+  int msg[10];
+  size_t len;
+  int i;
+
+  for (i = 0; i < MESSAGES; i++) {
+    len = sizeof(int) * (2 + i % 8);
+    while ((space = gob_shm_reserve(shm, len)) == NULL) {
+      gob_shm_wait_space(shm, len, 1000);
+    }
+    msg[0] = index;
+    msg[1] = i;
+    memcpy(space, msg, len);
+    gob_shm_commit(shm, space, len, i % 2 ? 65 : 0);
+  }
+}
+
+static int collect(void *ctx, const char *msg, size_t len) {
+  struct collector *c = ctx;
+  int value[2];
+
+  if (len == sizeof(sOuterDef) && memcmp(msg, sOuterDef, len) == 0) {
+    c->errors += c->defs[0]++ != 0 || c->defs[1] != 0;
+  } else if (len == sizeof(sInnerDef) && memcmp(msg, sInnerDef, len) == 0) {
+    c->errors += c->defs[1]++ != 0 || c->defs[0] != 1;
+  } else {
+    memcpy(value, msg, sizeof(value));
+    if (value[0] < 0 || value[0] >= PRODUCERS || value[1] != c->next[value[0]] ||
+	len != sizeof(int) * (2 + value[1] % 8)) {
+      c->errors++;
+    } else {
+      c->next[value[0]]++;
+      // the definitions precede the first value of type 65
+      c->errors += value[1] % 2 == 1 && c->defs[0] == 0;
+    }
+    c->values++;
+  }
+  return 0;
+}
+
+void test_gob_shm_producers() {
+  static const int deps[] = { 66 };
+  struct gob_shm shm;
+  struct collector c;
+  pid_t pids[PRODUCERS];
+  int status;
+  int i;
+
+  CU_ASSERT_FATAL(gob_shm_create(&shm, 4096) == 0);
+  CU_ASSERT_EQUAL(4096, shm.size);
+  CU_ASSERT_EQUAL(0, gob_shm_define(&shm, 65, sOuterDef, sizeof(sOuterDef), deps, 1));
+  CU_ASSERT_EQUAL(0, gob_shm_define(&shm, 66, sInnerDef, sizeof(sInnerDef), NULL, 0));
+  // again, as a restarted producer would
+  CU_ASSERT_EQUAL(0, gob_shm_define(&shm, 66, sInnerDef, sizeof(sInnerDef), NULL, 0));
+  errno = 0;
+  CU_ASSERT_EQUAL(-1, gob_shm_define(&shm, 66, sOuterDef, sizeof(sOuterDef), NULL, 0));
+  CU_ASSERT_EQUAL(EEXIST, errno);
+  CU_ASSERT_EQUAL(0, gob_shm_claim(&shm));
+
+  for (i = 0; i < PRODUCERS; i++) {
+    pids[i] = fork();
+    if (pids[i] == 0) {
+      produce(&shm, i);
+      _exit(0);
+    }
+    CU_ASSERT(pids[i] > 0);
+  }
+
+  memset(&c, 0, sizeof(c));
+  while (c.values < PRODUCERS * MESSAGES && c.errors == 0) {
+    if (gob_shm_wait(&shm, 5000) == 0) {
+      // a real timeout, fails below; the producers would wait for room
+      // forever
+      for (i = 0; i < PRODUCERS; i++) {
+	kill(pids[i], SIGKILL);
+      }
+      break;
+    }
+    gob_shm_consume(&shm, collect, &c, 64);
+  }
+  CU_ASSERT_EQUAL(PRODUCERS * MESSAGES, c.values);
+  CU_ASSERT_EQUAL(0, c.errors);
+  CU_ASSERT_EQUAL(1, c.defs[0]);
+  CU_ASSERT_EQUAL(1, c.defs[1]);
+  for (i = 0; i < PRODUCERS; i++) {
+    CU_ASSERT_EQUAL(MESSAGES, c.next[i]);
+    CU_ASSERT_EQUAL(pids[i], waitpid(pids[i], &status, 0));
+    CU_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  // nothing more comes
+  CU_ASSERT_EQUAL(0, gob_shm_wait(&shm, 10));
+  gob_shm_close(&shm);
+}
+
+// A consumer that dies while handling its fifth value.
+static int crash(void *ctx, const char *msg, size_t len) {
+  struct collector *c = ctx;
+  if (len != sizeof(sOuterDef) && len != sizeof(sInnerDef) && ++c->values == 5) {
+    _exit(c->defs[0] == 0 ? 2 : 0);
+  }
+  c->defs[0] += len == sizeof(sOuterDef);
+  return 0;
+}
+
+void test_gob_shm_restart() {
+  static const int deps[] = { 66 };
+  struct gob_shm shm;
+  struct gob_shm other;
+  struct collector c;
+  char *space;
+  int msg[10];
+  size_t len;
+  int ready[2];
+  int go[2];
+  int status;
+  pid_t pid;
+  char ch;
+  int i;
+
+  CU_ASSERT_FATAL(gob_shm_create(&shm, 4096) == 0);
+  CU_ASSERT_EQUAL(0, gob_shm_define(&shm, 65, sOuterDef, sizeof(sOuterDef), deps, 1));
+  CU_ASSERT_EQUAL(0, gob_shm_define(&shm, 66, sInnerDef, sizeof(sInnerDef), NULL, 0));
+  for (i = 0; i < 20; i++) {
+    len = sizeof(int) * (2 + i % 8);
+    space = gob_shm_reserve(&shm, len);
+    CU_ASSERT_FATAL(space != NULL);
+    msg[0] = 0;
+    msg[1] = i;
+    memcpy(space, msg, len);
+    gob_shm_commit(&shm, space, len, 65);
+  }
+
+  // the consumer maps the ring from its descriptor, and crashes
+  CU_ASSERT_EQUAL(0, pipe(ready));
+  CU_ASSERT_EQUAL(0, pipe(go));
+  pid = fork();
+  if (pid == 0) {
+    memset(&c, 0, sizeof(c));
+    if (gob_shm_open(&other, shm.fd) < 0 || gob_shm_claim(&other) < 0) {
+      _exit(1);
+    }
+    if (write(ready[1], "x", 1) != 1 || read(go[0], &ch, 1) != 1) {
+      _exit(1);
+    }
+    gob_shm_consume(&other, crash, &c, 64);
+    _exit(3);
+  }
+  CU_ASSERT_EQUAL(1, read(ready[0], &ch, 1));
+  // it lives, and is the consumer
+  errno = 0;
+  CU_ASSERT_EQUAL(-1, gob_shm_claim(&shm));
+  CU_ASSERT_EQUAL(EBUSY, errno);
+  CU_ASSERT_EQUAL(1, write(go[1], "x", 1));
+  CU_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+  CU_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  close(ready[0]);
+  close(ready[1]);
+  close(go[0]);
+  close(go[1]);
+
+  // the claim passes on; the definitions come again, and the value the
+  // consumer died on
+  CU_ASSERT_EQUAL(0, gob_shm_open(&other, shm.fd));
+  CU_ASSERT_EQUAL(0, gob_shm_claim(&other));
+  memset(&c, 0, sizeof(c));
+  c.next[0] = 4;
+  CU_ASSERT_EQUAL(1, gob_shm_wait(&other, 0));
+  CU_ASSERT_EQUAL(16, gob_shm_consume(&other, collect, &c, 64));
+  CU_ASSERT_EQUAL(0, c.errors);
+  CU_ASSERT_EQUAL(1, c.defs[0]);
+  CU_ASSERT_EQUAL(1, c.defs[1]);
+  CU_ASSERT_EQUAL(20, c.next[0]);
+  gob_shm_close(&other);
+
+  // a closed consumer releases its claim
+  CU_ASSERT_EQUAL(0, gob_shm_claim(&shm));
+  errno = 0;
+  CU_ASSERT_EQUAL(-1, gob_shm_open(&other, 0));
+  gob_shm_close(&shm);
+}
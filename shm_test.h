@@ -0,0 +1,7 @@
+#ifndef _SHM_TEST_H
+#define _SHM_TEST_H
+
+void test_gob_shm_producers();
+void test_gob_shm_restart();
+
+#endif
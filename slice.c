@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "encode.h"
+#include "slice.h"
+#include "stats.h"
+
+void gob_slice_encoder_init(struct gob_slice_encoder *enc, int id) {
+  memset(enc, 0, sizeof(struct gob_slice_encoder));
+  enc->id = id;
+}
+
+void gob_slice_encoder_destroy(struct gob_slice_encoder *enc) {
+  free(enc->head);
+  free(enc->tail);
+  free(enc->elems);
+  memset(enc, 0, sizeof(struct gob_slice_encoder));
+}
+
+static int gob_slice_encoder_set(char **dst, size_t *dst_len, const char *src, size_t len) {
+  char *copy = malloc(len > 0 ? len : 1);
+  if (copy == NULL) {
+    return -1;
+  }
+  memcpy(copy, src, len);
+  free(*dst);
+  *dst = copy;
+  *dst_len = len;
+  return 0;
+}
+
+int gob_slice_encoder_set_head(struct gob_slice_encoder *enc, const char *head, size_t len) {
+  return gob_slice_encoder_set(&enc->head, &enc->head_len, head, len);
+}
+
+int gob_slice_encoder_set_tail(struct gob_slice_encoder *enc, const char *tail, size_t len) {
+  return gob_slice_encoder_set(&enc->tail, &enc->tail_len, tail, len);
+}
+
+char *gob_slice_encoder_reserve(struct gob_slice_encoder *enc, size_t size) {
+  size_t grown_size;
+  char *grown;
+
+  if (size > enc->elems_size - enc->elems_len) {
+    grown_size = enc->elems_size > 0 ? enc->elems_size * 2 : 256;
+    while (grown_size - enc->elems_len < size) {
+      grown_size *= 2;
+    }
+    grown = realloc(enc->elems, grown_size);
+    if (grown == NULL) {
+      return NULL;
+    }
+    enc->elems = grown;
+    enc->elems_size = grown_size;
+  }
+  return enc->elems + enc->elems_len;
+}
+
+void gob_slice_encoder_commit(struct gob_slice_encoder *enc, size_t len) {
+  enc->elems_len += len;
+  enc->count++;
+}
+
+int gob_slice_encoder_iov(struct gob_slice_encoder *enc, struct iovec iov[GOB_SLICE_ENCODER_IOV]) {
+  char id_bytes[sizeof(unsigned long long)+1];
+  int id_len = gob_encode_int(id_bytes, sizeof(id_bytes), enc->id);
+  int count_len = gob_encode_unsigned_long_long(enc->count_bytes, sizeof(enc->count_bytes), enc->count);
+  size_t body_len = id_len + enc->head_len + count_len + enc->elems_len + enc->tail_len;
+  int prefix_len = gob_encode_unsigned_long_long(enc->prefix, sizeof(enc->prefix), body_len);
+  int iovcnt = 0;
+
+  memcpy(enc->prefix + prefix_len, id_bytes, id_len);
+  GOB_STATS_MESSAGE(enc->id, prefix_len + body_len);
+  iov[iovcnt].iov_base = enc->prefix;
+  iov[iovcnt].iov_len = prefix_len + id_len;
+  iovcnt++;
+  if (enc->head_len > 0) {
+    iov[iovcnt].iov_base = enc->head;
+    iov[iovcnt].iov_len = enc->head_len;
+    iovcnt++;
+  }
+  iov[iovcnt].iov_base = enc->count_bytes;
+  iov[iovcnt].iov_len = count_len;
+  iovcnt++;
+  if (enc->elems_len > 0) {
+    iov[iovcnt].iov_base = enc->elems;
+    iov[iovcnt].iov_len = enc->elems_len;
+    iovcnt++;
+  }
+  if (enc->tail_len > 0) {
+    iov[iovcnt].iov_base = enc->tail;
+    iov[iovcnt].iov_len = enc->tail_len;
+    iovcnt++;
+  }
+  return iovcnt;
+}
+
+size_t gob_slice_encoder_copy(struct gob_slice_encoder *enc, char *buf, size_t buf_size) {
+  struct iovec iov[GOB_SLICE_ENCODER_IOV];
+  int iovcnt = gob_slice_encoder_iov(enc, iov);
+  size_t total_size = 0;
+  size_t n;
+  int i;
+
+  for (i = 0; i < iovcnt; i++) {
+    if (total_size < buf_size) {
+      n = iov[i].iov_len < buf_size - total_size ? iov[i].iov_len : buf_size - total_size;
+      memcpy(buf + total_size, iov[i].iov_base, n);
+    }
+    total_size += iov[i].iov_len;
+  }
+  return total_size;
+}
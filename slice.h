@@ -0,0 +1,122 @@
+#ifndef _SLICE_H
+#define _SLICE_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Incremental encoding of messages around a growing slice.
+ *
+ * Snapshots that repeat an append-only slice are costly to re-encode in
+ * full.  A gob_slice_encoder keeps the encoded elements sent so far, so
+ * every snapshot only encodes the elements added since:
+ *
+ * \code
+ * gob_slice_encoder_init(&enc, my_data_id);
+ * gob_slice_encoder_set_head(&enc, head, head_len);  // up to the slice's field delta
+ * gob_slice_encoder_set_tail(&enc, "\0", 1);         // gob_end_struct()
+ * for (;;) {
+ *   ...for every new element...
+ *     elem = gob_slice_encoder_reserve(&enc, 64);
+ *     gob_slice_encoder_commit(&enc, encode_field_data(elem, 64, ...));
+ *   iovcnt = gob_slice_encoder_iov(&enc, iov);
+ *   gob_writer_writev(&writer, iov, iovcnt);
+ * }
+ * \endcode
+ *
+ * A message is gathered from five pieces: the length prefix and type id, the
+ * head, the element count, the elements and the tail.  The length prefix and
+ * count live in small buffers of their own, so a count or length growing by
+ * a byte moves nothing.
+ */
+
+/**
+ * The number of iovecs gob_slice_encoder_iov() fills at most.
+ */
+#define GOB_SLICE_ENCODER_IOV (5)
+
+struct gob_slice_encoder {
+  int id;                   // type id of the messages
+  char *head;               // the message body between type id and count
+  size_t head_len;
+  char *tail;               // the message body after the elements
+  size_t tail_len;
+  char *elems;              // the encoded elements
+  size_t elems_len;
+  size_t elems_size;
+  size_t count;             // elements
+  char prefix[2*(sizeof(unsigned long long)+1)]; // length prefix and type id
+  char count_bytes[sizeof(unsigned long long)+1];
+};
+
+/**
+ * Initializes an encoder of messages of type id, with an empty slice and
+ * empty head and tail.
+ */
+void gob_slice_encoder_init(struct gob_slice_encoder *enc, int id);
+
+void gob_slice_encoder_destroy(struct gob_slice_encoder *enc);
+
+/**
+ * Sets the bytes of the message between the type id and the element count,
+ * e.g. the fields in front of the slice and the slice's field delta.  They
+ * are copied.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_slice_encoder_set_head(struct gob_slice_encoder *enc, const char *head, size_t len);
+
+/**
+ * Sets the bytes of the message after the last element, e.g. the fields
+ * after the slice and gob_end_struct().  They are copied.
+ */
+int gob_slice_encoder_set_tail(struct gob_slice_encoder *enc, const char *tail, size_t len);
+
+/**
+ * Returns space for the next element to be encoded into.
+ *
+ * @param size
+ *   The most bytes the element takes.
+ *
+ * @return
+ *   A pointer to the space, valid until the next call, or NULL if memory ran
+ *   out.
+ */
+char *gob_slice_encoder_reserve(struct gob_slice_encoder *enc, size_t size);
+
+/**
+ * Appends the element encoded into the space returned by
+ * gob_slice_encoder_reserve().
+ *
+ * @param len
+ *   The size of the element, at most the reserved size.
+ */
+void gob_slice_encoder_commit(struct gob_slice_encoder *enc, size_t len);
+
+/**
+ * Gathers the current message, framed as by gob_end_message().  The pieces
+ * stay valid until the encoder is changed.
+ *
+ * @return
+ *   The number of iovecs filled.
+ */
+int gob_slice_encoder_iov(struct gob_slice_encoder *enc, struct iovec iov[GOB_SLICE_ENCODER_IOV]);
+
+/**
+ * Copies the current message into buf.
+ *
+ * @return
+ *   The number of bytes that would have been written.
+ */
+size_t gob_slice_encoder_copy(struct gob_slice_encoder *enc, char *buf, size_t buf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "slice.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// type Snapshot struct { Name string; Values []int; Seq uint }, encoded in
+// full the usual way.
+static int encode_snapshot(char *buf, size_t buf_size, int id, const char *name, int count,
+			   unsigned long long seq) {
+  int total_bytes = 0;
+  int i;
+  total_bytes += gob_start_message(buf, buf_size, id);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, buf_size-total_bytes, name);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_start_slice(buf+total_bytes, buf_size-total_bytes, count);
+  for (i = 0; i < count; i++) {
+    total_bytes += gob_encode_long_long(buf+total_bytes, buf_size-total_bytes, i * 1000LL - 7);
+  }
+  total_bytes += gob_end_slice(buf+total_bytes, buf_size-total_bytes);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_unsigned_long_long(buf+total_bytes, buf_size-total_bytes, seq);
+  total_bytes += gob_end_struct(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+static void set_head_and_tail(struct gob_slice_encoder *enc, unsigned long long seq) {
+  char buf[64];
+  int len;
+
+  len = gob_encode_unsigned_int(buf, sizeof(buf), 1);
+  len += gob_encode_string(buf+len, sizeof(buf)-len, "snapshot");
+  len += gob_encode_unsigned_int(buf+len, sizeof(buf)-len, 1);
+  CU_ASSERT_EQUAL(0, gob_slice_encoder_set_head(enc, buf, len));
+  len = gob_encode_unsigned_int(buf, sizeof(buf), 1);
+  len += gob_encode_unsigned_long_long(buf+len, sizeof(buf)-len, seq);
+  len += gob_end_struct(buf+len, sizeof(buf)-len);
+  CU_ASSERT_EQUAL(0, gob_slice_encoder_set_tail(enc, buf, len));
+}
+
+void test_gob_slice_encoder_append() {
+  static char expected[8192];
+  static char buf[8192];
+  struct gob_slice_encoder enc;
+  int expected_len;
+  size_t len;
+  char *elem;
+  int errors = 0;
+  int count;
+
+  gob_slice_encoder_init(&enc, 65);
+  // the count and the length prefix both grow a byte on the way
+  for (count = 0; count <= 300; count++) {
+    if (count > 0) {
+      elem = gob_slice_encoder_reserve(&enc, 9);
+      CU_ASSERT_PTR_NOT_NULL_FATAL(elem);
+      gob_slice_encoder_commit(&enc, gob_encode_long_long(elem, 9, (count - 1) * 1000LL - 7));
+    }
+    set_head_and_tail(&enc, count);
+    expected_len = encode_snapshot(expected, sizeof(expected), 65, "snapshot", count, count);
+    len = gob_slice_encoder_copy(&enc, buf, sizeof(buf));
+    errors += len != (size_t)expected_len || memcmp(expected, buf, len) != 0;
+  }
+  CU_ASSERT_EQUAL(0, errors);
+  CU_ASSERT_EQUAL(300, enc.count);
+
+  // a short buffer gets what fits
+  memset(buf, 0, 16);
+  CU_ASSERT_EQUAL(expected_len, gob_slice_encoder_copy(&enc, buf, 10));
+  CU_ASSERT(memcmp(expected, buf, 10) == 0);
+  CU_ASSERT_EQUAL(0, buf[10]);
+  gob_slice_encoder_destroy(&enc);
+}
+
+void test_gob_slice_encoder_iov() {
+  static char expected[1024];
+  static char buf[1024];
+  struct gob_slice_encoder enc;
+  struct iovec iov[GOB_SLICE_ENCODER_IOV];
+  int expected_len;
+  int fds[2];
+  char *elem;
+  int iovcnt;
+  int i;
+
+  // without head and tail, an empty slice is the prefix, type id and count
+  gob_slice_encoder_init(&enc, 60);
+  iovcnt = gob_slice_encoder_iov(&enc, iov);
+  CU_ASSERT_EQUAL(2, iovcnt);
+  CU_ASSERT_EQUAL(2, iov[0].iov_len);
+  CU_ASSERT_EQUAL(2, ((char*)iov[0].iov_base)[0]);
+  CU_ASSERT_EQUAL(1, iov[1].iov_len);
+  CU_ASSERT_EQUAL(0, ((char*)iov[1].iov_base)[0]);
+  gob_slice_encoder_destroy(&enc);
+
+  gob_slice_encoder_init(&enc, 65);
+  set_head_and_tail(&enc, 9);
+  for (i = 0; i < 50; i++) {
+    elem = gob_slice_encoder_reserve(&enc, 9);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(elem);
+    gob_slice_encoder_commit(&enc, gob_encode_long_long(elem, 9, i * 1000LL - 7));
+  }
+  iovcnt = gob_slice_encoder_iov(&enc, iov);
+  CU_ASSERT_EQUAL(GOB_SLICE_ENCODER_IOV, iovcnt);
+  expected_len = encode_snapshot(expected, sizeof(expected), 65, "snapshot", 50, 9);
+
+  CU_ASSERT_EQUAL(0, pipe(fds));
+  CU_ASSERT_EQUAL(expected_len, writev(fds[1], iov, iovcnt));
+  CU_ASSERT_EQUAL(expected_len, read(fds[0], buf, sizeof(buf)));
+  CU_ASSERT(memcmp(expected, buf, expected_len) == 0);
+  close(fds[0]);
+  close(fds[1]);
+  gob_slice_encoder_destroy(&enc);
+}
@@ -0,0 +1,7 @@
+#ifndef _SLICE_TEST_H
+#define _SLICE_TEST_H
+
+void test_gob_slice_encoder_append();
+void test_gob_slice_encoder_iov();
+
+#endif
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+
+#ifdef GOB_ENABLE_STATS
+
+#include <pthread.h>
+
+struct gob_stats_block {
+  struct gob_stats stats;
+  struct gob_stats_block *next;
+};
+
+__thread struct gob_stats *gob_stats_local_block = NULL;
+
+static pthread_mutex_t sStatsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t sStatsOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t sStatsKey;
+static struct gob_stats_block *sStatsBlocks = NULL;
+// counters of threads which have exited
+static struct gob_stats sStatsRetired;
+
+static void gob_stats_add(struct gob_stats *to, const struct gob_stats *from) {
+  const unsigned long long *src = (const unsigned long long*)from;
+  unsigned long long *dst = (unsigned long long*)to;
+  size_t i;
+  for (i = 0; i < sizeof(struct gob_stats)/sizeof(unsigned long long); i++) {
+    dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+  }
+}
+
+static void gob_stats_retire_thread(void *arg) {
+  struct gob_stats_block *block = arg;
+  struct gob_stats_block **link;
+
+  pthread_mutex_lock(&sStatsLock);
+  for (link = &sStatsBlocks; *link != NULL; link = &(*link)->next) {
+    if (*link == block) {
+      *link = block->next;
+      break;
+    }
+  }
+  gob_stats_add(&sStatsRetired, &block->stats);
+  pthread_mutex_unlock(&sStatsLock);
+  free(block);
+}
+
+static void gob_stats_init_key(void) {
+  pthread_key_create(&sStatsKey, gob_stats_retire_thread);
+}
+
+// Out of memory leaves the thread with a shared dummy block so that the
+// hooks never have to check for NULL; its counts are simply lost.
+static struct gob_stats sStatsDummy;
+
+struct gob_stats *gob_stats_register_thread(void) {
+  struct gob_stats_block *block = calloc(1, sizeof(struct gob_stats_block));
+  if (block == NULL) {
+    gob_stats_local_block = &sStatsDummy;
+    return gob_stats_local_block;
+  }
+  pthread_once(&sStatsOnce, gob_stats_init_key);
+  pthread_mutex_lock(&sStatsLock);
+  block->next = sStatsBlocks;
+  sStatsBlocks = block;
+  pthread_mutex_unlock(&sStatsLock);
+  pthread_setspecific(sStatsKey, block);
+
+  gob_stats_local_block = &block->stats;
+  return gob_stats_local_block;
+}
+
+void gob_stats_snapshot(struct gob_stats *out) {
+  struct gob_stats_block *block;
+
+  memset(out, 0, sizeof(struct gob_stats));
+  pthread_mutex_lock(&sStatsLock);
+  gob_stats_add(out, &sStatsRetired);
+  for (block = sStatsBlocks; block != NULL; block = block->next) {
+    gob_stats_add(out, &block->stats);
+  }
+  pthread_mutex_unlock(&sStatsLock);
+}
+
+void gob_stats_reset(void) {
+  struct gob_stats_block *block;
+  unsigned long long *counters;
+  size_t i;
+
+  pthread_mutex_lock(&sStatsLock);
+  memset(&sStatsRetired, 0, sizeof(struct gob_stats));
+  for (block = sStatsBlocks; block != NULL; block = block->next) {
+    counters = (unsigned long long*)&block->stats;
+    for (i = 0; i < sizeof(struct gob_stats)/sizeof(unsigned long long); i++) {
+      __atomic_store_n(&counters[i], 0, __ATOMIC_RELAXED);
+    }
+  }
+  pthread_mutex_unlock(&sStatsLock);
+}
+
+#else
+
+void gob_stats_snapshot(struct gob_stats *out) {
+  memset(out, 0, sizeof(struct gob_stats));
+}
+
+void gob_stats_reset(void) {
+}
+
+#endif
+
+int gob_stats_dump_text(FILE *f, const struct gob_stats *s) {
+  int i;
+  int ret;
+
+  ret = fprintf(f,
+		"messages:         %llu\n"
+		"message bytes:    %llu\n"
+		"type definitions: %llu\n"
+		"bytes:            %llu\n"
+		"string bytes:     %llu\n"
+		"overflows:        %llu\n",
+		s->messages, s->message_bytes, s->type_definitions,
+		s->bytes, s->string_bytes, s->overflows);
+  for (i = 1; i < GOB_STATS_VARINT_BUCKETS && ret >= 0; i++) {
+    if (s->varints[i] != 0) {
+      ret = fprintf(f, "varint %d byte%s:   %llu\n", i, i == 1 ? " " : "s", s->varints[i]);
+    }
+  }
+  for (i = 0; i < GOB_STATS_MAX_TYPE_ID && ret >= 0; i++) {
+    if (s->type_messages[i] != 0) {
+      ret = fprintf(f, "type %d%s: %llu messages, %llu bytes\n", i,
+		    i == GOB_STATS_MAX_TYPE_ID-1 ? "+" : "",
+		    s->type_messages[i], s->type_bytes[i]);
+    }
+  }
+  return ret;
+}
+
+int gob_stats_dump_json(FILE *f, const struct gob_stats *s) {
+  int i;
+  int ret;
+  const char *sep = "";
+
+  ret = fprintf(f,
+		"{\"messages\":%llu,\"message_bytes\":%llu,\"type_definitions\":%llu,"
+		"\"bytes\":%llu,\"string_bytes\":%llu,\"overflows\":%llu,\"varints\":[",
+		s->messages, s->message_bytes, s->type_definitions,
+		s->bytes, s->string_bytes, s->overflows);
+  for (i = 1; i < GOB_STATS_VARINT_BUCKETS && ret >= 0; i++) {
+    ret = fprintf(f, "%s%llu", i == 1 ? "" : ",", s->varints[i]);
+  }
+  if (ret >= 0) {
+    ret = fprintf(f, "],\"types\":{");
+  }
+  for (i = 0; i < GOB_STATS_MAX_TYPE_ID && ret >= 0; i++) {
+    if (s->type_messages[i] != 0) {
+      ret = fprintf(f, "%s\"%d\":{\"messages\":%llu,\"bytes\":%llu}", sep, i,
+		    s->type_messages[i], s->type_bytes[i]);
+      sep = ",";
+    }
+  }
+  if (ret >= 0) {
+    ret = fprintf(f, "}}\n");
+  }
+  return ret;
+}
@@ -0,0 +1,147 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Encoder instrumentation.
+ *
+ * When libgob is built with GOB_ENABLE_STATS defined (for example
+ * CCFLAGS="-g -DGOB_ENABLE_STATS"), the encoders in encode.c count what they
+ * produce into per-thread counter blocks.  The blocks are only summed up when
+ * gob_stats_snapshot() is called, so the hot path never touches shared cache
+ * lines.
+ *
+ * Without GOB_ENABLE_STATS the counting macros expand to nothing and the
+ * snapshot functions return all-zero statistics.
+ */
+
+/**
+ * Number of buckets in the varint length histogram.  An encoded unsigned
+ * integer is at most 9 bytes long (count byte plus 8 value bytes), bucket 0
+ * is unused.
+ */
+#define GOB_STATS_VARINT_BUCKETS (10)
+
+/**
+ * Number of type ids tracked individually.  Messages of type ids at or beyond
+ * this value are accumulated in the last slot.
+ */
+#define GOB_STATS_MAX_TYPE_ID (256)
+
+struct gob_stats {
+  unsigned long long messages;          // messages framed by gob_end_message()
+  unsigned long long message_bytes;     // bytes of those messages, prefix included
+  unsigned long long type_definitions;  // calls to gob_start_type_definition()
+  unsigned long long bytes;             // bytes produced by the basic encoders
+  unsigned long long string_bytes;      // string payload bytes copied
+  unsigned long long overflows;         // encodes that did not fit the buffer
+  unsigned long long varints[GOB_STATS_VARINT_BUCKETS]; // by encoded length
+  unsigned long long type_messages[GOB_STATS_MAX_TYPE_ID];
+  unsigned long long type_bytes[GOB_STATS_MAX_TYPE_ID];
+};
+
+/**
+ * Sums the counters of all threads (including threads which have already
+ * exited) into the specified structure.
+ *
+ * The counters of running threads are read without synchronization, so a
+ * snapshot taken while other threads encode is consistent per counter but
+ * not across counters.
+ *
+ * @param out
+ *   The structure receiving the totals.
+ */
+void gob_stats_snapshot(struct gob_stats *out);
+
+/**
+ * Resets all counters to zero.
+ *
+ * Counts made concurrently by other threads during the reset may be lost.
+ */
+void gob_stats_reset(void);
+
+/**
+ * Writes a snapshot in human readable form.  Only non-zero histogram and
+ * type id entries are printed.
+ *
+ * @return
+ *   The value returned by the last fprintf(), negative on error.
+ */
+int gob_stats_dump_text(FILE *f, const struct gob_stats *s);
+
+/**
+ * Writes a snapshot as a single JSON object followed by a newline.
+ *
+ * @return
+ *   The value returned by the last fprintf(), negative on error.
+ */
+int gob_stats_dump_json(FILE *f, const struct gob_stats *s);
+
+///////////////////////////////////////////////////////////////////////////////
+// Counting hooks used by the encoders
+
+#ifdef GOB_ENABLE_STATS
+
+extern __thread struct gob_stats *gob_stats_local_block;
+
+struct gob_stats *gob_stats_register_thread(void);
+
+static inline struct gob_stats *gob_stats_local(void) {
+  struct gob_stats *s = gob_stats_local_block;
+  if (__builtin_expect(s == NULL, 0)) {
+    s = gob_stats_register_thread();
+  }
+  return s;
+}
+
+// The owning thread is the only writer, the relaxed load/store pair keeps
+// gob_stats_snapshot() free of data races while compiling to a plain add.
+#define GOB_STATS_ADD(field, n) do {					\
+    struct gob_stats *gob_stats_s_ = gob_stats_local();			\
+    __atomic_store_n(&gob_stats_s_->field,				\
+		     __atomic_load_n(&gob_stats_s_->field, __ATOMIC_RELAXED) + (n), \
+		     __ATOMIC_RELAXED);					\
+  } while (0)
+
+#define GOB_STATS_TYPE_SLOT(id)						\
+  ((id) >= 0 && (id) < GOB_STATS_MAX_TYPE_ID ? (id) : GOB_STATS_MAX_TYPE_ID-1)
+
+#define GOB_STATS_VARINT(len) do {		\
+    GOB_STATS_ADD(varints[(len)], 1);		\
+    GOB_STATS_ADD(bytes, (len));		\
+  } while (0)
+#define GOB_STATS_STRING(len) do {		\
+    GOB_STATS_ADD(string_bytes, (len));		\
+    GOB_STATS_ADD(bytes, (len));		\
+  } while (0)
+#define GOB_STATS_BYTES(len) GOB_STATS_ADD(bytes, (len))
+#define GOB_STATS_OVERFLOW() GOB_STATS_ADD(overflows, 1)
+#define GOB_STATS_TYPE_DEFINITION() GOB_STATS_ADD(type_definitions, 1)
+#define GOB_STATS_MESSAGE(id, len) do {				\
+    GOB_STATS_ADD(messages, 1);					\
+    GOB_STATS_ADD(message_bytes, (len));			\
+    GOB_STATS_ADD(type_messages[GOB_STATS_TYPE_SLOT(id)], 1);	\
+    GOB_STATS_ADD(type_bytes[GOB_STATS_TYPE_SLOT(id)], (len));	\
+  } while (0)
+
+#else
+
+#define GOB_STATS_VARINT(len) ((void)0)
+#define GOB_STATS_STRING(len) ((void)0)
+#define GOB_STATS_BYTES(len) ((void)0)
+#define GOB_STATS_OVERFLOW() ((void)0)
+#define GOB_STATS_TYPE_DEFINITION() ((void)0)
+#define GOB_STATS_MESSAGE(id, len) ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,78 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "stats.h"
+#include <stdio.h>
+#include <string.h>
+
+void test_gob_stats_snapshot() {
+  struct gob_stats stats;
+  char buf[1024];
+  int total_bytes = 0;
+
+  gob_stats_reset();
+
+  total_bytes += gob_start_message(buf, 1024, 65);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, 1024-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, 1024-total_bytes, "hello");
+  total_bytes += gob_end_struct(buf+total_bytes, 1024-total_bytes);
+  total_bytes = gob_end_message(buf, 1024, total_bytes);
+  CU_ASSERT_EQUAL(11, total_bytes);
+
+  // overflow
+  gob_encode_unsigned_int(buf, 2, 0x6ABCDEF0);
+
+  gob_stats_snapshot(&stats);
+#ifdef GOB_ENABLE_STATS
+  CU_ASSERT_EQUAL(1, stats.messages);
+  CU_ASSERT_EQUAL(11, stats.message_bytes);
+  CU_ASSERT_EQUAL(1, stats.type_messages[65]);
+  CU_ASSERT_EQUAL(11, stats.type_bytes[65]);
+  CU_ASSERT_EQUAL(5, stats.string_bytes);
+  CU_ASSERT_EQUAL(1, stats.overflows);
+  // type id, delta, string length, end of struct, message length
+  CU_ASSERT_EQUAL(4, stats.varints[1]);
+  CU_ASSERT_EQUAL(1, stats.varints[2]);
+  CU_ASSERT_EQUAL(1, stats.varints[5]);
+  // 11 bytes of message, 5 of the overflowing varint
+  CU_ASSERT_EQUAL(16, stats.bytes);
+
+  gob_stats_reset();
+  gob_stats_snapshot(&stats);
+  CU_ASSERT_EQUAL(0, stats.messages);
+  CU_ASSERT_EQUAL(0, stats.bytes);
+#else
+  CU_ASSERT_EQUAL(0, stats.messages);
+  CU_ASSERT_EQUAL(0, stats.bytes);
+#endif
+}
+
+void test_gob_stats_dump() {
+  struct gob_stats stats;
+  char out[4096];
+  FILE *f;
+
+  memset(&stats, 0, sizeof(stats));
+  stats.messages = 2;
+  stats.message_bytes = 22;
+  stats.varints[1] = 3;
+  stats.type_messages[65] = 2;
+  stats.type_bytes[65] = 22;
+
+  memset(out, '\0', sizeof(out));
+  f = fmemopen(out, sizeof(out)-1, "w");
+  CU_ASSERT(gob_stats_dump_json(f, &stats) >= 0);
+  fclose(f);
+  CU_ASSERT(strstr(out, "\"messages\":2,") != NULL);
+  CU_ASSERT(strstr(out, "\"varints\":[3,0,0,0,0,0,0,0,0]") != NULL);
+  CU_ASSERT(strstr(out, "\"types\":{\"65\":{\"messages\":2,\"bytes\":22}}") != NULL);
+
+  memset(out, '\0', sizeof(out));
+  f = fmemopen(out, sizeof(out)-1, "w");
+  CU_ASSERT(gob_stats_dump_text(f, &stats) >= 0);
+  fclose(f);
+  CU_ASSERT(strstr(out, "type 65: 2 messages, 22 bytes") != NULL);
+}
@@ -0,0 +1,7 @@
+#ifndef _STATS_TEST_H
+#define _STATS_TEST_H
+
+void test_gob_stats_snapshot();
+void test_gob_stats_dump();
+
+#endif
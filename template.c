@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "encode.h"
+#include "template.h"
+#include "varint.h"
+
+// Room kept in front of the body for the length prefix.
+#define GOB_TEMPLATE_PREFIX (sizeof(unsigned long long)+1)
+
+int gob_template_init(struct gob_template *t, int id) {
+  char id_bytes[sizeof(unsigned long long)+1];
+  int id_len = gob_encode_int(id_bytes, sizeof(id_bytes), id);
+
+  memset(t, 0, sizeof(struct gob_template));
+  t->buf_size = 256;
+  t->buf = malloc(t->buf_size);
+  if (t->buf == NULL) {
+    return -1;
+  }
+  t->start = t->buf_size / 4;
+  memcpy(t->buf + t->start, id_bytes, id_len);
+  t->end = t->start + id_len;
+  return 0;
+}
+
+void gob_template_destroy(struct gob_template *t) {
+  free(t->buf);
+  memset(t, 0, sizeof(struct gob_template));
+}
+
+// Moves the body into a larger buffer, centered so that either side has room
+// for more bytes.
+static int gob_template_grow(struct gob_template *t, size_t more) {
+  size_t body_len = t->end - t->start;
+  size_t size = t->buf_size * 2;
+  size_t start;
+  char *buf;
+  int i;
+
+  while (size < body_len + 2 * (GOB_TEMPLATE_PREFIX + more)) {
+    size *= 2;
+  }
+  buf = malloc(size);
+  if (buf == NULL) {
+    return -1;
+  }
+  start = (size - body_len) / 2;
+  memcpy(buf + start, t->buf + t->start, body_len);
+  for (i = 0; i < t->nholes; i++) {
+    t->holes[i].offset = t->holes[i].offset - t->start + start;
+  }
+  free(t->buf);
+  t->buf = buf;
+  t->buf_size = size;
+  t->start = start;
+  t->end = start + body_len;
+  return 0;
+}
+
+int gob_template_bytes(struct gob_template *t, const char *bytes, size_t len) {
+  if (t->buf_size - t->end < len && gob_template_grow(t, len) < 0) {
+    return -1;
+  }
+  memcpy(t->buf + t->end, bytes, len);
+  t->end += len;
+  return 0;
+}
+
+int gob_template_hole(struct gob_template *t, const char *name, int type, int delta) {
+  char delta_bytes[sizeof(unsigned long long)+1];
+  int delta_len = gob_encode_unsigned_int(delta_bytes, sizeof(delta_bytes), delta);
+  struct gob_template_hole *h;
+
+  if (type < GOB_TEMPLATE_INT || type > GOB_TEMPLATE_STRING) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (t->nholes == GOB_TEMPLATE_MAX_HOLES || gob_template_bytes(t, delta_bytes, delta_len) < 0 ||
+      gob_template_bytes(t, "", 1) < 0) {
+    return -1;
+  }
+  // every zero value encodes as a single 0
+  h = &t->holes[t->nholes];
+  h->name = name;
+  h->type = type;
+  h->offset = t->end - 1;
+  h->len = 1;
+  return t->nholes++;
+}
+
+int gob_template_find(const struct gob_template *t, const char *name) {
+  int i;
+  for (i = 0; i < t->nholes; i++) {
+    if (strcmp(t->holes[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Makes hole i len bytes long, moving the shorter of the spans in front of
+// and behind it.
+static int gob_template_resize(struct gob_template *t, int i, size_t len) {
+  struct gob_template_hole *h = &t->holes[i];
+  size_t before = h->offset - t->start;
+  size_t after = t->end - (h->offset + h->len);
+  size_t n;
+  int front;
+  int j;
+
+  if (len > h->len) {
+    n = len - h->len;
+    if (t->start < GOB_TEMPLATE_PREFIX + n && t->buf_size - t->end < n) {
+      if (gob_template_grow(t, n) < 0) {
+	return -1;
+      }
+    }
+    front = t->start >= GOB_TEMPLATE_PREFIX + n && (before < after || t->buf_size - t->end < n);
+    if (front) {
+      memmove(t->buf + t->start - n, t->buf + t->start, before);
+      t->start -= n;
+      for (j = 0; j <= i; j++) {
+	t->holes[j].offset -= n;
+      }
+    } else {
+      memmove(t->buf + h->offset + len, t->buf + h->offset + h->len, after);
+      t->end += n;
+      for (j = i + 1; j < t->nholes; j++) {
+	t->holes[j].offset += n;
+      }
+    }
+  } else if (len < h->len) {
+    n = h->len - len;
+    if (before < after) {
+      memmove(t->buf + t->start + n, t->buf + t->start, before);
+      t->start += n;
+      for (j = 0; j <= i; j++) {
+	t->holes[j].offset += n;
+      }
+    } else {
+      memmove(t->buf + h->offset + len, t->buf + h->offset + h->len, after);
+      t->end -= n;
+      for (j = i + 1; j < t->nholes; j++) {
+	t->holes[j].offset -= n;
+      }
+    }
+  }
+  h->len = len;
+  return 0;
+}
+
+// Checks that hole is one of type before it is filled.
+static inline int gob_template_check(const struct gob_template *t, int hole, int type) {
+  if (hole < 0 || hole >= t->nholes || t->holes[hole].type != type) {
+    errno = EINVAL;
+    return -1;
+  }
+  return 0;
+}
+
+static inline int gob_template_fill(struct gob_template *t, int hole, const char *bytes, int len) {
+  if (gob_template_resize(t, hole, len) < 0) {
+    return -1;
+  }
+  memcpy(t->buf + t->holes[hole].offset, bytes, len);
+  return 0;
+}
+
+int gob_template_set_int(struct gob_template *t, int hole, long long i) {
+  char bytes[sizeof(unsigned long long)+1];
+
+  if (gob_template_check(t, hole, GOB_TEMPLATE_INT) < 0) {
+    return -1;
+  }
+  return gob_template_fill(t, hole, bytes, gob_put_int(bytes, i));
+}
+
+int gob_template_set_uint(struct gob_template *t, int hole, unsigned long long u) {
+  char bytes[sizeof(unsigned long long)+1];
+
+  if (gob_template_check(t, hole, GOB_TEMPLATE_UINT) < 0) {
+    return -1;
+  }
+  return gob_template_fill(t, hole, bytes, gob_put_uint(bytes, u));
+}
+
+int gob_template_set_double(struct gob_template *t, int hole, double d) {
+  char bytes[sizeof(unsigned long long)+1];
+
+  if (gob_template_check(t, hole, GOB_TEMPLATE_DOUBLE) < 0) {
+    return -1;
+  }
+  return gob_template_fill(t, hole, bytes, gob_put_double(bytes, d));
+}
+
+int gob_template_set_string(struct gob_template *t, int hole, const char *data, size_t len) {
+  char count[sizeof(unsigned long long)+1];
+  int count_len = gob_put_uint(count, len);
+  char *p;
+
+  if (gob_template_check(t, hole, GOB_TEMPLATE_STRING) < 0) {
+    return -1;
+  }
+  if (gob_template_resize(t, hole, count_len + len) < 0) {
+    return -1;
+  }
+  p = t->buf + t->holes[hole].offset;
+  memcpy(p, count, count_len);
+  memcpy(p + count_len, data, len);
+  return 0;
+}
+
+const char *gob_template_message(struct gob_template *t, size_t *len) {
+  char prefix[sizeof(unsigned long long)+1];
+  int prefix_len = gob_put_uint(prefix, t->end - t->start);
+
+  memcpy(t->buf + t->start - prefix_len, prefix, prefix_len);
+  *len = prefix_len + (t->end - t->start);
+  return t->buf + t->start - prefix_len;
+}
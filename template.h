@@ -0,0 +1,135 @@
+#ifndef _TEMPLATE_H
+#define _TEMPLATE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Message templates.
+ *
+ * A gob_template is a value message encoded once, with holes for the fields
+ * that change from one message to the next.  Only the holes are encoded
+ * again:
+ *
+ * \code
+ * gob_template_init(&t, tick_id);
+ * len = gob_encode_unsigned_int(buf, sizeof(buf), 1);
+ * len += gob_encode_string(buf+len, sizeof(buf)-len, "GOOG");
+ * gob_template_bytes(&t, buf, len);                       // Sym
+ * px = gob_template_hole(&t, "Px", GOB_TEMPLATE_DOUBLE, 1);
+ * qty = gob_template_hole(&t, "Qty", GOB_TEMPLATE_INT, 1);
+ * gob_template_bytes(&t, "", 1);                           // gob_end_struct()
+ * for (;;) {
+ *   gob_template_set_double(&t, px, ...);
+ *   gob_template_set_int(&t, qty, ...);
+ *   msg = gob_template_message(&t, &len);
+ *   gob_writer_write(&writer, msg, len);
+ * }
+ * \endcode
+ *
+ * Holes are always sent, with their field delta, even when they hold the
+ * zero value; gob decoders accept fields that did not need to be sent.  A
+ * value of a different encoded size moves either the bytes in front of the
+ * hole or those behind it, whichever are fewer.  The body is kept with room
+ * for the length prefix in front, which gob_template_message() writes.
+ */
+
+#define GOB_TEMPLATE_INT    (1)
+#define GOB_TEMPLATE_UINT   (2) // also bool
+#define GOB_TEMPLATE_DOUBLE (3)
+#define GOB_TEMPLATE_STRING (4) // also []byte
+
+/**
+ * The maximum number of holes of a template.
+ */
+#define GOB_TEMPLATE_MAX_HOLES (16)
+
+struct gob_template_hole {
+  const char *name;
+  int type;                 // GOB_TEMPLATE_*
+  size_t offset;            // of the encoded value in buf
+  size_t len;               // of the encoded value
+};
+
+struct gob_template {
+  char *buf;
+  size_t buf_size;
+  size_t start;             // of the message body in buf
+  size_t end;
+  int nholes;
+  struct gob_template_hole holes[GOB_TEMPLATE_MAX_HOLES]; // in message order
+};
+
+/**
+ * Initializes a template of a value message of type id, holding just the
+ * type id.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_template_init(struct gob_template *t, int id);
+
+void gob_template_destroy(struct gob_template *t);
+
+/**
+ * Appends encoded bytes to the message, e.g. fields that never change and
+ * gob_end_struct().
+ *
+ * @return
+ *   0 on success, -1 if memory ran out.
+ */
+int gob_template_bytes(struct gob_template *t, const char *bytes, size_t len);
+
+/**
+ * Appends a field delta and a hole for the field's value, holding the zero
+ * value.
+ *
+ * @param name
+ *   The name to find the hole by, not copied.
+ * @param type
+ *   GOB_TEMPLATE_*
+ * @param delta
+ *   The field delta, from the field before or -1.
+ *
+ * @return
+ *   The hole's index, or -1 if there are too many holes, memory ran out or
+ *   type is not one of GOB_TEMPLATE_*.
+ */
+int gob_template_hole(struct gob_template *t, const char *name, int type, int delta);
+
+/**
+ * Returns the index of the hole called name, or -1.
+ */
+int gob_template_find(const struct gob_template *t, const char *name);
+
+/**
+ * Sets the value of a hole of the matching type.
+ *
+ * @return
+ *   0 on success, -1 if memory ran out or with errno EINVAL if there is no
+ *   such hole or it is of another type.
+ */
+int gob_template_set_int(struct gob_template *t, int hole, long long i);
+int gob_template_set_uint(struct gob_template *t, int hole, unsigned long long u);
+int gob_template_set_double(struct gob_template *t, int hole, double d);
+int gob_template_set_string(struct gob_template *t, int hole, const char *data, size_t len);
+
+/**
+ * Frames the message as it currently is.
+ *
+ * @param len
+ *   Receives the size of the framed message.
+ *
+ * @return
+ *   The message, valid until the template is changed.
+ */
+const char *gob_template_message(struct gob_template *t, size_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
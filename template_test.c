@@ -0,0 +1,127 @@
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "template.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// type Tick struct { Sym string; Px float64; Qty int; Seq uint }, with all
+// fields sent.
+static int encode_tick(char *buf, size_t buf_size, const char *sym, double px, long long qty,
+		       unsigned long long seq) {
+  int total_bytes = 0;
+  total_bytes += gob_start_message(buf, buf_size, 65);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, buf_size-total_bytes, sym);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_double(buf+total_bytes, buf_size-total_bytes, px);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_long_long(buf+total_bytes, buf_size-total_bytes, qty);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_unsigned_long_long(buf+total_bytes, buf_size-total_bytes, seq);
+  total_bytes += gob_end_struct(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+static void make_tick_template(struct gob_template *t, const char *sym) {
+  char buf[64];
+  int len;
+
+  CU_ASSERT_EQUAL(0, gob_template_init(t, 65));
+  len = gob_encode_unsigned_int(buf, sizeof(buf), 1);
+  len += gob_encode_string(buf+len, sizeof(buf)-len, sym);
+  CU_ASSERT_EQUAL(0, gob_template_bytes(t, buf, len));
+  CU_ASSERT_EQUAL(0, gob_template_hole(t, "Px", GOB_TEMPLATE_DOUBLE, 1));
+  CU_ASSERT_EQUAL(1, gob_template_hole(t, "Qty", GOB_TEMPLATE_INT, 1));
+  CU_ASSERT_EQUAL(2, gob_template_hole(t, "Seq", GOB_TEMPLATE_UINT, 1));
+  CU_ASSERT_EQUAL(0, gob_template_bytes(t, "", 1));
+}
+
+void test_gob_template_ticks() {
+  struct gob_template t;
+  char expected[128];
+  const char *msg;
+  size_t len;
+  int expected_len;
+  double px;
+  long long qty;
+  unsigned long long seq;
+  int errors = 0;
+  int i;
+
+  make_tick_template(&t, "GOOG");
+  msg = gob_template_message(&t, &len);
+  expected_len = encode_tick(expected, sizeof(expected), "GOOG", 0, 0, 0);
+  CU_ASSERT_EQUAL(expected_len, len);
+  CU_ASSERT(memcmp(expected, msg, len) == 0);
+
+  // values of all encoded sizes, growing and shrinking the holes
+  srand(42);
+  for (i = 0; i < 10000; i++) {
+    px = (i % 3) == 0 ? 0 : (rand() % 100000) / 100.0;
+    qty = (long long)((unsigned long long)rand() << (rand() % 32)) * ((i & 1) ? -1 : 1);
+    seq = ((unsigned long long)rand() << (rand() % 33)) >> (rand() % 64);
+    CU_ASSERT_EQUAL(0, gob_template_set_double(&t, gob_template_find(&t, "Px"), px));
+    CU_ASSERT_EQUAL(0, gob_template_set_int(&t, 1, qty));
+    CU_ASSERT_EQUAL(0, gob_template_set_uint(&t, 2, seq));
+    msg = gob_template_message(&t, &len);
+    expected_len = encode_tick(expected, sizeof(expected), "GOOG", px, qty, seq);
+    errors += len != (size_t)expected_len || memcmp(expected, msg, len) != 0;
+  }
+  CU_ASSERT_EQUAL(0, errors);
+  CU_ASSERT_EQUAL(-1, gob_template_find(&t, "Sym"));
+
+  // setters of another type, or of no hole, leave the message as it is
+  CU_ASSERT_EQUAL(-1, gob_template_set_int(&t, 0, 1));
+  CU_ASSERT_EQUAL(-1, gob_template_set_string(&t, 1, "x", 1));
+  CU_ASSERT_EQUAL(-1, gob_template_set_double(&t, 2, 1.0));
+  CU_ASSERT_EQUAL(-1, gob_template_set_uint(&t, 3, 1));
+  CU_ASSERT_EQUAL(-1, gob_template_hole(&t, "Bad", 0, 1));
+  msg = gob_template_message(&t, &len);
+  CU_ASSERT_EQUAL(expected_len, len);
+  CU_ASSERT(memcmp(expected, msg, len) == 0);
+  gob_template_destroy(&t);
+}
+
+void test_gob_template_strings() {
+  static char expected[4096];
+  static char sym[2000];
+  struct gob_template t;
+  const char *msg;
+  size_t len;
+  int expected_len;
+  int errors = 0;
+  int i;
+
+  // Sym as a hole, longer strings outgrow the buffer
+  CU_ASSERT_EQUAL(0, gob_template_init(&t, 65));
+  CU_ASSERT_EQUAL(0, gob_template_hole(&t, "Sym", GOB_TEMPLATE_STRING, 1));
+  CU_ASSERT_EQUAL(1, gob_template_hole(&t, "Px", GOB_TEMPLATE_DOUBLE, 1));
+  CU_ASSERT_EQUAL(2, gob_template_hole(&t, "Qty", GOB_TEMPLATE_INT, 1));
+  CU_ASSERT_EQUAL(3, gob_template_hole(&t, "Seq", GOB_TEMPLATE_UINT, 1));
+  CU_ASSERT_EQUAL(0, gob_template_bytes(&t, "", 1));
+  for (i = 0; i < 1999; i += 37) {
+    memset(sym, 'a' + i % 26, i);
+    sym[i] = '\0';
+    CU_ASSERT_EQUAL(0, gob_template_set_string(&t, 0, sym, i));
+    CU_ASSERT_EQUAL(0, gob_template_set_int(&t, 2, -i * 1000LL));
+    msg = gob_template_message(&t, &len);
+    expected_len = encode_tick(expected, sizeof(expected), sym, 0, -i * 1000LL, 0);
+    errors += len != (size_t)expected_len || memcmp(expected, msg, len) != 0;
+  }
+  // and shrink again
+  for (i = 1998; i >= 0; i -= 101) {
+    sym[i] = '\0';
+    CU_ASSERT_EQUAL(0, gob_template_set_string(&t, 0, sym, i));
+    CU_ASSERT_EQUAL(0, gob_template_set_uint(&t, 3, i));
+    msg = gob_template_message(&t, &len);
+    expected_len = encode_tick(expected, sizeof(expected), sym, 0, -1998000, i);
+    errors += len != (size_t)expected_len || memcmp(expected, msg, len) != 0;
+  }
+  CU_ASSERT_EQUAL(0, errors);
+  gob_template_destroy(&t);
+}
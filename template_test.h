@@ -0,0 +1,7 @@
+#ifndef _TEMPLATE_TEST_H
+#define _TEMPLATE_TEST_H
+
+void test_gob_template_ticks();
+void test_gob_template_strings();
+
+#endif
@@ -5,6 +5,25 @@
 #include "gob.h"
 #include "encode.h"
 #include "encode_test.h"
+#include "stats_test.h"
+#include "chunk_test.h"
+#include "writer_test.h"
+#include "outq_test.h"
+#include "mpsc_test.h"
+#include "pool_test.h"
+#include "decode_test.h"
+#include "scan_test.h"
+#include "columns_test.h"
+#include "slice_test.h"
+#include "memo_test.h"
+#include "template_test.h"
+#include "builder_test.h"
+#include "plan_test.h"
+#include "batch_test.h"
+#include "shm_test.h"
+#include "intern_test.h"
+#include "cpu_test.h"
+#include "gob_hpp_test.h"
 #include <stdio.h>
 
 int init_suite() { return 0; }
@@ -32,12 +51,276 @@ int main()
        (NULL == CU_add_test(pSuite, "test_gob_encode_string", test_gob_encode_string)) ||
        (NULL == CU_add_test(pSuite, "test_gob_encode_simple_type", test_gob_encode_simple_type)) ||
        (NULL == CU_add_test(pSuite, "test_gob_encode_more_complex_type", test_gob_encode_more_complex_type)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_end_message", test_gob_end_message)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_encode_sizing", test_gob_encode_sizing)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_encode_gob_encoder", test_gob_encode_gob_encoder)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_encode_large", test_gob_encode_large)) ||
        (NULL == CU_add_test(pSuite, "test_flip_unsigned_long_long", test_flip_unsigned_long_long)))
    {
       CU_cleanup_registry();
       return CU_get_error();
    }
 
+   pSuite = CU_add_suite("stats_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_stats_snapshot", test_gob_stats_snapshot)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_stats_dump", test_gob_stats_dump)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("chunk_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_chunk_message", test_gob_chunk_message)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_chunk_slices", test_gob_chunk_slices)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_chunk_busy", test_gob_chunk_busy)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("writer_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_writer_batching", test_gob_writer_batching)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_writer_large_message", test_gob_writer_large_message)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_writer_error", test_gob_writer_error)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_writer_partial", test_gob_writer_partial)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_writer_reserve", test_gob_writer_reserve)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("outq_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_outq_backpressure", test_gob_outq_backpressure)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_outq_wrap", test_gob_outq_wrap)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("mpsc_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_mpsc_producers", test_gob_mpsc_producers)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_mpsc_wrap", test_gob_mpsc_wrap)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_mpsc_sizes", test_gob_mpsc_sizes)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("pool_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_pool_reuse", test_gob_pool_reuse)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_pool_grow", test_gob_pool_grow)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_pool_threads", test_gob_pool_threads)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("decode_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_decode_basic_types", test_gob_decode_basic_types)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_decode_message", test_gob_decode_message)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_types_define", test_gob_types_define)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_walk_value", test_gob_walk_value)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("scan_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_scan_equality", test_gob_scan_equality)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_scan_ranges", test_gob_scan_ranges)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_scan_types", test_gob_scan_types)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("columns_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_columns_batches", test_gob_columns_batches)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_columns_string_data", test_gob_columns_string_data)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_columns_encode", test_gob_columns_encode)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("slice_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_slice_encoder_append", test_gob_slice_encoder_append)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_slice_encoder_iov", test_gob_slice_encoder_iov)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("memo_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_memo_lru", test_gob_memo_lru)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_memo_encode", test_gob_memo_encode)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("template_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_template_ticks", test_gob_template_ticks)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_template_strings", test_gob_template_strings)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("builder_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_builder_nested", test_gob_builder_nested)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_builder_slices", test_gob_builder_slices)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_builder_errors", test_gob_builder_errors)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("plan_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_decoder_identical", test_gob_decoder_identical)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_decoder_conversions", test_gob_decoder_conversions)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_decoder_mismatch", test_gob_decoder_mismatch)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("batch_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_batch_structs", test_gob_batch_structs)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_batch_values", test_gob_batch_values)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("shm_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_shm_producers", test_gob_shm_producers)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_shm_restart", test_gob_shm_restart)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("intern_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_intern_table", test_gob_intern_table)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_intern_decoder", test_gob_intern_decoder)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("cpu_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_cpu_features", test_gob_cpu_features)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_cpu_variants", test_gob_cpu_variants)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   pSuite = CU_add_suite("gob_hpp_suite", init_suite, clean_suite);
+   if (NULL == pSuite) {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
+   if ((NULL == CU_add_test(pSuite, "test_gob_hpp_encode_more_complex_type", test_gob_hpp_encode_more_complex_type)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_hpp_round_trip", test_gob_hpp_round_trip)) ||
+       (NULL == CU_add_test(pSuite, "test_gob_hpp_type_definitions", test_gob_hpp_type_definitions)))
+   {
+      CU_cleanup_registry();
+      return CU_get_error();
+   }
+
    /* Run all tests using the basic interface */
    CU_basic_set_mode(CU_BRM_VERBOSE);
    CU_basic_run_tests();
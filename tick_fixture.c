@@ -0,0 +1,50 @@
+#include "gob.h"
+#include "encode.h"
+#include "tick_fixture.h"
+
+int encode_tick_type(char *buf, size_t buf_size, int id) {
+  int total_bytes = 0;
+  total_bytes += gob_start_type_definition(buf, buf_size, id, GOB_STRUCTTYPE_ID);
+  total_bytes += gob_start_struct_type(buf+total_bytes, buf_size-total_bytes, "Tick", id);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_start_slice(buf+total_bytes, buf_size-total_bytes, 4);
+  total_bytes += gob_encode_field_type(buf+total_bytes, buf_size-total_bytes, "Sym", GOB_STRING_ID);
+  total_bytes += gob_encode_field_type(buf+total_bytes, buf_size-total_bytes, "Px", GOB_FLOAT_ID);
+  total_bytes += gob_encode_field_type(buf+total_bytes, buf_size-total_bytes, "Qty", GOB_INT_ID);
+  total_bytes += gob_encode_field_type(buf+total_bytes, buf_size-total_bytes, "Seq", GOB_UINT_ID);
+  total_bytes += gob_end_slice(buf+total_bytes, buf_size-total_bytes);
+  total_bytes += gob_end_struct_type(buf+total_bytes, buf_size-total_bytes);
+  total_bytes += gob_end_type_definition(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+int encode_tick(char *buf, size_t buf_size, int id, const char *sym, double px, long long qty,
+		unsigned long long seq) {
+  int total_bytes = 0;
+  int delta = 1;
+  total_bytes += gob_start_message(buf, buf_size, id);
+  if (*sym != '\0') {
+    total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, delta);
+    total_bytes += gob_encode_string(buf+total_bytes, buf_size-total_bytes, sym);
+    delta = 0;
+  }
+  delta++;
+  if (px != 0) {
+    total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, delta);
+    total_bytes += gob_encode_double(buf+total_bytes, buf_size-total_bytes, px);
+    delta = 0;
+  }
+  delta++;
+  if (qty != 0) {
+    total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, delta);
+    total_bytes += gob_encode_long_long(buf+total_bytes, buf_size-total_bytes, qty);
+    delta = 0;
+  }
+  delta++;
+  if (seq != 0) {
+    total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, delta);
+    total_bytes += gob_encode_unsigned_long_long(buf+total_bytes, buf_size-total_bytes, seq);
+  }
+  total_bytes += gob_end_struct(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
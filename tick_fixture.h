@@ -0,0 +1,17 @@
+#ifndef _TICK_FIXTURE_H
+#define _TICK_FIXTURE_H
+
+#include <stddef.h>
+
+// Messages of the Tick type shared by the scan, columns and plan tests:
+//
+// type Tick struct { Sym string; Px float64; Qty int; Seq uint }
+
+// Encodes the definition of Tick as type id.
+int encode_tick_type(char *buf, size_t buf_size, int id);
+
+// Encodes a Tick of type id, omitting the fields that are zero.
+int encode_tick(char *buf, size_t buf_size, int id, const char *sym, double px, long long qty,
+		unsigned long long seq);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+/**
+ * Static tracepoints.
+ *
+ * If <sys/sdt.h> (systemtap-sdt-dev) is available when libgob is built, the
+ * encoders and decoder contain USDT probes in the "libgob" provider.  An
+ * unattached probe is a single nop instruction, so they are left in release
+ * builds.  Define GOB_DISABLE_SDT to build without them.
+ *
+ * Probes and arguments:
+ *
+ * \code
+ * message__start   (int id)                     gob_start_message(),
+ *                                               gob_start_type_definition()
+ * message__end     (int id, size_t bytes)       gob_end_message()
+ * type__definition (int id, int type)           gob_start_type_definition()
+ * overflow         (size_t needed, size_t avail) an encode did not fit
+ * buffer__grow     (size_t old, size_t new)     an output buffer was enlarged
+ * decode__message  (int id, size_t bytes)       gob_decode_message()
+ * \endcode
+ *
+ * The id is the type id as it appears on the wire, negative for type
+ * definitions.  libgob.a is linked statically, so the probes live in the
+ * binary using it.  For example, per message encode latency:
+ *
+ * \code
+ * bpftrace -e 'usdt:./server:libgob:message__start { @s[tid] = nsecs; }
+ *   usdt:./server:libgob:message__end /@s[tid]/ {
+ *     @ns[arg0] = hist(nsecs - @s[tid]); delete(@s[tid]); }'
+ * \endcode
+ */
+
+#if !defined(GOB_DISABLE_SDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define GOB_TRACE_ENABLED 1
+#endif
+#endif
+
+#ifdef GOB_TRACE_ENABLED
+
+#include <sys/sdt.h>
+
+#define GOB_TRACE_MESSAGE_START(id) DTRACE_PROBE1(libgob, message__start, id)
+#define GOB_TRACE_MESSAGE_END(id, bytes) DTRACE_PROBE2(libgob, message__end, id, bytes)
+#define GOB_TRACE_TYPE_DEFINITION(id, type) DTRACE_PROBE2(libgob, type__definition, id, type)
+#define GOB_TRACE_OVERFLOW(needed, avail) DTRACE_PROBE2(libgob, overflow, needed, avail)
+#define GOB_TRACE_BUFFER_GROW(old_size, new_size) DTRACE_PROBE2(libgob, buffer__grow, old_size, new_size)
+#define GOB_TRACE_DECODE_MESSAGE(id, bytes) DTRACE_PROBE2(libgob, decode__message, id, bytes)
+
+#else
+
+#define GOB_TRACE_ENABLED 0
+
+#define GOB_TRACE_MESSAGE_START(id) ((void)0)
+#define GOB_TRACE_MESSAGE_END(id, bytes) ((void)0)
+#define GOB_TRACE_TYPE_DEFINITION(id, type) ((void)0)
+#define GOB_TRACE_OVERFLOW(needed, avail) ((void)0)
+#define GOB_TRACE_BUFFER_GROW(old_size, new_size) ((void)0)
+#define GOB_TRACE_DECODE_MESSAGE(id, bytes) ((void)0)
+
+#endif
+
+#endif
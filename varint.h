@@ -0,0 +1,60 @@
+#ifndef _VARINT_H
+#define _VARINT_H
+
+#include <string.h>
+
+/**
+ * Inline varint writers for the hot loops of the batch encoders.
+ *
+ * They produce the same bytes as gob_encode_unsigned_long_long(),
+ * gob_encode_long_long() and gob_encode_double(), without the calls, buffer
+ * size checks and statistics.  p must have room for sizeof(unsigned long
+ * long) + 1 bytes, all of which may be written to.  They return the number
+ * of bytes of the varint.
+ */
+
+static inline int gob_put_uint(char *p, unsigned long long u) {
+  int n;
+
+  if (u < 128) {
+    *p = (char)u;
+    return 1;
+  }
+  n = (64 - __builtin_clzll(u) + 7) / 8;
+  p[0] = (char)-n;
+  // all eight bytes in one store, big-endian with the value's bytes first;
+  // the ones after them are scratch
+  u <<= 64 - 8 * n;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  u = __builtin_bswap64(u);
+#endif
+  memcpy(p + 1, &u, sizeof(u));
+  return n + 1;
+}
+
+static inline unsigned long long gob_zigzag(long long i) {
+  return i < 0 ? ((unsigned long long)~i << 1) | 1 : (unsigned long long)i << 1;
+}
+
+static inline int gob_put_int(char *p, long long i) {
+  return gob_put_uint(p, gob_zigzag(i));
+}
+
+static inline int gob_put_double(char *p, double d) {
+  unsigned long long u;
+  memcpy(&u, &d, sizeof(u));
+  return gob_put_uint(p, __builtin_bswap64(u));
+}
+
+// The number of bytes gob_put_uint() returns for u, without writing them.
+static inline int gob_uint_size(unsigned long long u) {
+  return u < 128 ? 1 : (64 - __builtin_clzll(u) + 7) / 8 + 1;
+}
+
+static inline int gob_double_size(double d) {
+  unsigned long long u;
+  memcpy(&u, &d, sizeof(u));
+  return gob_uint_size(__builtin_bswap64(u));
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "writer.h"
+#include "decode.h"
+
+// Pieces of one writev() call: the buffer plus a message of up to this many
+// pieces.
+#define GOB_WRITER_MAX_IOV (16)
+
+int gob_writer_init(struct gob_writer *w, int fd, size_t buf_size, const struct gob_writer_policy *policy) {
+  memset(w, 0, sizeof(struct gob_writer));
+  w->buf = malloc(buf_size);
+  if (w->buf == NULL) {
+    return -1;
+  }
+  w->fd = fd;
+  w->buf_size = buf_size;
+  if (policy != NULL) {
+    w->policy = *policy;
+  }
+  return 0;
+}
+
+// Writes all of iov, restarting after short writes and signals.  Counts the
+// bytes written in *written, also when it fails.
+static int gob_writer_writev_all(struct gob_writer *w, struct iovec *iov, int iovcnt, size_t *written) {
+  *written = 0;
+  while (iovcnt > 0) {
+    ssize_t n = writev(w->fd, iov, iovcnt);
+    w->syscalls++;
+    if (n < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return -1;
+    }
+    *written += n;
+    while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+      n -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (char*)iov->iov_base + n;
+      iov->iov_len -= n;
+    }
+  }
+  return 0;
+}
+
+static int gob_writer_sync(struct gob_writer *w) {
+  if (w->policy.fsync_every == 0 || ++w->flushes < w->policy.fsync_every) {
+    return 0;
+  }
+  w->flushes = 0;
+  w->syscalls++;
+  return fsync(w->fd);
+}
+
+// Drops the first n bytes of the buffer, which have been written, and the
+// messages they complete.
+static void gob_writer_drop(struct gob_writer *w, size_t n) {
+  unsigned long long len;
+  size_t pos = 0;
+  size_t end = 0;
+  int prefix_len;
+
+  if (n == 0) {
+    return;
+  }
+  while (w->messages > 0) {
+    if (pos == 0 && w->partial > 0) {
+      end = w->partial;
+    } else {
+      // the buffer holds framed messages, see gob_end_message()
+      prefix_len = gob_decode_unsigned_long_long(w->buf + pos, w->len - pos, &len);
+      end = prefix_len < 0 || len > w->len - pos - prefix_len ? w->len : pos + prefix_len + len;
+    }
+    if (end > n) {
+      break;
+    }
+    w->messages--;
+    pos = end;
+  }
+  // the rest of a message cut by n
+  w->partial = w->messages > 0 && pos < n ? end - n : 0;
+  memmove(w->buf, w->buf + n, w->len - n);
+  w->len -= n;
+}
+
+// Buffers the bytes of iov after the first skip, the rest of a message
+// whose write failed, growing the buffer if need be.
+static int gob_writer_keep(struct gob_writer *w, const struct iovec *iov, int iovcnt, size_t skip) {
+  size_t total = 0;
+  size_t rest;
+  char *grown;
+  int i;
+
+  for (i = 0; i < iovcnt; i++) {
+    total += iov[i].iov_len;
+  }
+  if (total <= skip) {
+    return 0;
+  }
+  rest = total - skip;
+  if (w->len + rest > w->buf_size) {
+    grown = realloc(w->buf, w->len + rest);
+    if (grown == NULL) {
+      return -1;
+    }
+    w->buf = grown;
+  }
+  if (skip > 0 && w->messages == 0) {
+    w->partial = rest;
+  }
+  for (i = 0; i < iovcnt; i++) {
+    if (skip >= iov[i].iov_len) {
+      skip -= iov[i].iov_len;
+      continue;
+    }
+    memcpy(w->buf + w->len, (const char*)iov[i].iov_base + skip, iov[i].iov_len - skip);
+    w->len += iov[i].iov_len - skip;
+    skip = 0;
+  }
+  w->messages++;
+  return 0;
+}
+
+// Writes the buffered bytes followed by iov in one system call.  What is
+// not written stays buffered.
+static int gob_writer_flush_with(struct gob_writer *w, const struct iovec *iov, int iovcnt) {
+  struct iovec out[GOB_WRITER_MAX_IOV+1];
+  size_t written;
+  size_t buffered;
+  int count = 0;
+  int err;
+  int i;
+
+  if (w->len > 0) {
+    out[count].iov_base = w->buf;
+    out[count].iov_len = w->len;
+    count++;
+  }
+  for (i = 0; i < iovcnt; i++) {
+    if (iov[i].iov_len > 0) {
+      out[count++] = iov[i];
+    }
+  }
+  if (count == 0) {
+    return 0;
+  }
+  if (gob_writer_writev_all(w, out, count, &written) != 0) {
+    err = errno;
+    buffered = written < w->len ? written : w->len;
+    gob_writer_drop(w, buffered);
+    if (gob_writer_keep(w, iov, iovcnt, written - buffered) == 0) {
+      errno = err;
+    }
+    return -1;
+  }
+  w->len = 0;
+  w->messages = 0;
+  w->partial = 0;
+  return gob_writer_sync(w);
+}
+
+int gob_writer_flush(struct gob_writer *w) {
+  return gob_writer_flush_with(w, NULL, 0);
+}
+
+int gob_writer_destroy(struct gob_writer *w) {
+  int ret = gob_writer_flush(w);
+  free(w->buf);
+  w->buf = NULL;
+  w->buf_size = 0;
+  return ret;
+}
+
+// Counts a buffered message and flushes if the policy says so.
+static int gob_writer_account(struct gob_writer *w) {
+  w->messages++;
+  if ((w->policy.flush_messages != 0 && w->messages >= w->policy.flush_messages) ||
+      (w->policy.flush_bytes != 0 && w->len >= w->policy.flush_bytes) ||
+      w->len >= w->buf_size) {
+    return gob_writer_flush(w);
+  }
+  return 0;
+}
+
+int gob_writer_writev(struct gob_writer *w, const struct iovec *iov, int iovcnt) {
+  size_t len = 0;
+  int i;
+
+  if (iovcnt < 0 || iovcnt > GOB_WRITER_MAX_IOV) {
+    errno = EINVAL;
+    return -1;
+  }
+  for (i = 0; i < iovcnt; i++) {
+    len += iov[i].iov_len;
+  }
+  if (len > w->buf_size / 2 || w->len + len > w->buf_size) {
+    // not worth copying, or no room: send it along with what is buffered
+    return gob_writer_flush_with(w, iov, iovcnt);
+  }
+  for (i = 0; i < iovcnt; i++) {
+    memcpy(w->buf + w->len, iov[i].iov_base, iov[i].iov_len);
+    w->len += iov[i].iov_len;
+  }
+  return gob_writer_account(w);
+}
+
+int gob_writer_write(struct gob_writer *w, const char *msg, size_t len) {
+  struct iovec iov;
+  iov.iov_base = (void*)msg;
+  iov.iov_len = len;
+  return gob_writer_writev(w, &iov, 1);
+}
+
+char *gob_writer_reserve(struct gob_writer *w, size_t size) {
+  if (size > w->buf_size) {
+    errno = EMSGSIZE;
+    return NULL;
+  }
+  if (w->len + size > w->buf_size && gob_writer_flush(w) != 0) {
+    return NULL;
+  }
+  return w->buf + w->len;
+}
+
+int gob_writer_commit(struct gob_writer *w, size_t len) {
+  if (w->len + len > w->buf_size) {
+    errno = EINVAL;
+    return -1;
+  }
+  w->len += len;
+  return gob_writer_account(w);
+}
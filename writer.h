@@ -0,0 +1,110 @@
+#ifndef _WRITER_H
+#define _WRITER_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Buffered output of framed gob messages to a file descriptor.
+ *
+ * Small messages are collected in the writer's buffer (or encoded straight
+ * into it with gob_writer_reserve() and gob_writer_commit()) and written out
+ * with a single system call once the flush policy says so.  Messages larger
+ * than half the buffer, or larger than the room left in it, are not copied;
+ * they go out with the buffered bytes in one writev().
+ *
+ * The descriptor is expected to be blocking.  All functions returning int
+ * return 0 on success and -1 with errno set on failure.  A message passed to
+ * gob_writer_write() or gob_writer_writev() is taken even if writing fails:
+ * whatever was not written, of it and of the buffered messages, stays
+ * buffered (the buffer grows if need be) and goes out with the next flush,
+ * so a failed write is retried with gob_writer_flush(), not by passing the
+ * message again.
+ */
+
+/**
+ * When a gob_writer flushes on its own.  Zero disables a limit.
+ */
+struct gob_writer_policy {
+  size_t flush_bytes;       // flush once this many bytes are buffered
+  size_t flush_messages;    // flush once this many messages are buffered
+  unsigned int fsync_every; // fsync() after every n-th flush
+};
+
+struct gob_writer {
+  int fd;
+  char *buf;
+  size_t buf_size;
+  size_t len;               // bytes buffered
+  size_t messages;          // messages buffered, in whole or in part
+  size_t partial;           // bytes of the first one, if cut by a failed write
+  struct gob_writer_policy policy;
+  unsigned int flushes;     // flushes since the last fsync()
+  unsigned long long syscalls; // write(), writev() and fsync() calls made
+};
+
+/**
+ * Initializes a writer.
+ *
+ * @param w
+ *   The writer to initialize.
+ * @param fd
+ *   The (blocking) file descriptor to write to.  It is not closed by
+ *   gob_writer_destroy().
+ * @param buf_size
+ *   The size of the buffer to allocate.
+ * @param policy
+ *   The flush policy, or NULL to flush only when the buffer is full or on
+ *   gob_writer_flush().
+ */
+int gob_writer_init(struct gob_writer *w, int fd, size_t buf_size, const struct gob_writer_policy *policy);
+
+/**
+ * Flushes the writer and releases its buffer.
+ */
+int gob_writer_destroy(struct gob_writer *w);
+
+/**
+ * Writes one framed message, as produced by gob_end_message().
+ */
+int gob_writer_write(struct gob_writer *w, const char *msg, size_t len);
+
+/**
+ * Writes one framed message gathered from several pieces, e.g. a length
+ * prefix and a pre-encoded body.
+ */
+int gob_writer_writev(struct gob_writer *w, const struct iovec *iov, int iovcnt);
+
+/**
+ * Returns space for a message of at most size bytes to be encoded directly
+ * into the buffer, flushing buffered messages first if necessary.
+ *
+ * @return
+ *   A pointer to the space, or NULL (with errno set) if size exceeds the
+ *   buffer size or the flush failed.
+ */
+char *gob_writer_reserve(struct gob_writer *w, size_t size);
+
+/**
+ * Completes a message encoded into the space returned by
+ * gob_writer_reserve().
+ *
+ * @param len
+ *   The size of the framed message, at most the reserved size.
+ */
+int gob_writer_commit(struct gob_writer *w, size_t len);
+
+/**
+ * Writes out all buffered messages.
+ */
+int gob_writer_flush(struct gob_writer *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
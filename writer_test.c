@@ -0,0 +1,245 @@
+#define _GNU_SOURCE
+#include "CUnit/Basic.h"
+#include "CUnit/Console.h"
+#include "CUnit/Automated.h"
+
+#include "gob.h"
+#include "encode.h"
+#include "writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// Reads whatever is available from the non-blocking pipe end.
+static ssize_t drain_pipe(int fd, char *buf, size_t buf_size) {
+  ssize_t total = 0;
+  ssize_t n;
+  while ((n = read(fd, buf + total, buf_size - total)) > 0) {
+    total += n;
+  }
+  return total;
+}
+
+static int encode_hello(char *buf, size_t buf_size) {
+  int total_bytes = 0;
+  total_bytes += gob_start_message(buf, buf_size, 65);
+  total_bytes += gob_encode_unsigned_int(buf+total_bytes, buf_size-total_bytes, 1);
+  total_bytes += gob_encode_string(buf+total_bytes, buf_size-total_bytes, "hello");
+  total_bytes += gob_end_struct(buf+total_bytes, buf_size-total_bytes);
+  return gob_end_message(buf, buf_size, total_bytes);
+}
+
+void test_gob_writer_batching() {
+  struct gob_writer w;
+  struct gob_writer_policy policy = { 0, 10, 0 };
+  char msg[64];
+  char in[1024];
+  int fds[2];
+  int len = encode_hello(msg, sizeof(msg));
+  int i;
+
+  CU_ASSERT_EQUAL(11, len);
+  CU_ASSERT_EQUAL(0, pipe(fds));
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  CU_ASSERT_EQUAL(0, gob_writer_init(&w, fds[1], 4096, &policy));
+
+  for (i = 0; i < 9; i++) {
+    CU_ASSERT_EQUAL(0, gob_writer_write(&w, msg, len));
+  }
+  CU_ASSERT_EQUAL(0, drain_pipe(fds[0], in, sizeof(in)));
+  CU_ASSERT_EQUAL(0, w.syscalls);
+
+  // the tenth message triggers a single write
+  CU_ASSERT_EQUAL(0, gob_writer_write(&w, msg, len));
+  CU_ASSERT_EQUAL(1, w.syscalls);
+  CU_ASSERT_EQUAL(10*len, drain_pipe(fds[0], in, sizeof(in)));
+  for (i = 0; i < 10; i++) {
+    CU_ASSERT(memcmp(msg, in + i*len, len) == 0);
+  }
+
+  CU_ASSERT_EQUAL(0, gob_writer_write(&w, msg, len));
+  CU_ASSERT_EQUAL(0, gob_writer_flush(&w));
+  CU_ASSERT_EQUAL(len, drain_pipe(fds[0], in, sizeof(in)));
+  CU_ASSERT_EQUAL(2, w.syscalls);
+
+  CU_ASSERT_EQUAL(0, gob_writer_destroy(&w));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void test_gob_writer_large_message() {
+  struct gob_writer w;
+  char small[64];
+  char large[200];
+  char in[1024];
+  int fds[2];
+  int small_len = encode_hello(small, sizeof(small));
+
+  memset(large, 'x', sizeof(large));
+  CU_ASSERT_EQUAL(0, pipe(fds));
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  CU_ASSERT_EQUAL(0, gob_writer_init(&w, fds[1], 128, NULL));
+
+  CU_ASSERT_EQUAL(0, gob_writer_write(&w, small, small_len));
+  CU_ASSERT_EQUAL(0, w.syscalls);
+  // does not fit, goes out together with the buffered message
+  CU_ASSERT_EQUAL(0, gob_writer_write(&w, large, sizeof(large)));
+  CU_ASSERT_EQUAL(1, w.syscalls);
+  CU_ASSERT_EQUAL(small_len + sizeof(large), drain_pipe(fds[0], in, sizeof(in)));
+  CU_ASSERT(memcmp(small, in, small_len) == 0);
+  CU_ASSERT(memcmp(large, in + small_len, sizeof(large)) == 0);
+  CU_ASSERT_EQUAL(0, w.len);
+
+  // more than half the buffer is not copied even though it would fit
+  CU_ASSERT_EQUAL(0, gob_writer_write(&w, large, 100));
+  CU_ASSERT_EQUAL(2, w.syscalls);
+  CU_ASSERT_EQUAL(0, w.len);
+  CU_ASSERT_EQUAL(100, drain_pipe(fds[0], in, sizeof(in)));
+
+  CU_ASSERT_EQUAL(0, gob_writer_destroy(&w));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void test_gob_writer_error() {
+  struct gob_writer w;
+  char msg[64];
+  char in[1024];
+  int fds[2];
+  int len = encode_hello(msg, sizeof(msg));
+  void (*old)(int) = signal(SIGPIPE, SIG_IGN);
+
+  CU_ASSERT_EQUAL(0, pipe(fds));
+  close(fds[0]);
+  CU_ASSERT_EQUAL(0, gob_writer_init(&w, fds[1], 128, NULL));
+
+  CU_ASSERT_EQUAL(0, gob_writer_write(&w, msg, len));
+  CU_ASSERT_EQUAL(0, gob_writer_write(&w, msg, len));
+  CU_ASSERT_EQUAL(-1, gob_writer_flush(&w));
+  CU_ASSERT_EQUAL(EPIPE, errno);
+  // nothing was written, so all of it is still buffered
+  CU_ASSERT_EQUAL(2*len, w.len);
+  CU_ASSERT_EQUAL(2, w.messages);
+
+  // and goes out once the descriptor works again
+  close(fds[1]);
+  CU_ASSERT_EQUAL(0, pipe(fds));
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  w.fd = fds[1];
+  CU_ASSERT_EQUAL(0, gob_writer_flush(&w));
+  CU_ASSERT_EQUAL(0, w.len);
+  CU_ASSERT_EQUAL(2*len, drain_pipe(fds[0], in, sizeof(in)));
+  CU_ASSERT(memcmp(msg, in, len) == 0);
+  CU_ASSERT(memcmp(msg, in + len, len) == 0);
+
+  CU_ASSERT_EQUAL(0, gob_writer_destroy(&w));
+  close(fds[0]);
+  close(fds[1]);
+  signal(SIGPIPE, old);
+}
+
+// Frames body_len bytes of fill as one message at buf.
+static size_t frame(char *buf, size_t body_len, char fill) {
+  memset(buf, fill, body_len);
+  return gob_end_message64(buf, body_len + 16, body_len);
+}
+
+void test_gob_writer_partial() {
+  struct gob_writer w;
+  static char msgs[5][10016];
+  static char expected[20000];
+  static char in[20000];
+  size_t lens[5];
+  size_t total = 0;
+  size_t got = 0;
+  int fds[2];
+  int i;
+
+  CU_ASSERT_EQUAL(0, pipe(fds));
+  // one page, written in part once full
+  CU_ASSERT_EQUAL(4096, fcntl(fds[1], F_SETPIPE_SZ, 4096));
+  fcntl(fds[0], F_SETFL, O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  CU_ASSERT_EQUAL(0, gob_writer_init(&w, fds[1], 8192, NULL));
+  for (i = 0; i < 5; i++) {
+    lens[i] = frame(msgs[i], i < 4 ? 1997 : 9997, 'a' + i);
+    memcpy(expected + total, msgs[i], lens[i]);
+    total += lens[i];
+  }
+  CU_ASSERT_EQUAL(2000, lens[0]);
+  CU_ASSERT_EQUAL(10000, lens[4]);
+
+  for (i = 0; i < 3; i++) {
+    CU_ASSERT_EQUAL(0, gob_writer_write(&w, msgs[i], lens[i]));
+  }
+  CU_ASSERT_EQUAL(3, w.messages);
+  // two messages and a part of the third go out
+  CU_ASSERT_EQUAL(-1, gob_writer_flush(&w));
+  CU_ASSERT_EQUAL(EAGAIN, errno);
+  CU_ASSERT_EQUAL(6000 - 4096, w.len);
+  CU_ASSERT_EQUAL(1, w.messages);
+  CU_ASSERT_EQUAL(0, gob_writer_write(&w, msgs[3], lens[3]));
+  CU_ASSERT_EQUAL(2, w.messages);
+  // nothing goes out
+  CU_ASSERT_EQUAL(-1, gob_writer_flush(&w));
+  CU_ASSERT_EQUAL(8000 - 4096, w.len);
+  CU_ASSERT_EQUAL(2, w.messages);
+  got += drain_pipe(fds[0], in + got, sizeof(in) - got);
+  CU_ASSERT_EQUAL(4096, got);
+
+  // the buffered messages and a part of the large one go out, the rest of
+  // it stays in the grown buffer
+  CU_ASSERT_EQUAL(-1, gob_writer_write(&w, msgs[4], lens[4]));
+  CU_ASSERT_EQUAL(EAGAIN, errno);
+  CU_ASSERT_EQUAL(total - 2 * 4096, w.len);
+  CU_ASSERT_EQUAL(1, w.messages);
+  for (i = 0; i < 10 && gob_writer_flush(&w) != 0; i++) {
+    got += drain_pipe(fds[0], in + got, sizeof(in) - got);
+  }
+  got += drain_pipe(fds[0], in + got, sizeof(in) - got);
+  CU_ASSERT_EQUAL(0, w.len);
+  CU_ASSERT_EQUAL(0, w.messages);
+  CU_ASSERT_FATAL(total == got);
+  CU_ASSERT(memcmp(expected, in, total) == 0);
+
+  CU_ASSERT_EQUAL(0, gob_writer_destroy(&w));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void test_gob_writer_reserve() {
+  struct gob_writer w;
+  struct gob_writer_policy policy = { 0, 0, 1 };
+  char expected[64];
+  char in[1024];
+  char *space;
+  int len;
+  int fd;
+  char path[] = "/tmp/gob_writer_testXXXXXX";
+
+  fd = mkstemp(path);
+  CU_ASSERT(fd >= 0);
+  unlink(path);
+  CU_ASSERT_EQUAL(0, gob_writer_init(&w, fd, 256, &policy));
+
+  space = gob_writer_reserve(&w, 64);
+  CU_ASSERT_PTR_NOT_NULL(space);
+  len = encode_hello(space, 64);
+  CU_ASSERT_EQUAL(0, gob_writer_commit(&w, len));
+  CU_ASSERT_PTR_NULL(gob_writer_reserve(&w, 257));
+
+  // write and fsync
+  CU_ASSERT_EQUAL(0, gob_writer_flush(&w));
+  CU_ASSERT_EQUAL(2, w.syscalls);
+
+  CU_ASSERT_EQUAL(len, encode_hello(expected, sizeof(expected)));
+  CU_ASSERT_EQUAL(len, pread(fd, in, sizeof(in), 0));
+  CU_ASSERT(memcmp(expected, in, len) == 0);
+
+  CU_ASSERT_EQUAL(0, gob_writer_destroy(&w));
+  close(fd);
+}
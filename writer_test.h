@@ -0,0 +1,10 @@
+#ifndef _WRITER_TEST_H
+#define _WRITER_TEST_H
+
+void test_gob_writer_batching();
+void test_gob_writer_large_message();
+void test_gob_writer_error();
+void test_gob_writer_partial();
+void test_gob_writer_reserve();
+
+#endif